@@ -0,0 +1,388 @@
+//
+//  camera_benchmarks.cpp
+//  camera_interface
+//
+//  Times the camera_interface hot paths against the simulated camera SDK and writes the
+//  results as JSON, so runs from different releases can be compared. The simulated cameras
+//  answer immediately and download without a bandwidth limit, so the times are those of
+//  camera_interface (and the simulator) rather than of a camera. download_recovery injects
+//  faults into the simulator to time how long recovering from them takes.
+//
+//  camera_benchmarks [output.json]
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Poco/JSON/PrintHandler.h"
+
+#include "EDSDKErrors.h"
+#include "LSCameraConfig.h"
+#include "camera_interface.hpp"
+#include "simulator.hpp"
+
+namespace
+{
+
+constexpr uint32_t files_on_card = 20000;
+constexpr uint64_t download_file_size = 32 * 1024 * 1024;
+
+struct result
+{
+    std::string name;
+    uint64_t items = 0;
+    uint64_t bytes = 0;
+    double total_ms = 0;
+    uint64_t sdk_calls = 0;
+    /// Heap allocations, only counted in instrumentation builds
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t faults = 0;
+    uint64_t wasted_bytes = 0;
+    double recover_ms = 0;
+};
+
+/// What a benchmark did, so rates can be worked out
+struct work
+{
+    uint64_t items;
+    uint64_t bytes;
+    /// The injected faults, the bytes downloaded again because of them and the time spent
+    /// getting going again afterwards
+    uint64_t faults = 0;
+    uint64_t wasted_bytes = 0;
+    double recover_ms = 0;
+};
+
+simulator::configuration benchmark_configuration()
+{
+    simulator::card card;
+    card.files = files_on_card;
+    card.file_size = download_file_size;
+    card.capacity = uint64_t(files_on_card) * download_file_size * 2;
+
+    simulator::camera camera;
+    camera.cards = { card };
+
+    simulator::configuration config;
+    config.cameras = { camera };
+    config.timing.call_latency = std::chrono::microseconds(0);
+    config.timing.call_latencies.clear();
+    config.timing.bytes_per_second = 0;
+    return config;
+}
+
+result run(const std::string& name, const std::function<work()>& benchmark)
+{
+    reset_api_stats();
+    reset_allocation_stats();
+    const auto start = std::chrono::steady_clock::now();
+    const auto done = benchmark();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    result r { name, done.items, done.bytes,
+        std::chrono::duration<double, std::milli>(elapsed).count(), 0 };
+    r.faults = done.faults;
+    r.wasted_bytes = done.wasted_bytes;
+    r.recover_ms = done.recover_ms;
+    for (const auto& call : get_api_stats())
+        r.sdk_calls += call.calls;
+    for (const auto& scope : get_allocation_stats())
+    {
+        if (scope.scope == "total")
+        {
+            r.allocations = scope.allocations;
+            r.allocated_bytes = scope.bytes;
+        }
+    }
+
+    std::cerr << name << ": " << r.total_ms << " ms" << std::endl;
+    return r;
+}
+
+/// List every file on the card, reading each name (one directory item info call each)
+work volume_enumeration(volume_ref& volume)
+{
+    uint64_t files = 0;
+    auto dcim = volume.select_directory(0);
+    const auto folders = dcim->get_directory_count();
+    for (directory_ref::size_type f = 0; f < folders; f++)
+    {
+        auto folder = dcim->get_directory_entry(f);
+        const auto count = folder->get_directory_count();
+        for (directory_ref::size_type i = 0; i < count; i++)
+        {
+            if (!folder->get_directory_entry(i)->get_name().empty())
+                files++;
+        }
+    }
+    return { files, 0 };
+}
+
+/// Match a pattern against every name in the first image folder
+work find_matching_files(volume_ref& volume)
+{
+    const auto matches = volume.find_matching_files("100CANON", std::regex("IMG_1[0-9]*\\.CR2"));
+    if (matches.empty())
+        throw std::runtime_error("find_matching_files found nothing");
+
+    auto dcim = volume.select_directory(0);
+    return { dcim->find_directory("100CANON")->get_directory_count(), 0 };
+}
+
+work camera_info_construction(camera_ref& camera)
+{
+    constexpr uint64_t iterations = 1000;
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        if (camera.get_camera_info()->get_product_name().empty())
+            throw std::runtime_error("The camera has no name");
+    }
+    return { iterations, 0 };
+}
+
+/// Resolve the timestamp of files from their thumbnails
+work timestamp_resolution(volume_ref& volume)
+{
+    constexpr directory_ref::size_type files = 1000;
+    auto folder = volume.select_directory(0)->get_directory_entry(0);
+    for (directory_ref::size_type i = 0; i < files; i++)
+    {
+        if (folder->get_directory_entry(i)->get_timestamp() == 0)
+            throw std::runtime_error("A file has no timestamp");
+    }
+    return { files, 0 };
+}
+
+work download_throughput(volume_ref& volume, const std::filesystem::path& destination)
+{
+    constexpr directory_ref::size_type files = 8;
+    uint64_t bytes = 0;
+    auto folder = volume.select_directory(0)->get_directory_entry(0);
+    for (directory_ref::size_type i = 0; i < files; i++)
+    {
+        auto file = folder->get_directory_entry(i);
+        const auto target = destination / file->get_name();
+        file->download_to(target.string());
+        bytes += std::filesystem::file_size(target);
+        std::filesystem::remove(target);
+    }
+    return { files, bytes };
+}
+
+/// Download files while the camera is busy now and then, part way through some downloads, and is
+/// disconnected once during a download. Each failed download is retried, after reselecting the
+/// camera if it was disconnected, as cpimage does. Only busy errors are retried, and only so many
+/// times, so any other error fails the benchmark rather than looping.
+work download_recovery(camera_connection& cameras, std::shared_ptr<camera_ref>& camera,
+    std::shared_ptr<volume_ref>& volume, const std::filesystem::path& destination)
+{
+    constexpr directory_ref::size_type files = 8;
+    const auto reconnect_timeout = std::chrono::seconds(10);
+    /// One in four downloads is busy, so this many in a row means something else is wrong
+    constexpr int busy_attempts = 20;
+
+    simulator::fault busy;
+    busy.function = "EdsDownload";
+    busy.probability = 0.25;
+    busy.at_fraction = 0.25;
+
+    simulator::fault busy_listing;
+    busy_listing.function = "EdsGetChildAtIndex";
+    busy_listing.probability = 0.05;
+
+    simulator::fault disconnect;
+    disconnect.function = "EdsDownload";
+    disconnect.kind = simulator::fault::kind_t::disconnect;
+    disconnect.file = "IMG_0003.CR2";
+    disconnect.at_fraction = 0.5;
+    disconnect.times = 1;
+    disconnect.reconnect_after = std::chrono::milliseconds(100);
+
+    std::atomic<bool> reconnected { false };
+    cameras.set_camera_added_handler([&reconnected] { reconnected = true; });
+
+    simulator::reset_fault_statistics();
+    simulator::inject_faults({ disconnect, busy, busy_listing });
+
+    work done { files, 0 };
+    std::chrono::steady_clock::duration recovering { 0 };
+    bool reselect = false;
+    for (directory_ref::size_type i = 0; i < files; i++)
+    {
+        for (int busy_retries = 0;;)
+        {
+            const auto attempt = std::chrono::steady_clock::now();
+            try
+            {
+                if (reselect)
+                {
+                    if (camera)
+                        cameras.deselect_camera(camera);
+                    cameras.refresh();
+                    camera = cameras.select_camera(0);
+                    volume = camera->select_volume(0);
+                    reselect = false;
+                }
+
+                auto folder = volume->select_directory(0)->get_directory_entry(0);
+                auto file = folder->get_directory_entry(i);
+                const auto target = destination / file->get_name();
+                file->download_to(target.string());
+                done.bytes += std::filesystem::file_size(target);
+                std::filesystem::remove(target);
+                break;
+            }
+            catch (const camera_disconnected_exception&)
+            {
+                while (!reconnected)
+                {
+                    if (std::chrono::steady_clock::now() - attempt > reconnect_timeout)
+                        throw std::runtime_error("The camera was not reconnected");
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+
+                reconnected = false;
+                reselect = true;
+            }
+            catch (const eds_exception& ex)
+            {
+                // The camera was busy, so try again
+                if (ex.error_code() != EDS_ERR_DEVICE_BUSY || ++busy_retries == busy_attempts)
+                    throw;
+            }
+
+            recovering += std::chrono::steady_clock::now() - attempt;
+        }
+    }
+
+    simulator::inject_faults({});
+    cameras.set_camera_added_handler(nullptr);
+
+    const auto statistics = simulator::get_fault_statistics();
+    done.faults = statistics.faults;
+    done.wasted_bytes = statistics.bytes_wasted;
+    done.recover_ms = std::chrono::duration<double, std::milli>(recovering).count();
+    return done;
+}
+
+void write_json(std::ostream& out, const std::vector<result>& results)
+{
+    Poco::JSON::PrintHandler json(out, 2);
+    json.startObject();
+    json.key("benchmark");
+    json.value(std::string("camera_benchmarks"));
+    json.key("version");
+    json.value(
+        std::to_string(LSCAMERA_VERSION_MAJOR) + "." + std::to_string(LSCAMERA_VERSION_MINOR));
+    json.key("files_on_card");
+    json.value(static_cast<Poco::UInt64>(files_on_card));
+    json.key("peak_rss_bytes");
+    json.value(static_cast<Poco::UInt64>(get_peak_rss()));
+
+    json.key("results");
+    json.startArray();
+    for (const auto& r : results)
+    {
+        const double seconds = r.total_ms / 1000;
+        json.startObject();
+        json.key("name");
+        json.value(r.name);
+        json.key("items");
+        json.value(static_cast<Poco::UInt64>(r.items));
+        json.key("total_ms");
+        json.value(r.total_ms);
+        json.key("us_per_item");
+        json.value(r.items ? r.total_ms * 1000 / static_cast<double>(r.items) : 0.0);
+        json.key("sdk_calls");
+        json.value(static_cast<Poco::UInt64>(r.sdk_calls));
+        if (allocation_stats_available())
+        {
+            json.key("allocations");
+            json.value(static_cast<Poco::UInt64>(r.allocations));
+            json.key("allocated_bytes");
+            json.value(static_cast<Poco::UInt64>(r.allocated_bytes));
+        }
+        if (r.faults)
+        {
+            json.key("faults");
+            json.value(static_cast<Poco::UInt64>(r.faults));
+            json.key("wasted_bytes");
+            json.value(static_cast<Poco::UInt64>(r.wasted_bytes));
+            json.key("recover_ms");
+            json.value(r.recover_ms);
+        }
+        if (r.bytes)
+        {
+            json.key("bytes");
+            json.value(static_cast<Poco::UInt64>(r.bytes));
+            json.key("mb_per_second");
+            json.value(static_cast<double>(r.bytes) / (1024 * 1024) / seconds);
+        }
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    out << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        simulator::configure(benchmark_configuration());
+
+        auto cameras = get_camera_connection();
+        auto camera = cameras->select_camera(0);
+        auto volume = camera->select_volume(0);
+
+        const auto destination = std::filesystem::temp_directory_path() / "camera_benchmarks";
+        std::filesystem::create_directories(destination);
+
+        set_api_stats_enabled(true);
+
+        std::vector<result> results;
+        results.push_back(run("volume_enumeration", [&] { return volume_enumeration(*volume); }));
+        results.push_back(
+            run("find_matching_files", [&] { return find_matching_files(*volume); }));
+        results.push_back(
+            run("camera_info_construction", [&] { return camera_info_construction(*camera); }));
+        results.push_back(
+            run("timestamp_resolution", [&] { return timestamp_resolution(*volume); }));
+        results.push_back(run(
+            "download_throughput", [&] { return download_throughput(*volume, destination); }));
+        results.push_back(run("download_recovery",
+            [&] { return download_recovery(*cameras, camera, volume, destination); }));
+
+        std::filesystem::remove_all(destination);
+
+        if (argc > 1)
+        {
+            std::ofstream out(argv[1]);
+            write_json(out, results);
+        }
+        else
+        {
+            write_json(std::cout, results);
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Benchmark failed: " << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
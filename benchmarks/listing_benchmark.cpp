@@ -0,0 +1,117 @@
+//
+//  listing_benchmark.cpp
+//  camera_interface
+//
+//  Formats a 100,000 entry file listing with the original iostream code and with
+//  listing_writer, checks the output is identical and reports how long each took.
+//
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "listing_writer.hpp"
+
+namespace
+{
+
+struct entry
+{
+    std::string name;
+    uint64_t size;
+    std::string date_time;
+    uint32_t format;
+    uint32_t group_id;
+};
+
+std::vector<entry> make_entries(std::size_t count)
+{
+    std::vector<entry> entries;
+    entries.reserve(count);
+
+    uint64_t seed = 42;
+    const auto next = [&seed] {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 33;
+    };
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        std::ostringstream name;
+        name << "IMG_" << std::setw(4) << std::setfill('0') << i % 10000
+             << ((i % 3 == 0) ? ".CR3" : ".JPG");
+        // Include sizes that are exactly half way between hundredths of a MB (multiples of
+        // 0.125 MB) to check the rounding matches
+        const uint64_t size = (i % 97 == 0) ? 131072 * (i % 50) : next() % (80ULL * 1024 * 1024);
+        entries.push_back({ name.str(), size, "2021-02-01 12:34:56",
+            (i % 11 == 0) ? 0 : static_cast<uint32_t>(0xb108 + i % 5),
+            static_cast<uint32_t>(next() % 100000) });
+    }
+
+    return entries;
+}
+
+/// The formatting lscamera used before listing_writer
+void write_with_iostream(std::ostream& out, const std::vector<entry>& entries)
+{
+    const std::string indent = "    ";
+    for (const auto& e : entries)
+    {
+        std::ios::fmtflags f(out.flags());
+        out << std::left << std::showpoint;
+        out << indent << std::setw(12) << e.name << std::setw(8) << std::right
+            << std::setprecision(2) << std::fixed << e.size / (1024.0 * 1024.0) << std::setw(3)
+            << "MB " << std::setw(16) << e.date_time << std::showbase << std::setw(10) << std::hex
+            << e.format << std::noshowbase << std::setw(16) << std::dec << std::setfill(' ')
+            << e.group_id << std::endl;
+        out.flags(f);
+    }
+}
+
+void write_with_listing_writer(std::ostream& out, const std::vector<entry>& entries)
+{
+    const std::string indent = "    ";
+    listing_writer listing(out);
+    for (const auto& e : entries)
+        listing.file(indent, e.name, e.size, e.date_time, e.format, e.group_id);
+}
+
+template <typename F> double time_ms(F f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const std::size_t count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    const auto entries = make_entries(count);
+
+    std::ostringstream iostream_output;
+    std::ostringstream listing_output;
+
+    const double iostream_ms = time_ms([&] { write_with_iostream(iostream_output, entries); });
+    const double listing_ms
+        = time_ms([&] { write_with_listing_writer(listing_output, entries); });
+
+    std::cout << count << " entries: iostream " << std::fixed << std::setprecision(1)
+              << iostream_ms << " ms, listing_writer " << listing_ms << " ms ("
+              << iostream_ms / listing_ms << "x)" << std::endl;
+
+    if (iostream_output.str() != listing_output.str())
+    {
+        std::cerr << "listing_writer output differs from the iostream output" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
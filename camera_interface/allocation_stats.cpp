@@ -0,0 +1,217 @@
+//
+//  allocation_stats.cpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#include "camera_interface.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <new>
+
+#include <sys/resource.h>
+
+namespace
+{
+/// The scope the thread is in. Constant initialised, so it is safe to use from operator new
+/// while the thread is starting or stopping.
+thread_local allocation_counters* current_scope = nullptr;
+
+std::atomic<allocation_counters*> first_scope { nullptr };
+std::atomic<uint64_t> total_allocations { 0 };
+std::atomic<uint64_t> total_bytes { 0 };
+
+#if defined CAMERA_ALLOCATION_STATS
+void count_allocation(std::size_t size)
+{
+    total_allocations.fetch_add(1, std::memory_order_relaxed);
+    total_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    if (auto* scope = current_scope)
+    {
+        scope->allocations.fetch_add(1, std::memory_order_relaxed);
+        scope->bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+void* allocate(std::size_t size, std::size_t alignment = 0)
+{
+    count_allocation(size);
+
+    for (;;)
+    {
+        void* memory = nullptr;
+        if (alignment <= alignof(std::max_align_t))
+            memory = std::malloc(size ? size : 1);
+        else if (posix_memalign(&memory, alignment, size ? size : 1) != 0)
+            memory = nullptr;
+
+        if (memory)
+            return memory;
+
+        const auto handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* allocate_nothrow(std::size_t size, std::size_t alignment = 0) noexcept
+{
+    try
+    {
+        return allocate(size, alignment);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+#endif
+}
+
+allocation_counters::allocation_counters(const char* scope_name)
+    : name(scope_name)
+{
+    next = first_scope.load();
+    while (!first_scope.compare_exchange_weak(next, this))
+    {
+    }
+}
+
+allocation_scope::allocation_scope(allocation_counters& counters)
+    : previous(current_scope)
+{
+    current_scope = &counters;
+}
+
+allocation_scope::~allocation_scope() { current_scope = previous; }
+
+bool allocation_stats_available()
+{
+#if defined CAMERA_ALLOCATION_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void reset_allocation_stats()
+{
+    total_allocations = 0;
+    total_bytes = 0;
+    for (auto* scope = first_scope.load(); scope != nullptr; scope = scope->next)
+    {
+        scope->allocations = 0;
+        scope->bytes = 0;
+    }
+}
+
+std::vector<allocation_scope_stats> get_allocation_stats()
+{
+    if (!allocation_stats_available())
+        return {};
+
+    // Read the totals first, so the allocations made here are not counted
+    const uint64_t allocations = total_allocations;
+    const uint64_t bytes = total_bytes;
+
+    // A scope can be used in several places, each with its own counters
+    std::map<std::string, allocation_scope_stats> scopes;
+    uint64_t scoped_allocations = 0;
+    uint64_t scoped_bytes = 0;
+    for (auto* counters = first_scope.load(); counters != nullptr; counters = counters->next)
+    {
+        const uint64_t scope_allocations = counters->allocations;
+        const uint64_t scope_bytes = counters->bytes;
+        if (scope_allocations == 0)
+            continue;
+
+        auto& scope = scopes[counters->name];
+        scope.scope = counters->name;
+        scope.allocations += scope_allocations;
+        scope.bytes += scope_bytes;
+        scoped_allocations += scope_allocations;
+        scoped_bytes += scope_bytes;
+    }
+
+    std::vector<allocation_scope_stats> result;
+    for (const auto& scope : scopes)
+        result.push_back(scope.second);
+
+    std::sort(result.begin(), result.end(),
+        [](const allocation_scope_stats& a, const allocation_scope_stats& b) {
+            return a.bytes > b.bytes;
+        });
+
+    result.push_back({ "other", allocations - std::min(scoped_allocations, allocations),
+        bytes - std::min(scoped_bytes, bytes) });
+    result.push_back({ "total", allocations, bytes });
+    return result;
+}
+
+uint64_t get_peak_rss()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+#if defined __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss); // bytes
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // KB
+#endif
+}
+
+#if defined CAMERA_ALLOCATION_STATS
+// The replacement allocation functions, which count every heap allocation made by the program
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate_nothrow(size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate_nothrow(size);
+}
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocate_nothrow(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocate_nothrow(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+#endif
@@ -0,0 +1,110 @@
+//
+//  api_stats.cpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#include "api_stats.hpp"
+#include "camera_interface.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+
+namespace implementation
+{
+std::atomic<api_stats*> api_stats::first { nullptr };
+std::atomic<bool> api_stats::enabled_flag { false };
+
+namespace
+{
+    /// The function called by the statement, e.g. "EdsDownload" from "EdsDownload(ref, ...)"
+    std::string function_name(const char* statement)
+    {
+        std::string name(statement);
+        name = name.substr(0, name.find('('));
+        name.erase(std::remove_if(name.begin(), name.end(),
+                       [](unsigned char c) { return std::isspace(c); }),
+            name.end());
+        return name;
+    }
+}
+
+api_stats::api_stats(const char* statement)
+    : function(function_name(statement))
+{
+    next = first.load();
+    while (!first.compare_exchange_weak(next, this))
+    {
+    }
+}
+} // namespace implementation
+
+using implementation::api_stats;
+
+void set_api_stats_enabled(bool enabled) { api_stats::set_enabled(enabled); }
+
+void reset_api_stats()
+{
+    for (auto* stats = api_stats::first.load(); stats != nullptr; stats = stats->next)
+    {
+        stats->calls = 0;
+        stats->total_ns = 0;
+        stats->max_ns = 0;
+        for (auto& bucket : stats->buckets)
+            bucket = 0;
+    }
+}
+
+std::vector<api_call_stats> get_api_stats()
+{
+    struct totals
+    {
+        uint64_t calls = 0;
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+        std::array<uint64_t, api_stats::BUCKETS> buckets {};
+    };
+
+    // A function can be called from several places, each with its own stats
+    std::map<std::string, totals> functions;
+    for (auto* stats = api_stats::first.load(); stats != nullptr; stats = stats->next)
+    {
+        if (stats->calls == 0)
+            continue;
+
+        auto& function = functions[stats->function];
+        function.calls += stats->calls;
+        function.total_ns += stats->total_ns;
+        function.max_ns = std::max<uint64_t>(function.max_ns, stats->max_ns);
+        for (int i = 0; i < api_stats::BUCKETS; i++)
+            function.buckets[i] += stats->buckets[i];
+    }
+
+    std::vector<api_call_stats> result;
+    for (const auto& [name, function] : functions)
+    {
+        const auto percentile = [&function](double p) {
+            const auto rank = std::max<uint64_t>(
+                static_cast<uint64_t>(p / 100.0 * static_cast<double>(function.calls)), 1);
+            uint64_t seen = 0;
+            for (int i = 0; i < api_stats::BUCKETS; i++)
+            {
+                seen += function.buckets[i];
+                if (seen >= rank)
+                    return std::chrono::nanoseconds(
+                        std::min(api_stats::bucket_limit(i), function.max_ns));
+            }
+            return std::chrono::nanoseconds(function.max_ns);
+        };
+
+        result.push_back({ name, function.calls, percentile(50), percentile(99),
+            std::chrono::nanoseconds(function.max_ns),
+            std::chrono::nanoseconds(function.total_ns) });
+    }
+
+    std::sort(result.begin(), result.end(),
+        [](const api_call_stats& a, const api_call_stats& b) { return a.total > b.total; });
+    return result;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "trace.hpp"
+
+namespace implementation
+{
+/// Call count and latency histogram for one SDK call site. Every counter is updated with relaxed
+/// atomic adds, so timing a call costs two clock reads and a few uncontended atomic operations.
+/// Each power of two of nanoseconds is split into 4 buckets, so percentiles are within 25%.
+class api_stats
+{
+public:
+    static constexpr int SUB_BUCKETS = 4;
+    static constexpr int BUCKETS = 64 * SUB_BUCKETS;
+
+    /// statement is the call as written (e.g. "EdsDownload(ref, size, stream)")
+    explicit api_stats(const char* statement);
+
+    api_stats(const api_stats&) = delete;
+    api_stats& operator=(const api_stats&) = delete;
+
+    static bool enabled() { return enabled_flag.load(std::memory_order_relaxed); }
+    static void set_enabled(bool enable) { enabled_flag.store(enable, std::memory_order_relaxed); }
+
+    void record(std::chrono::nanoseconds latency)
+    {
+        const uint64_t ns = (latency.count() > 0) ? static_cast<uint64_t>(latency.count()) : 0;
+
+        calls.fetch_add(1, std::memory_order_relaxed);
+        total_ns.fetch_add(ns, std::memory_order_relaxed);
+        buckets[bucket_for(ns)].fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t previous = max_ns.load(std::memory_order_relaxed);
+        while (ns > previous
+            && !max_ns.compare_exchange_weak(previous, ns, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    static int bucket_for(uint64_t ns)
+    {
+        if (ns < SUB_BUCKETS)
+            return static_cast<int>(ns);
+
+        const int top_bit = 63 - __builtin_clzll(ns);
+        return (top_bit - 1) * SUB_BUCKETS + static_cast<int>((ns >> (top_bit - 2)) & 3);
+    }
+
+    /// The largest latency that goes in the bucket
+    static uint64_t bucket_limit(int bucket)
+    {
+        if (bucket < SUB_BUCKETS)
+            return static_cast<uint64_t>(bucket);
+
+        const int top_bit = bucket / SUB_BUCKETS + 1;
+        const uint64_t step = uint64_t(1) << (top_bit - 2);
+        return (SUB_BUCKETS + static_cast<uint64_t>(bucket % SUB_BUCKETS)) * step + step - 1;
+    }
+
+    const std::string function;
+    std::atomic<uint64_t> calls { 0 };
+    std::atomic<uint64_t> total_ns { 0 };
+    std::atomic<uint64_t> max_ns { 0 };
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets {};
+
+    /// All the call sites, in a list that is only ever added to
+    api_stats* next = nullptr;
+    static std::atomic<api_stats*> first;
+
+private:
+    static std::atomic<bool> enabled_flag;
+};
+
+/// Times a call while it is in scope, if stats are enabled, and records it in the trace if
+/// tracing is enabled
+class api_timer
+{
+    api_stats& stats;
+    const bool timing;
+    const bool tracing;
+    std::chrono::steady_clock::time_point started;
+
+public:
+    explicit api_timer(api_stats& call_stats)
+        : stats(call_stats)
+        , timing(api_stats::enabled())
+        , tracing(trace_recorder::enabled())
+    {
+        if (timing || tracing)
+            started = std::chrono::steady_clock::now();
+    }
+
+    ~api_timer()
+    {
+        if (!timing && !tracing)
+            return;
+
+        const auto finished = std::chrono::steady_clock::now();
+        if (timing)
+            stats.record(finished - started);
+        if (tracing)
+            trace_recorder::record("sdk", stats.function.c_str(), started, finished);
+    }
+};
+} // namespace implementation
+
+/// Make an SDK call, timing it against the stats for this call site
+#define TIME_EDS_CALL(stmt)                                                                        \
+    ([&] {                                                                                         \
+        static implementation::api_stats call_stats(#stmt);                                        \
+        const implementation::api_timer call_timer(call_stats);                                    \
+        return stmt;                                                                               \
+    }())
@@ -24,7 +24,9 @@
 #include "Poco/Logger.h"
 
 #include "properties.hpp"
+#include "property_table.hpp"
 
+#include <array>
 #include <string>
 using namespace std::string_literals;
 
@@ -32,69 +34,94 @@ namespace implementation
 {
 static const std::string UNKNOWN = "<Unknown>"s;
 
-static std::string format_battery_level(EdsUInt32 level)
-{
-    if (level != 0xffffffff)
-        return std::to_string(level) + "%";
-    return "AC power";
-}
+const std::array<EdsPropertyID, 16> impl_camera_info::property_ids = { kEdsPropID_ProductName,
+    kEdsPropID_BodyIDEx, kEdsPropID_OwnerName, kEdsPropID_MakerName, kEdsPropID_DateTime,
+    kEdsPropID_FirmwareVersion, kEdsPropID_BatteryLevel, kEdsPropID_BatteryQuality,
+    kEdsPropID_SaveTo, kEdsPropID_CurrentStorage, kEdsPropID_CurrentFolder, kEdsPropID_LensStatus,
+    kEdsPropID_LensName, kEdsPropID_Artist, kEdsPropID_Copyright, kEdsPropID_AvailableShots };
 
-static std::string format_save_to(EdsUInt32 save_to_code)
+impl_camera_info::impl_camera_info(camera_ref_lock<EdsCameraRef> ref)
+    : lens_status(false)
+    , available_shots(0)
 {
-    std::string result;
-
-    if (save_to_code & 1)
-        result += "Memory Card"s;
-
-    if (save_to_code & 2)
+    if (is_property_available(ref.get_ref(), kEdsPropID_UTCTime))
     {
-        if (!result.empty())
-            result += ", "s;
-
-        result += "Host Computer"s;
+        CAMERA_LOG(camera_info_log, notice, "UTCTime is available but not used");
     }
 
-    return result;
+    for (const auto id : property_ids)
+        read_property(ref.get_ref(), id);
 }
 
-impl_camera_info::impl_camera_info(camera_ref_lock<EdsCameraRef> ref)
+void impl_camera_info::read_property(EdsCameraRef ref, EdsPropertyID id)
 {
-    product_name = (is_property_available(ref.get_ref(), kEdsPropID_ProductName))
-        ? get_camera_property_string(ref.get_ref(), kEdsPropID_ProductName)
-        : UNKNOWN;
-    body_ID_ex = (is_property_available(ref.get_ref(), kEdsPropID_BodyIDEx))
-        ? get_camera_property_string(ref.get_ref(), kEdsPropID_BodyIDEx)
-        : UNKNOWN;
-    owner_name = (is_property_available(ref.get_ref(), kEdsPropID_OwnerName))
-        ? get_camera_property_string(ref.get_ref(), kEdsPropID_OwnerName)
-        : UNKNOWN;
-    maker_name = is_property_available(ref.get_ref(), kEdsPropID_MakerName)
-        ? get_camera_property_string(ref.get_ref(), kEdsPropID_MakerName)
-        : UNKNOWN;
-
-    if (is_property_available(ref.get_ref(), kEdsPropID_UTCTime))
+    switch (id)
     {
-        Poco::Logger::get("camera_info").notice("UTCTime is available but not used");
+    case kEdsPropID_ProductName:
+        product_name = (is_property_available(ref, kEdsPropID_ProductName))
+            ? get_camera_property_string(ref, kEdsPropID_ProductName)
+            : UNKNOWN;
+        break;
+    case kEdsPropID_BodyIDEx:
+        body_ID_ex = (is_property_available(ref, kEdsPropID_BodyIDEx))
+            ? get_camera_property_string(ref, kEdsPropID_BodyIDEx)
+            : UNKNOWN;
+        break;
+    case kEdsPropID_OwnerName:
+        owner_name = (is_property_available(ref, kEdsPropID_OwnerName))
+            ? get_camera_property_string(ref, kEdsPropID_OwnerName)
+            : UNKNOWN;
+        break;
+    case kEdsPropID_MakerName:
+        maker_name = is_property_available(ref, kEdsPropID_MakerName)
+            ? get_camera_property_string(ref, kEdsPropID_MakerName)
+            : UNKNOWN;
+        break;
+    case kEdsPropID_DateTime:
+        date_time = is_property_available(ref, kEdsPropID_DateTime)
+            ? Poco::DateTimeFormatter::format(
+                get_camera_property_datetime(ref, kEdsPropID_DateTime), "%d-%b-%Y %H:%M:%S"s)
+            : UNKNOWN;
+        break;
+    case kEdsPropID_FirmwareVersion:
+        firmware_version = get_camera_property_string(ref, kEdsPropID_FirmwareVersion);
+        break;
+    case kEdsPropID_BatteryLevel:
+        battery_level
+            = format_battery_level(get_camera_property_int32(ref, kEdsPropID_BatteryLevel));
+        break;
+    case kEdsPropID_BatteryQuality:
+        battery_quality = is_property_available(ref, kEdsPropID_BatteryQuality)
+            ? std::to_string(get_camera_property_uint32(ref, kEdsPropID_BatteryQuality))
+            : UNKNOWN;
+        break;
+    case kEdsPropID_SaveTo:
+        save_to = format_save_to(get_camera_property_uint32(ref, kEdsPropID_SaveTo));
+        break;
+    case kEdsPropID_CurrentStorage:
+        current_storage = get_camera_property_string(ref, kEdsPropID_CurrentStorage);
+        break;
+    case kEdsPropID_CurrentFolder:
+        current_folder = get_camera_property_string(ref, kEdsPropID_CurrentFolder);
+        break;
+    case kEdsPropID_LensStatus:
+        lens_status = get_camera_property_uint32(ref, kEdsPropID_LensStatus) != 0;
+        break;
+    case kEdsPropID_LensName:
+        lens_name = get_camera_property_string(ref, kEdsPropID_LensName);
+        break;
+    case kEdsPropID_Artist:
+        artist = get_camera_property_string(ref, kEdsPropID_Artist);
+        break;
+    case kEdsPropID_Copyright:
+        copyright = get_camera_property_string(ref, kEdsPropID_Copyright);
+        break;
+    case kEdsPropID_AvailableShots:
+        available_shots = get_camera_property_uint32(ref, kEdsPropID_AvailableShots);
+        break;
+    default:
+        break;
     }
-    date_time = is_property_available(ref.get_ref(), kEdsPropID_DateTime)
-        ? Poco::DateTimeFormatter::format(
-            get_camera_property_datetime(ref.get_ref(), kEdsPropID_DateTime), "%d-%b-%Y %H:%M:%S"s)
-        : UNKNOWN;
-    firmware_version = get_camera_property_string(ref.get_ref(), kEdsPropID_FirmwareVersion);
-    battery_level
-        = format_battery_level(get_camera_property_int32(ref.get_ref(), kEdsPropID_BatteryLevel));
-    battery_quality = is_property_available(ref.get_ref(), kEdsPropID_BatteryQuality)
-        ? std::to_string(get_camera_property_uint32(ref.get_ref(), kEdsPropID_BatteryQuality))
-        : UNKNOWN;
-    save_to = format_save_to(get_camera_property_uint32(ref.get_ref(), kEdsPropID_SaveTo));
-    current_storage = get_camera_property_string(ref.get_ref(), kEdsPropID_CurrentStorage);
-    current_folder = get_camera_property_string(ref.get_ref(), kEdsPropID_CurrentFolder);
-    lens_status = get_camera_property_uint32(ref.get_ref(), kEdsPropID_LensStatus) != 0;
-    lens_name = get_camera_property_string(ref.get_ref(), kEdsPropID_LensName);
-    artist = get_camera_property_string(ref.get_ref(), kEdsPropID_Artist);
-    copyright = get_camera_property_string(ref.get_ref(), kEdsPropID_Copyright);
-
-    available_shots = get_camera_property_uint32(ref.get_ref(), kEdsPropID_AvailableShots);
 }
 
 impl_camera_info::~impl_camera_info() noexcept { }
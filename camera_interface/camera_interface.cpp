@@ -40,8 +40,19 @@ impl_camera_connection::impl_camera_connection()
 
 impl_camera_connection::~impl_camera_connection()
 {
+    if (events)
+    {
+        // Wait for a camera_added call running on the event thread to finish
+        const auto holding = events->hold_events();
+        TIME_EDS_CALL(EdsSetCameraAddedHandler(nullptr, nullptr));
+    }
+
+    // Stop dispatching events before the SDK goes away
+    events.reset();
+    cameras.reset();
+
     // Tidyup SDK
-    EdsTerminateSDK();
+    TIME_EDS_CALL(EdsTerminateSDK());
 }
 
 std::shared_ptr<camera_ref> impl_camera_connection::select_camera(size_type camera_number)
@@ -49,6 +60,11 @@ std::shared_ptr<camera_ref> impl_camera_connection::select_camera(size_type came
     return cameras->at(camera_number);
 }
 
+std::shared_ptr<camera_ref> impl_camera_connection::open_camera(size_type camera_number)
+{
+    return cameras->open_camera(camera_number);
+}
+
 camera_connection::size_type impl_camera_connection::number_of_cameras() const
 {
     return cameras->size();
@@ -60,5 +76,46 @@ void impl_camera_connection::deselect_camera(std::shared_ptr<camera_ref>& camera
     camera.reset();
 }
 
+std::shared_ptr<const connection_info> impl_camera_connection::get_connection_info(
+    size_type camera_number) const
+{
+    return cameras->get_connection_info(camera_number);
+}
+
+void impl_camera_connection::refresh() { cameras->refresh(); }
+
+void impl_camera_connection::set_keep_sessions_open(bool keep)
+{
+    cameras->set_keep_sessions_open(keep);
+}
+
+void impl_camera_connection::set_camera_added_handler(std::function<void()> handler)
+{
+    const bool enable = static_cast<bool>(handler);
+    {
+        std::lock_guard<std::mutex> lock(handler_mutex);
+        camera_added_handler = std::move(handler);
+    }
+
+    THROW_ERRORS(EdsSetCameraAddedHandler(enable ? camera_added : nullptr, enable ? this : nullptr),
+        "camera_connection", "Failed to set camera added handler");
+
+    if (enable && !events)
+        events = impl_event_pump::acquire();
+}
+
+EdsError EDSCALLBACK impl_camera_connection::camera_added(EdsVoid* context)
+{
+    auto connection = static_cast<impl_camera_connection*>(context);
+
+    CAMERA_LOG(camera_connection_log, debug, "Camera added");
+
+    std::lock_guard<std::mutex> lock(connection->handler_mutex);
+    if (connection->camera_added_handler)
+        connection->camera_added_handler();
+
+    return EDS_ERR_OK;
+}
+
 
 } // namespace implementation
@@ -8,13 +8,25 @@
 #ifndef camera_interface_
 #define camera_interface_
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <ostream>
 #include <regex>
 #include <string>
+#include <variant>
+#include <vector>
+
+#include "gsl/span"
 
 /* The classes below are exported */
 #pragma GCC visibility push(default)
 
+#include "directory_entry.hpp"
 #include "eds_exception.hpp"
 
 class connection_info
@@ -45,11 +57,66 @@ public:
     virtual size_t get_available_shots() const = 0;
 };
 
+/// Camera info that is kept up to date while the camera is connected
+class live_camera_info
+{
+public:
+    /// Get a consistent snapshot of the camera info. Only the properties that the camera has
+    /// reported as changed since the last snapshot are read again.
+    virtual std::shared_ptr<const camera_info> get_snapshot() = 0;
+    virtual ~live_camera_info() {};
+};
+
+/// The value of a single camera property as read by camera_ref::read_properties
+struct property_value
+{
+    typedef uint32_t property_id_t;
+    /// std::monostate when the property is not available on the camera
+    typedef std::variant<std::monostate, std::string, int32_t, uint32_t, std::tm> value_t;
+
+    property_id_t id;
+    value_t value;
+    /// Why the property could not be read (e.g. the camera was busy, or the id is not a known
+    /// property), in which case the value is std::monostate. Not set when the camera simply does
+    /// not have the property.
+    std::optional<eds_error> error = std::nullopt;
+
+    bool is_available() const { return !std::holds_alternative<std::monostate>(value); }
+    /// Format the value for display using the property's descriptor
+    std::string to_string() const;
+};
+
+/// Describes one of the camera properties which can be read with camera_ref::read_properties
+struct property_descriptor
+{
+    enum class type_t
+    {
+        string,
+        int32,
+        uint32,
+        date_time
+    };
+
+    property_value::property_id_t id;
+    const char* key;   ///< Stable, machine readable name (e.g. "battery_level")
+    const char* label; ///< Human readable name (e.g. "Battery Level")
+    type_t type;
+    std::string (*format)(const property_value& value);
+};
+
+/// Get the descriptors of every property known to the library
+gsl::span<const property_descriptor> get_property_descriptors();
+/// Find a property descriptor by id or key. Returns nullptr if the property is not known
+const property_descriptor* find_property_descriptor(property_value::property_id_t id);
+const property_descriptor* find_property_descriptor(const std::string& key);
+
 class directory_ref
 {
 public:
     typedef std::size_t size_type;
     typedef uint32_t format_t;
+    /// Receives a file's contents a block at a time, e.g. to hash them
+    typedef std::function<void(const uint8_t* data, std::size_t size)> download_observer;
 
     virtual size_type get_file_size() const = 0;
     virtual format_t get_format() const = 0;
@@ -58,6 +125,10 @@ public:
     virtual std::time_t get_timestamp() const = 0;
     virtual uint32_t get_group_ID() const = 0;
     virtual void download_to(std::string destination) const = 0;
+    /// Delete the file from the card. The directory_ref can not be used afterwards.
+    virtual void delete_file() = 0;
+    /// Download the thumbnail of the file, as JPEG data
+    virtual std::vector<uint8_t> download_thumbnail() const = 0;
 
     virtual bool is_a_folder() const = 0;
     virtual size_type get_directory_count() const = 0;
@@ -65,6 +136,28 @@ public:
         size_type directory_entry_number) const = 0;
 
     virtual std::shared_ptr<directory_ref> find_directory(std::string image_folder) const = 0;
+
+    /// get_directory_entry and download_to returning SDK errors instead of throwing them, so a
+    /// loop over many files can retry a busy camera or skip a file cheaply
+    virtual eds_result<std::shared_ptr<directory_ref>> try_get_directory_entry(
+        size_type directory_entry_number) const
+    {
+        return catch_eds_error([&] { return get_directory_entry(directory_entry_number); },
+            "Failed to get directory entry");
+    }
+
+    virtual eds_result<void> try_download_to(std::string destination) const
+    {
+        return catch_eds_error(
+            [&] { download_to(std::move(destination)); }, "Failed to download file");
+    }
+
+    /// try_download_to, passing the contents of the original to observer. A camera's file is
+    /// passed as each block arrives from the camera, before it is written, so hashing what
+    /// observer is given and what was written shows whether the copy can replace the original.
+    /// If the download is tried again, observer is given the file again from the start.
+    virtual eds_result<void> try_download_observed(
+        std::string destination, const download_observer& observer) const = 0;
 };
 
 class volume_ref
@@ -88,10 +181,13 @@ public:
         unknown
     };
 
-    /// Get the capacity of the volume (in KB)
+    /// Get the capacity of the volume (in KB). Cameras, card readers and the simulator all report
+    /// sizes in KB.
     virtual uint64_t get_max_capacity() const = 0;
     /// Get the free space on the volume (in KB)
     virtual uint64_t get_free_space() const = 0;
+    /// Read the free space from the camera again (a single SDK call) and return it (in KB)
+    virtual uint64_t read_free_space() = 0;
     virtual std::string get_label() const = 0;
     virtual storage_type_t get_storage_type() const = 0;
     virtual access_type_t get_access() const = 0;
@@ -102,33 +198,256 @@ public:
     virtual std::vector<std::shared_ptr<directory_ref>> find_matching_files(
         std::string image_folder, std::regex filename_expression)
         = 0;
+
+    /// select_directory returning SDK errors instead of throwing them
+    virtual eds_result<std::shared_ptr<directory_ref>> try_select_directory(
+        size_type directory_number)
+    {
+        return catch_eds_error(
+            [&] { return select_directory(directory_number); }, "Failed to select directory");
+    }
+};
+
+/// A live view frame. The JPEG data points into the live view's buffer, so it is only valid
+/// until the consumer returns.
+struct live_view_frame
+{
+    uint64_t sequence; ///< Frames are numbered from 1
+    gsl::span<const uint8_t> jpeg;
+    std::chrono::steady_clock::time_point captured_at;
+    /// Time taken to download the frame from the camera
+    std::chrono::microseconds latency;
+};
+
+struct live_view_stats
+{
+    uint64_t frames;
+    double frames_per_second;
+    std::chrono::microseconds mean_latency;
+    std::chrono::microseconds max_latency;
+};
+
+/// Live view (EVF) from a camera. Frames are downloaded on a separate thread into a ring buffer
+/// until the live_view is stopped or destroyed.
+class live_view
+{
+public:
+    typedef std::function<void(const live_view_frame&)> consumer_t;
+
+    /// Wait for a frame newer than after_sequence and pass the newest frame to consumer. Frames
+    /// are skipped if the consumer is slower than the camera. Returns false if there is no new
+    /// frame before the timeout or live view has stopped.
+    virtual bool next_frame(
+        uint64_t after_sequence, std::chrono::milliseconds timeout, const consumer_t& consumer)
+        = 0;
+    virtual live_view_stats get_stats() const = 0;
+    virtual void stop() = 0;
+    virtual ~live_view() {};
 };
 
 class camera_ref
 {
 public:
     typedef uint32_t size_type;
+    typedef std::function<void(std::shared_ptr<directory_ref>)> object_created_handler_t;
 
     virtual std::shared_ptr<const connection_info> get_connection_info() const = 0;
     virtual std::shared_ptr<camera_info> get_camera_info() = 0;
+    virtual std::shared_ptr<live_camera_info> get_live_camera_info() = 0;
+    /// Read a set of properties in a single pass, on the calling thread. The result is in the same
+    /// order as the ids. A property that can not be read has its error set and the rest are still
+    /// read; only the camera going away stops the pass, which throws
+    /// camera_disconnected_exception.
+    virtual std::vector<property_value> read_properties(
+        gsl::span<const property_value::property_id_t> ids)
+        = 0;
+    /// read_properties returning the camera going away as an error instead of throwing it.
+    virtual eds_result<std::vector<property_value>> try_read_properties(
+        gsl::span<const property_value::property_id_t> ids)
+    {
+        return catch_eds_error([&] { return read_properties(ids); }, "Failed to read properties");
+    }
     virtual size_type get_volume_count() const = 0;
     virtual std::shared_ptr<volume_ref> select_volume(size_type volume_number) = 0;
 
     virtual void set_ui_status(bool enabled) = 0;
+
+    /// Set the handler called when the camera creates a file (e.g. a picture has been taken) or
+    /// asks for one to be transferred. Each file is passed once, even when the camera sends both
+    /// events for it. The handler is called on the event thread, so it should only queue work
+    /// for another thread. Pass nullptr to remove it.
+    virtual void set_object_created_handler(object_created_handler_t handler) = 0;
+
+    /// Start live view, sending the camera's live view to the computer. buffer_frames is the
+    /// number of frames kept in the ring buffer.
+    virtual std::unique_ptr<live_view> start_live_view(std::size_t buffer_frames = 4) = 0;
 };
 
+/// The cameras connected to the computer. number_of_cameras(), get_connection_info(),
+/// open_camera() and refresh() can be called from several threads at once, as the list of cameras
+/// is only used by one of them at a time. There is only one selected camera, so select_camera()
+/// and deselect_camera() should only be used from one thread. Each camera_ref should only be used
+/// by one thread at a time.
 class camera_connection
 {
 public:
     typedef int32_t size_type;
 
     virtual size_type number_of_cameras() const = 0;
+    /// Open a session with a camera and make it the selected camera, replacing any camera that
+    /// was selected before
     virtual std::shared_ptr<camera_ref> select_camera(size_type camera_number) = 0;
+    /// Open a session with a camera without selecting it, so several cameras can be open at once
+    /// (e.g. one for each thread). The session is closed when the camera_ref is released; it is
+    /// not passed to deselect_camera().
+    virtual std::shared_ptr<camera_ref> open_camera(size_type camera_number) = 0;
     virtual void deselect_camera(std::shared_ptr<camera_ref>& camera) = 0;
+    /// Get the connection details of a camera without opening a session with it
+    virtual std::shared_ptr<const connection_info> get_connection_info(size_type camera_number) const
+        = 0;
+
+    /// Re-read the list of connected cameras (e.g. after a camera has been added)
+    virtual void refresh() = 0;
+
+    /// Set the handler called when a camera is connected. The handler is called on the event
+    /// thread, so it should only queue work for another thread. Pass nullptr to remove it.
+    virtual void set_camera_added_handler(std::function<void()> handler) = 0;
+
+    /// Keep the session with each camera open once it has been selected, so selecting it again is
+    /// immediate (e.g. in a long running process). Sessions are closed by refresh() when the
+    /// camera has gone away, or when keeping them is turned off.
+    virtual void set_keep_sessions_open(bool keep) = 0;
+
     virtual ~camera_connection() {};
 };
 
 std::unique_ptr<camera_connection> get_camera_connection();
 
+/// Open a card in a card reader, mounted at mount_point (the folder with DCIM in it), as a volume.
+/// The files are read directly, so no camera or SDK is needed, and downloads are copied by the
+/// kernel where it can. Files on a card reader have no thumbnails.
+std::shared_ptr<volume_ref> open_mounted_volume(const std::string& mount_point);
+
+struct api_call_stats
+{
+    std::string function;
+    uint64_t calls;
+    std::chrono::nanoseconds p50;
+    std::chrono::nanoseconds p99;
+    std::chrono::nanoseconds max;
+    std::chrono::nanoseconds total;
+};
+
+/// Time every SDK call made by the library. This is off by default; when on it adds a few tens
+/// of nanoseconds to each call.
+void set_api_stats_enabled(bool enabled);
+void reset_api_stats();
+/// The calls timed so far for each SDK function, most total time first. The percentiles are
+/// approximate (within 25%).
+std::vector<api_call_stats> get_api_stats();
+
+/// Record a timeline of every SDK call, and of the spans marked with trace_span, into a buffer
+/// per thread. This is off by default; when on, each span costs two clock reads and an
+/// uncontended lock.
+void set_trace_enabled(bool enabled);
+/// Write the spans recorded so far as Chrome trace event JSON, which can be opened in Perfetto
+/// (ui.perfetto.dev) or chrome://tracing, and clear them
+void write_trace(std::ostream& out);
+/// Name the calling thread in the trace
+void set_trace_thread_name(const std::string& name);
+
+/// Records the time from its construction to its destruction, on the calling thread, as a span in
+/// the trace, if tracing was enabled when it was constructed. category and name must outlive the
+/// trace (e.g. string literals); detail can be anything, e.g. a file name.
+class trace_span
+{
+    const char* category;
+    const char* name;
+    const bool recording;
+    std::string detail;
+    std::chrono::steady_clock::time_point started;
+
+public:
+    trace_span(const char* span_category, const char* span_name, std::string span_detail = {});
+    ~trace_span();
+
+    trace_span(const trace_span&) = delete;
+    trace_span& operator=(const trace_span&) = delete;
+};
+
+enum class developed_format
+{
+    jpeg,
+    tiff,
+    tiff16
+};
+
+/// Develop a raw image file (e.g. a CR2 file) with the SDK's raw processing and save it as an
+/// 8 bit JPEG or an 8 or 16 bit TIFF. No camera is needed, but the SDK must have been initialised
+/// by get_camera_connection().
+void develop_raw_image(
+    const std::string& source, const std::string& destination, developed_format format);
+
+/// Heap allocations made inside ALLOCATION_SCOPE(name) scopes with the same name. Scopes named
+/// "total" and "other" hold every allocation and those made outside any scope.
+struct allocation_scope_stats
+{
+    std::string scope;
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+/// Counts the allocations made on the threads that are inside a scope. Only used through
+/// ALLOCATION_SCOPE.
+class allocation_counters
+{
+public:
+    explicit allocation_counters(const char* scope_name);
+
+    allocation_counters(const allocation_counters&) = delete;
+    allocation_counters& operator=(const allocation_counters&) = delete;
+
+    const char* const name;
+    std::atomic<uint64_t> allocations { 0 };
+    std::atomic<uint64_t> bytes { 0 };
+
+    /// All the scopes, in a list that is only ever added to
+    allocation_counters* next = nullptr;
+};
+
+/// Counts the allocations made by the calling thread against counters while it is in scope.
+/// Scopes nest; allocations are counted against the innermost one.
+class allocation_scope
+{
+    allocation_counters* const previous;
+
+public:
+    explicit allocation_scope(allocation_counters& counters);
+    ~allocation_scope();
+
+    allocation_scope(const allocation_scope&) = delete;
+    allocation_scope& operator=(const allocation_scope&) = delete;
+};
+
+/// Count the heap allocations made in the rest of the enclosing block against the named scope
+/// (e.g. "enumeration"). This is only compiled in to instrumentation builds (configured with
+/// -DALLOCATION_STATS=ON), which replace operator new; otherwise it does nothing.
+#if defined CAMERA_ALLOCATION_STATS
+#define ALLOCATION_SCOPE(scope_name)                                                               \
+    static allocation_counters allocation_scope_counters(scope_name);                              \
+    const allocation_scope allocation_scope_guard(allocation_scope_counters)
+#else
+#define ALLOCATION_SCOPE(scope_name)
+#endif
+
+/// Whether this is an instrumentation build, which counts heap allocations
+bool allocation_stats_available();
+void reset_allocation_stats();
+/// The allocations counted so far for each scope, most bytes first. Empty unless
+/// allocation_stats_available().
+std::vector<allocation_scope_stats> get_allocation_stats();
+/// The most memory (resident set size) the process has used, in bytes
+uint64_t get_peak_rss();
+
 #pragma GCC visibility pop
 #endif
@@ -5,9 +5,21 @@
 //  Created by Rob McKay on 08/01/2021.
 //
 
+#include "api_stats.hpp"
 #include "camera_interface.hpp"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+#include <utility>
 
 // Ensure that __MACOS__ is defined when compiling for macOS. (required for EDSDK.h)
 #if !defined __MACOS__
@@ -19,8 +31,8 @@
 #include "EDSDK.h"
 #include "Poco/Format.h"
 #include "Poco/LocalDateTime.h"
-#include "Poco/Logger.h"
 #include "int_to_hex.hpp"
+#include "logging.hpp"
 
 /* The classes below are not exported */
 #pragma GCC visibility push(hidden)
@@ -44,7 +56,11 @@ public:
         EdsRetain(ref);
     }
 
-    camera_ref_lock(camera_ref_lock<ref_class>&& other) { std::swap(ref, other.ref); }
+    camera_ref_lock(camera_ref_lock<ref_class>&& other)
+        : ref(nullptr)
+    {
+        std::swap(ref, other.ref);
+    }
 
     camera_ref_lock& operator=(const camera_ref_lock<ref_class>& other) = delete;
     camera_ref_lock& operator=(camera_ref_lock<ref_class>&& other)
@@ -80,47 +96,153 @@ public:
     std::string get_desc() const override;
 };
 
+camera_ref_lock<EdsStreamRef> create_memory_stream();
+camera_ref_lock<EdsImageRef> create_image_ref(EdsStreamRef stream);
+
 class thumbnail
 {
     Poco::LocalDateTime date_time;
+    std::vector<uint8_t> data;
 
 public:
-    thumbnail(EdsDirectoryItemRef);
+    /// keep_data keeps the downloaded JPEG, otherwise only the date stamp is kept
+    thumbnail(EdsDirectoryItemRef, bool keep_data = false);
     Poco::LocalDateTime get_date_stamp() { return date_time; }
+    const std::vector<uint8_t>& get_data() const { return data; }
+};
+
+/// Tracks the downloads in progress from a camera, so they can be cancelled as soon as the camera
+/// is disconnected or shut down rather than waiting for the SDK to time out.
+class impl_transfer_state
+{
+    std::mutex mutex;
+    std::set<EdsDirectoryItemRef> in_flight;
+    std::atomic<bool> disconnected { false };
+
+public:
+    /// Record the start of a download. Returns false if the camera has been disconnected.
+    bool begin(EdsDirectoryItemRef item);
+    void end(EdsDirectoryItemRef item);
+    bool is_transferring(EdsDirectoryItemRef item);
+    bool has_transfers();
+
+    /// Mark the camera as disconnected and cancel every download in progress
+    void cancel_all();
+    bool is_disconnected() const { return disconnected; }
+};
+
+/// Owns one SDK reference to a directory item. It is moved rather than copied, so handing an
+/// item on costs no EdsRetain/EdsRelease pair.
+class eds_item_ref
+{
+    EdsDirectoryItemRef ref;
+
+public:
+    /// Take over the reference returned by the SDK (e.g. by EdsGetChildAtIndex)
+    explicit eds_item_ref(EdsDirectoryItemRef adopted)
+        : ref(adopted)
+    {
+    }
+
+    eds_item_ref(eds_item_ref&& other) noexcept
+        : ref(std::exchange(other.ref, nullptr))
+    {
+    }
+
+    eds_item_ref& operator=(eds_item_ref&& other) noexcept
+    {
+        std::swap(ref, other.ref);
+        return *this;
+    }
+
+    eds_item_ref(const eds_item_ref&) = delete;
+    eds_item_ref& operator=(const eds_item_ref&) = delete;
+
+    ~eds_item_ref()
+    {
+        if (ref != nullptr)
+            EdsRelease(ref);
+    }
+
+    /// Add a reference to an item the SDK still owns, e.g. one passed to an event handler
+    static eds_item_ref retain(EdsDirectoryItemRef item)
+    {
+        EdsRetain(item);
+        return eds_item_ref(item);
+    }
+
+    EdsDirectoryItemRef get_ref() const { return ref; }
+
+    /// Give up the reference without releasing it, e.g. when the SDK has released it
+    EdsDirectoryItemRef release() { return std::exchange(ref, nullptr); }
+};
+
+/// Files and folders on a camera, read with the SDK. Downloads go through impl_directory_ref,
+/// which tracks them so they can be cancelled when the camera is disconnected.
+struct eds_backend
+{
+    typedef eds_item_ref handle_type;
+    typedef basic_directory_entry<eds_backend> entry_type;
+
+    /// Read the details of item, or the error reading them
+    static eds_result<entry_type> open(eds_item_ref item);
+    /// The entry at index in the folder or volume parent, or the error getting it
+    static eds_result<entry_type> try_open_child(
+        EdsBaseRef parent, std::size_t index, const char* message);
+
+    static entry_type open_child(const handle_type& folder, std::size_t index);
+    static std::optional<entry_type> find_directory(
+        const entry_type& folder, const std::string& name);
+    static std::vector<entry_type> find_matching_entries(
+        const entry_type& folder, const std::regex& filename_expression);
+    static void delete_file(handle_type& file);
 };
 
+typedef basic_directory_entry<eds_backend> eds_entry;
+
+/// A file or folder on a camera, adapting an eds_entry to directory_ref
 class impl_directory_ref : public directory_ref
 {
-    camera_ref_lock<EdsDirectoryItemRef> ref;
-    size_type file_size;
-    format_t format;
-    std::string name;
-    bool is_folder;
-    uint32_t group_id;
-    volume_ref::size_type count;
+    /// try_download_observed downloads a file in blocks of this size. The SDK needs each block
+    /// but the last to be a multiple of 512 bytes.
+    static constexpr uint64_t download_block_size = 4 * 1024 * 1024;
+
+    eds_entry entry;
+    std::shared_ptr<impl_transfer_state> transfers;
+
+    /// Finish a download that returned download_err, cancelling it if it failed
+    eds_result<void> end_download(EdsDirectoryItemRef item, EdsError download_err) const;
 
 public:
-    impl_directory_ref(EdsDirectoryItemRef r);
+    impl_directory_ref(eds_entry item, std::shared_ptr<impl_transfer_state> transfers);
     virtual ~impl_directory_ref();
 
-    size_type get_file_size() const override { return file_size; }
-    format_t get_format() const override { return format; }
-    std::string get_name() const override { return name; }
-    bool is_a_folder() const override { return is_folder; };
+    size_type get_file_size() const override { return entry.get_file_size(); }
+    format_t get_format() const override { return entry.get_format(); }
+    std::string get_name() const override { return entry.get_name(); }
+    bool is_a_folder() const override { return entry.is_a_folder(); };
     std::string get_date_time() const override;
     std::time_t get_timestamp() const override;
-    uint32_t get_group_ID() const override { return group_id; }
+    uint32_t get_group_ID() const override { return entry.get_group_ID(); }
     void download_to(std::string destination) const override;
+    eds_result<void> try_download_to(std::string destination) const override;
+    eds_result<void> try_download_observed(
+        std::string destination, const download_observer& observer) const override;
+    void delete_file() override;
+    std::vector<uint8_t> download_thumbnail() const override;
 
     volume_ref::size_type get_directory_count() const override;
     std::shared_ptr<directory_ref> get_directory_entry(
         volume_ref::size_type directory_entry_number) const override;
+    eds_result<std::shared_ptr<directory_ref>> try_get_directory_entry(
+        volume_ref::size_type directory_entry_number) const override;
     std::shared_ptr<directory_ref> find_directory(std::string image_folder) const override;
 };
 
 class impl_volume_ref : public volume_ref
 {
     camera_ref_lock<EdsVolumeRef> ref;
+    std::shared_ptr<impl_transfer_state> transfers;
     size_type count;
     uint64_t max_capacity;
     uint64_t free_space;
@@ -128,19 +250,23 @@ class impl_volume_ref : public volume_ref
     storage_type_t storage_type;
     access_type_t access;
 
-    std::shared_ptr<directory_ref> find_directory(std::string dir);
+    /// The folder called name at the top of the volume (e.g. DCIM), if there is one
+    std::optional<eds_entry> find_directory(const std::string& name);
 
 public:
-    impl_volume_ref(EdsVolumeRef r);
+    impl_volume_ref(EdsVolumeRef r, std::shared_ptr<impl_transfer_state> transfers);
     virtual ~impl_volume_ref();
     uint64_t get_max_capacity() const override { return max_capacity; }
     uint64_t get_free_space() const override { return free_space; }
+    uint64_t read_free_space() override;
     std::string get_label() const override { return label; }
     storage_type_t get_storage_type() const override { return storage_type; }
     access_type_t get_access() const override { return access; }
 
     size_type get_directory_count() const override { return count; }
     std::shared_ptr<directory_ref> select_directory(size_type directory_number) override;
+    eds_result<std::shared_ptr<directory_ref>> try_select_directory(
+        size_type directory_number) override;
 
     std::vector<std::shared_ptr<directory_ref>> find_matching_files(
         std::string image_folder, std::regex filename_expression) override;
@@ -156,18 +282,18 @@ public:
     {
         if (ref.get_ref() != nullptr)
         {
-            Poco::Logger::get("camera_ref").debug("Establishing camera session");
+            CAMERA_LOG(camera_ref_log, debug, "Establishing camera session");
 
-            EdsOpenSession(ref.get_ref());
+            TIME_EDS_CALL(EdsOpenSession(ref.get_ref()));
         }
     }
     ~impl_camera_session()
     {
         if (ref.get_ref() != nullptr)
         {
-            Poco::Logger::get("camera_ref").debug("Terminating camera session");
+            CAMERA_LOG(camera_ref_log, debug, "Terminating camera session");
 
-            EdsCloseSession(ref.get_ref());
+            TIME_EDS_CALL(EdsCloseSession(ref.get_ref()));
         }
     }
 };
@@ -209,8 +335,117 @@ public:
     std::string get_copyright() const override { return copyright; }
     size_t get_available_shots() const override { return available_shots; }
 
+    /// The camera properties used to fill in the camera_info
+    static constexpr size_t property_count = 16;
+    static const std::array<EdsPropertyID, property_count> property_ids;
+
     impl_camera_info(camera_ref_lock<EdsCameraRef> ref);
     virtual ~impl_camera_info() noexcept;
+
+    /// Re-read a single property from the camera
+    void read_property(EdsCameraRef ref, EdsPropertyID id);
+};
+
+/// Dispatches SDK events (by calling EdsGetEvent) on a background thread
+class impl_event_pump
+{
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool running;
+    /// Held while EdsGetEvent calls the handlers
+    std::recursive_mutex dispatching;
+    std::thread thread;
+
+    void run();
+
+public:
+    /// How long to wait between calls to EdsGetEvent
+    static constexpr std::chrono::milliseconds interval { 20 };
+
+    impl_event_pump();
+    ~impl_event_pump();
+
+    /// Keep handlers from being called until the lock is released. A handler's context can be
+    /// destroyed once its handler has been cleared under this lock, as no call to it can still
+    /// be running. It can be taken from within a handler.
+    std::unique_lock<std::recursive_mutex> hold_events()
+    {
+        return std::unique_lock<std::recursive_mutex>(dispatching);
+    }
+
+    /// Get the event pump, starting it if necessary. It stops when the last user releases it.
+    static std::shared_ptr<impl_event_pump> acquire();
+};
+
+/// Camera info kept up to date using the camera's property changed events. Only the properties
+/// that the camera reports as changed are read again.
+class impl_live_camera_info : public live_camera_info
+{
+    camera_ref_lock<EdsCameraRef> ref;
+    /// Only accessed with std::atomic_load/std::atomic_store so readers never see a partial update
+    std::shared_ptr<const impl_camera_info> snapshot;
+    std::array<std::atomic<bool>, impl_camera_info::property_count> changed;
+    std::atomic<bool> any_changed;
+    std::mutex update_mutex;
+    std::shared_ptr<impl_event_pump> events;
+
+    static EdsError EDSCALLBACK property_event(
+        EdsPropertyEvent event, EdsPropertyID id, EdsUInt32 param, EdsVoid* context);
+
+public:
+    impl_live_camera_info(camera_ref_lock<EdsCameraRef> camera);
+    virtual ~impl_live_camera_info();
+
+    std::shared_ptr<const camera_info> get_snapshot() override;
+};
+
+/// Live view frames are downloaded on their own thread into a ring of memory streams that are
+/// created once and reused, and are read in place with EdsGetPointer.
+class impl_live_view : public live_view
+{
+    struct frame_slot
+    {
+        std::mutex mutex; ///< Held while the frame is downloaded or read
+        camera_ref_lock<EdsStreamRef> stream;
+        camera_ref_lock<EdsEvfImageRef> image;
+        uint64_t sequence = 0;
+        std::size_t size = 0;
+        std::chrono::steady_clock::time_point captured_at;
+        std::chrono::microseconds latency { 0 };
+
+        frame_slot(camera_ref_lock<EdsStreamRef> frame_stream, EdsEvfImageRef frame_image)
+            : stream(std::move(frame_stream))
+            , image(frame_image)
+        {
+        }
+    };
+
+    camera_ref_lock<EdsCameraRef> camera;
+    EdsUInt32 previous_output_device = 0;
+    std::vector<std::unique_ptr<frame_slot>> slots;
+
+    mutable std::mutex mutex;
+    std::condition_variable frame_ready;
+    uint64_t latest_sequence = 0;
+    std::chrono::steady_clock::time_point first_frame_at;
+    std::chrono::steady_clock::time_point latest_frame_at;
+    std::chrono::microseconds total_latency { 0 };
+    std::chrono::microseconds max_latency { 0 };
+
+    std::atomic<bool> running { true };
+    std::thread thread;
+
+    void run();
+    bool download_frame(frame_slot& slot, uint64_t sequence);
+
+public:
+    impl_live_view(camera_ref_lock<EdsCameraRef> camera, std::size_t buffer_frames);
+    ~impl_live_view();
+
+    bool next_frame(uint64_t after_sequence, std::chrono::milliseconds timeout,
+        const consumer_t& consumer) override;
+    live_view_stats get_stats() const override;
+    void stop() override;
 };
 
 class impl_camera_ref : public camera_ref
@@ -219,30 +454,84 @@ class impl_camera_ref : public camera_ref
     std::shared_ptr<connection_info> conn_info;
     std::unique_ptr<impl_camera_session> session;
 
+    /// How many of the files passed to the object created handler are remembered
+    static constexpr std::size_t max_recent_objects = 16;
+
+    std::mutex handler_mutex;
+    object_created_handler_t object_created_handler;
+    /// The names and sizes of the files last passed to the handler. Guarded by handler_mutex.
+    std::deque<std::string> recent_objects;
+    std::shared_ptr<impl_event_pump> events;
+    std::weak_ptr<impl_live_camera_info> live_info;
+    std::shared_ptr<impl_transfer_state> transfers;
+
+    /// Whether entry has not been passed to the handler yet. Called with handler_mutex held.
+    bool is_new_object(const eds_entry& entry);
+
+    static EdsError EDSCALLBACK object_event(
+        EdsObjectEvent event, EdsBaseRef object, EdsVoid* context);
+    static EdsError EDSCALLBACK state_event(
+        EdsStateEvent event, EdsUInt32 event_data, EdsVoid* context);
+
 public:
     impl_camera_ref(EdsCameraRef camera);
     virtual ~impl_camera_ref();
 
     std::shared_ptr<const connection_info> get_connection_info() const override;
     std::shared_ptr<camera_info> get_camera_info() override;
+    std::shared_ptr<live_camera_info> get_live_camera_info() override;
+    std::vector<property_value> read_properties(
+        gsl::span<const property_value::property_id_t> ids) override;
+    eds_result<std::vector<property_value>> try_read_properties(
+        gsl::span<const property_value::property_id_t> ids) override;
     size_type get_volume_count() const override;
     std::shared_ptr<volume_ref> select_volume(size_type volume_number) override;
 
     void set_ui_status(bool enabled) override;
+    void set_object_created_handler(object_created_handler_t handler) override;
+    std::unique_ptr<live_view> start_live_view(std::size_t buffer_frames) override;
+
+    bool is_disconnected() const { return transfers->is_disconnected(); }
 };
 
 class impl_camera_list
 {
+    /// Cameras can be opened from several threads at once (e.g. to read their info in parallel),
+    /// but the SDK's list of cameras is only used by one of them at a time
+    mutable std::mutex list_mutex;
+
+    std::mutex select_mutex;
     std::shared_ptr<impl_camera_ref> current_camera;
 
+    /// Every camera with a session open, and the cameras having a session opened by another thread
+    std::map<EdsCameraRef, std::weak_ptr<impl_camera_ref>> sessions;
+    std::set<EdsCameraRef> opening;
+    std::condition_variable opened;
+
+    /// Cameras with sessions kept open, by port
+    bool keep_sessions = false;
+    std::map<std::string, std::shared_ptr<impl_camera_ref>> open_sessions;
+
+    void release_list();
+    std::string get_port(EdsCameraRef camera) const;
+
 public:
     typedef camera_connection::size_type size_type;
 
     impl_camera_list();
     ~impl_camera_list();
-    size_type size() const noexcept;
+    size_type size() const;
     std::shared_ptr<camera_ref> at(size_type offset);
+    std::shared_ptr<camera_ref> open_camera(size_type offset);
+    std::shared_ptr<const connection_info> get_connection_info(size_type offset) const;
     void deselect_camera(std::shared_ptr<camera_ref>& camera);
+    void refresh();
+    void set_keep_sessions_open(bool keep);
+
+private:
+    /// The camera at camera_number in the list, retained for the caller
+    EdsCameraRef get_camera(size_type camera_number) const;
+    std::shared_ptr<impl_camera_ref> open(size_type camera_number, bool select);
 
 protected:
     EdsCameraListRef list;
@@ -254,10 +543,22 @@ class impl_camera_connection : public camera_connection
 protected:
     std::unique_ptr<impl_camera_list> cameras;
 
+    std::mutex handler_mutex;
+    std::function<void()> camera_added_handler;
+    std::shared_ptr<impl_event_pump> events;
+
+    static EdsError EDSCALLBACK camera_added(EdsVoid* context);
+
 public:
     int number_of_cameras() const override;
     std::shared_ptr<camera_ref> select_camera(size_type camera_number) override;
+    std::shared_ptr<camera_ref> open_camera(size_type camera_number) override;
     void deselect_camera(std::shared_ptr<camera_ref>& camera) override;
+    std::shared_ptr<const connection_info> get_connection_info(
+        size_type camera_number) const override;
+    void refresh() override;
+    void set_camera_added_handler(std::function<void()> handler) override;
+    void set_keep_sessions_open(bool keep) override;
 
     impl_camera_connection();
     virtual ~impl_camera_connection();
@@ -267,9 +568,35 @@ public:
 
 #pragma GCC visibility pop
 
+namespace implementation
+{
+/// Throw err as camera_disconnected_exception if it means the camera has gone, so that callers
+/// can wait for it to come back whatever they were doing, otherwise as eds_exception
+[[noreturn]] inline void throw_sdk_error(
+    EdsError err, const std::string& message, const char* method)
+{
+    if (eds_error { err, "" }.is_disconnected())
+        throw camera_disconnected_exception(message, static_cast<int>(err), method);
+    throw eds_exception(message, static_cast<int>(err), method);
+}
+} // namespace implementation
+
+/// Throw an eds_exception if stmt fails, after logging the error. Each use looks its logger up
+/// once, the first time it fails.
 #define THROW_ERRORS(stmt, logger_class, message)                                                  \
-    if (auto err = stmt; err != EDS_ERR_OK)                                                        \
+    if (auto err = TIME_EDS_CALL(stmt); err != EDS_ERR_OK)                                         \
+    {                                                                                              \
+        static implementation::component_logger error_logger(logger_class);                        \
+        CAMERA_LOG(error_logger, error, std::string(message) + " (0x%s)", int_to_hex(err));        \
+        implementation::throw_sdk_error(err, message, __FUNCTION__);                               \
+    }
+
+/// Log and return an eds_error from a function returning an eds_result if stmt fails, the
+/// non-throwing form of THROW_ERRORS
+#define RETURN_ERRORS(stmt, logger_class, message)                                                 \
+    if (auto err = TIME_EDS_CALL(stmt); err != EDS_ERR_OK)                                         \
     {                                                                                              \
-        Poco::Logger::get(logger_class).error(std::string(message) + " (0x%s)", int_to_hex(err));  \
-        throw eds_exception(message, err, __FUNCTION__);                                           \
+        static implementation::component_logger error_logger(logger_class);                        \
+        CAMERA_LOG(error_logger, error, std::string(message) + " (0x%s)", int_to_hex(err));        \
+        return eds_error { static_cast<uint32_t>(err), message };                                  \
     }
@@ -17,6 +17,7 @@
 #include "camera_interface_impl.hpp"
 #include <cstdio>
 #include <iostream>
+#include <set>
 
 #include "EDSDK.h"
 
@@ -38,41 +39,183 @@ impl_camera_list::impl_camera_list()
     count = listCount;
 }
 
-impl_camera_list::~impl_camera_list()
+impl_camera_list::~impl_camera_list() { release_list(); }
+
+void impl_camera_list::release_list()
 {
     if (list != nullptr)
     {
         EdsRelease(list);
         list = nullptr;
     }
+    count = 0;
 }
 
-std::shared_ptr<camera_ref> impl_camera_list::at(size_type camera_number)
+void impl_camera_list::refresh()
 {
-    if ((camera_number >= size()) || (camera_number > std::numeric_limits<EdsInt32>::max()))
     {
-        Poco::Logger::get("camera_list").error("Failed to select camera (%d)", camera_number);
+        // Any camera that is open holds its own reference, so it stays valid after the list is
+        // released
+        std::lock_guard<std::mutex> lock(list_mutex);
+        release_list();
+
+        EdsUInt32 listCount = 0;
+        THROW_ERRORS(EdsGetCameraList(&list), "camera_list", "Failed to get camera list");
+        THROW_ERRORS(EdsGetChildCount(list, &listCount), "camera_list",
+            "Failed to get camera list count");
+
+        count = listCount;
+    }
+
+    if (!keep_sessions)
+        return;
+
+    // Close the sessions with cameras that have been disconnected
+    std::set<std::string> ports;
+    for (size_type camera_number = 0; camera_number < size(); camera_number++)
+        ports.insert(get_connection_info(camera_number)->get_port());
+
+    std::lock_guard<std::mutex> lock(select_mutex);
+    for (auto open = open_sessions.begin(); open != open_sessions.end();)
+    {
+        if (ports.count(open->first) == 0 || open->second->is_disconnected())
+            open = open_sessions.erase(open);
+        else
+            ++open;
+    }
+}
+
+EdsCameraRef impl_camera_list::get_camera(size_type camera_number) const
+{
+    std::lock_guard<std::mutex> lock(list_mutex);
+    if ((camera_number >= count) || (camera_number > std::numeric_limits<EdsInt32>::max()))
+    {
+        CAMERA_LOG(camera_list_log, error, "Failed to select camera (%d)", camera_number);
         throw std::out_of_range("Camera number too big");
-        // throw eds_exception("Failed to select camera - camera not found",
-        // EDS_ERR_DEVICE_NOT_FOUND, __FUNCTION__);
     }
 
     EdsCameraRef camera(nullptr);
-    if (auto err = EdsGetChildAtIndex(list, static_cast<EdsInt32>(camera_number), &camera);
+    if (auto err = TIME_EDS_CALL(
+            EdsGetChildAtIndex(list, static_cast<EdsInt32>(camera_number), &camera));
         err != EDS_ERR_OK)
     {
-        Poco::Logger::get("camera_list").error("Failed to select camera (%lu)", err);
-        throw eds_exception("Failed to select camera", err, __FUNCTION__);
+        CAMERA_LOG(camera_list_log, error, "Failed to get camera (%lu)", err);
+        throw eds_exception("Failed to get camera", err, __FUNCTION__);
+    }
+
+    return camera;
+}
+
+std::shared_ptr<const connection_info> impl_camera_list::get_connection_info(
+    size_type camera_number) const
+{
+    EdsCameraRef camera = get_camera(camera_number);
+
+    EdsDeviceInfo device_info;
+    const auto info_err = TIME_EDS_CALL(EdsGetDeviceInfo(camera, &device_info));
+    EdsRelease(camera);
+    THROW_ERRORS(info_err, "camera_list", "Failed to get device info");
+
+    return std::make_shared<impl_connection_info>(
+        device_info.szPortName, device_info.szDeviceDescription);
+}
+
+std::shared_ptr<camera_ref> impl_camera_list::at(size_type camera_number)
+{
+    return open(camera_number, true);
+}
+
+std::shared_ptr<camera_ref> impl_camera_list::open_camera(size_type camera_number)
+{
+    return open(camera_number, false);
+}
+
+std::shared_ptr<impl_camera_ref> impl_camera_list::open(size_type camera_number, bool select)
+{
+    EdsCameraRef camera = get_camera(camera_number);
+    const std::string port = keep_sessions ? get_port(camera) : "";
+
+    std::unique_lock<std::mutex> lock(select_mutex);
+
+    // A camera only has one session, so wait for any other thread opening this one and share it
+    opened.wait(lock, [this, camera] { return opening.count(camera) == 0; });
+
+    std::shared_ptr<impl_camera_ref> camera_ref;
+    if (auto open = open_sessions.find(port); !port.empty() && open != open_sessions.end())
+        camera_ref = open->second;
+    else if (auto session = sessions.find(camera); session != sessions.end())
+        camera_ref = session->second.lock();
+
+    if (camera_ref)
+    {
+        EdsRelease(camera);
     }
+    else
+    {
+        // Opening the session is the slow part, so it is done without holding the lock
+        opening.insert(camera);
+        lock.unlock();
+        try
+        {
+            camera_ref = std::make_shared<impl_camera_ref>(camera);
+        }
+        catch (...)
+        {
+            lock.lock();
+            opening.erase(camera);
+            opened.notify_all();
+            throw;
+        }
+        lock.lock();
+        opening.erase(camera);
+        opened.notify_all();
 
-    current_camera = std::make_shared<impl_camera_ref>(camera);
-    return current_camera;
+        for (auto open = sessions.begin(); open != sessions.end();)
+        {
+            if (open->second.expired())
+                open = sessions.erase(open);
+            else
+                ++open;
+        }
+        sessions[camera] = camera_ref;
+        if (!port.empty())
+            open_sessions[port] = camera_ref;
+    }
+
+    if (select)
+        current_camera = camera_ref;
+    return camera_ref;
+}
+
+std::string impl_camera_list::get_port(EdsCameraRef camera) const
+{
+    EdsDeviceInfo device_info;
+    if (auto err = TIME_EDS_CALL(EdsGetDeviceInfo(camera, &device_info)); err != EDS_ERR_OK)
+    {
+        CAMERA_LOG(camera_list_log, warning, "Failed to get device info (%lu)", err);
+        return "";
+    }
+
+    return device_info.szPortName;
+}
+
+void impl_camera_list::set_keep_sessions_open(bool keep)
+{
+    std::lock_guard<std::mutex> lock(select_mutex);
+    keep_sessions = keep;
+    if (!keep)
+        open_sessions.clear();
 }
 
-impl_camera_list::size_type impl_camera_list::size() const noexcept { return count; }
+impl_camera_list::size_type impl_camera_list::size() const
+{
+    std::lock_guard<std::mutex> lock(list_mutex);
+    return count;
+}
 
 void impl_camera_list::deselect_camera(std::shared_ptr<camera_ref>& camera)
 {
+    std::lock_guard<std::mutex> lock(select_mutex);
     if (current_camera != camera)
     {
         throw eds_exception("Failed to deselect camera", 42, __FUNCTION__);
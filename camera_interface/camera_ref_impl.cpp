@@ -15,6 +15,8 @@
 
 #include "camera_interface.hpp"
 #include "camera_interface_impl.hpp"
+#include "properties.hpp"
+#include <algorithm>
 #include <cstdio>
 #include <iostream>
 
@@ -36,9 +38,41 @@ impl_camera_ref::impl_camera_ref(EdsCameraRef camera)
     conn_info = std::make_shared<impl_connection_info>(
         device_info.szPortName, device_info.szDeviceDescription);
     session = std::make_unique<impl_camera_session>(ref);
+    transfers = std::make_shared<impl_transfer_state>();
+
+    // State events let downloads be cancelled straight away when the camera goes away
+    if (auto err = TIME_EDS_CALL(EdsSetCameraStateEventHandler(
+            ref.get_ref(), kEdsStateEvent_All, state_event, this));
+        err == EDS_ERR_OK)
+    {
+        events = impl_event_pump::acquire();
+    }
+    else
+    {
+        CAMERA_LOG(camera_ref_log, warning, "Failed to set camera state event handler (0x%s)",
+            int_to_hex(err));
+    }
 }
 
-impl_camera_ref::~impl_camera_ref() { }
+impl_camera_ref::~impl_camera_ref()
+{
+    // Wait for a handler running on the event thread to finish before this goes
+    std::unique_lock<std::recursive_mutex> holding;
+    if (events)
+        holding = events->hold_events();
+
+    TIME_EDS_CALL(
+        EdsSetCameraStateEventHandler(ref.get_ref(), kEdsStateEvent_All, nullptr, nullptr));
+
+    bool object_events = false;
+    {
+        std::lock_guard<std::mutex> lock(handler_mutex);
+        object_events = static_cast<bool>(object_created_handler);
+    }
+    if (object_events)
+        TIME_EDS_CALL(
+            EdsSetObjectEventHandler(ref.get_ref(), kEdsObjectEvent_All, nullptr, nullptr));
+}
 
 std::shared_ptr<const connection_info> impl_camera_ref::get_connection_info() const
 {
@@ -47,11 +81,70 @@ std::shared_ptr<const connection_info> impl_camera_ref::get_connection_info() co
 
 std::shared_ptr<camera_info> impl_camera_ref::get_camera_info()
 {
+    ALLOCATION_SCOPE("properties");
     auto cam = std::make_shared<impl_camera_info>(ref);
 
     return cam;
 }
 
+std::vector<property_value> impl_camera_ref::read_properties(
+    gsl::span<const property_value::property_id_t> ids)
+{
+    return try_read_properties(ids).value();
+}
+
+eds_result<std::vector<property_value>> impl_camera_ref::try_read_properties(
+    gsl::span<const property_value::property_id_t> ids)
+{
+    ALLOCATION_SCOPE("properties");
+    std::vector<property_value> values;
+    values.reserve(ids.size());
+
+    for (const auto id : ids)
+    {
+        const auto descriptor = find_property_descriptor(id);
+        if (descriptor == nullptr)
+        {
+            CAMERA_LOG(camera_ref_log, error, "Unknown camera property (0x%s)", int_to_hex(id));
+            values.push_back(property_value { id, std::monostate(),
+                eds_error { EDS_ERR_NOT_SUPPORTED, "Unknown camera property" } });
+            continue;
+        }
+
+        auto value = try_read_camera_property(ref.get_ref(), *descriptor);
+        if (!value)
+        {
+            CAMERA_LOG(camera_ref_log, error, "Failed to read camera property 0x%s (0x%s)",
+                int_to_hex(id), int_to_hex(value.error().code));
+
+            // There is no point reading the rest once the camera has gone
+            if (value.error().is_disconnected())
+                return value.error();
+
+            values.push_back(property_value { id, std::monostate(), value.error() });
+            continue;
+        }
+
+        values.emplace_back(std::move(*value));
+    }
+
+    return values;
+}
+
+std::shared_ptr<live_camera_info> impl_camera_ref::get_live_camera_info()
+{
+    ALLOCATION_SCOPE("properties");
+    // The SDK only supports one property event handler per camera, so share the live info
+    auto info = live_info.lock();
+    if (!info)
+    {
+        info = std::make_shared<impl_live_camera_info>(ref);
+        live_info = info;
+    }
+
+    return info;
+}
+
 impl_camera_ref::size_type impl_camera_ref::get_volume_count() const
 {
     EdsUInt32 count = 0;
@@ -62,6 +155,7 @@ impl_camera_ref::size_type impl_camera_ref::get_volume_count() const
 
 std::shared_ptr<volume_ref> impl_camera_ref::select_volume(size_type volume_number)
 {
+    ALLOCATION_SCOPE("enumeration");
     if (volume_number >= get_volume_count())
         throw std::out_of_range("Volume number too big");
 
@@ -71,20 +165,124 @@ std::shared_ptr<volume_ref> impl_camera_ref::select_volume(size_type volume_numb
 
     THROW_ERRORS(EdsGetChildAtIndex(ref.get_ref(), volume_number, &vol_ref),"camera_ref.volume",Poco::format("Failed to get child at index %lu", volume_number));
 
-    selected_volume = std::make_shared<impl_volume_ref>(vol_ref);
+    selected_volume = std::make_shared<impl_volume_ref>(vol_ref, transfers);
 
     return selected_volume;
 }
 
 void impl_camera_ref::set_ui_status(bool enabled)
 {
-    if (auto err = EdsSendStatusCommand(ref.get_ref(),
-            enabled ? kEdsCameraStatusCommand_UILock : kEdsCameraStatusCommand_UIUnLock, 0);
+    if (auto err = TIME_EDS_CALL(EdsSendStatusCommand(ref.get_ref(),
+            enabled ? kEdsCameraStatusCommand_UILock : kEdsCameraStatusCommand_UIUnLock, 0));
         err != EDS_ERR_OK)
     {
-        Poco::Logger::get("camera_ref").error("Failed to set ui status (%x)", err);
-        throw eds_exception("Failed to set ui status", err, __FUNCTION__);
+        CAMERA_LOG(camera_ref_log, error, "Failed to set ui status (%x)", err);
+        throw_eds_error(eds_error { err, "Failed to set ui status" }, __FUNCTION__);
+    }
+}
+
+void impl_camera_ref::set_object_created_handler(object_created_handler_t handler)
+{
+    const bool enable = static_cast<bool>(handler);
+    {
+        std::lock_guard<std::mutex> lock(handler_mutex);
+        object_created_handler = std::move(handler);
+        recent_objects.clear();
     }
+
+    THROW_ERRORS(EdsSetObjectEventHandler(ref.get_ref(), kEdsObjectEvent_All,
+                     enable ? object_event : nullptr, enable ? this : nullptr),
+        "camera_ref", "Failed to set object event handler");
+
+    if (enable && !events)
+        events = impl_event_pump::acquire();
+}
+
+EdsError EDSCALLBACK impl_camera_ref::object_event(
+    EdsObjectEvent event, EdsBaseRef object, EdsVoid* context)
+{
+    auto camera = static_cast<impl_camera_ref*>(context);
+
+    switch (event)
+    {
+    case kEdsObjectEvent_DirItemCreated:
+    case kEdsObjectEvent_DirItemRequestTransfer:
+    {
+        std::lock_guard<std::mutex> lock(camera->handler_mutex);
+        if (camera->object_created_handler && object != nullptr)
+        {
+            try
+            {
+                // The SDK releases object after the event, so the entry keeps its own reference
+                auto entry = eds_backend::open(eds_item_ref::retain(object)).value();
+                if (camera->is_new_object(entry))
+                    camera->object_created_handler(
+                        std::make_shared<impl_directory_ref>(std::move(entry), camera->transfers));
+            }
+            catch (const std::exception& ex)
+            {
+                CAMERA_LOG(camera_ref_log, error, "Object created handler failed: %s",
+                    std::string(ex.what()));
+            }
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    // The SDK passes ownership of the object to the handler
+    if (object != nullptr)
+        EdsRelease(object);
+
+    return EDS_ERR_OK;
+}
+
+bool impl_camera_ref::is_new_object(const eds_entry& entry)
+{
+    // A camera saving to both the card and the computer sends both events for each picture, one
+    // after the other, each with its own reference to the file
+    auto key = entry.get_name() + ":" + std::to_string(entry.get_file_size());
+    if (std::find(recent_objects.begin(), recent_objects.end(), key) != recent_objects.end())
+        return false;
+
+    recent_objects.push_back(std::move(key));
+    if (recent_objects.size() > max_recent_objects)
+        recent_objects.pop_front();
+    return true;
+}
+
+std::unique_ptr<live_view> impl_camera_ref::start_live_view(std::size_t buffer_frames)
+{
+    return std::make_unique<impl_live_view>(ref, buffer_frames);
+}
+
+EdsError EDSCALLBACK impl_camera_ref::state_event(
+    EdsStateEvent event, EdsUInt32, EdsVoid* context)
+{
+    auto camera = static_cast<impl_camera_ref*>(context);
+
+    switch (event)
+    {
+    case kEdsStateEvent_Shutdown:
+        CAMERA_LOG(camera_ref_log, warning, "Camera disconnected or shut down");
+        camera->transfers->cancel_all();
+        break;
+
+    case kEdsStateEvent_WillSoonShutDown:
+        // Keep the camera awake while files are being downloaded
+        if (camera->transfers->has_transfers())
+            TIME_EDS_CALL(EdsSendCommand(
+                camera->ref.get_ref(), kEdsCameraCommand_ExtendShutDownTimer, 0));
+        break;
+
+    default:
+        break;
+    }
+
+    return EDS_ERR_OK;
 }
 
 } // namespace implementation
+
@@ -0,0 +1,152 @@
+//
+//  directory_entry.hpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <optional>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// What is read about a file or folder when it is opened
+struct directory_entry_info
+{
+    std::string name;
+    uint64_t file_size = 0;
+    uint32_t format = 0;
+    bool is_folder = false;
+    uint32_t group_id = 0;
+    /// The number of entries in a folder
+    std::size_t count = 0;
+};
+
+/// A file or folder, as a value rather than a shared directory_ref. The entry owns its handle
+/// (e.g. one SDK reference) and is moved rather than copied, the accessors are not virtual and
+/// the backend is chosen at compile time, so listing thousands of entries costs no reference
+/// counting or virtual calls. The directory_ref implementations are adapters over these.
+///
+/// Backend provides handle_type and the static functions open_child, find_directory,
+/// find_matching_entries, delete_file and, if its entries can be downloaded this way,
+/// download_to.
+template <typename Backend> class basic_directory_entry
+{
+public:
+    typedef typename Backend::handle_type handle_type;
+    typedef std::size_t size_type;
+    typedef uint32_t format_t;
+
+    basic_directory_entry(handle_type entry_handle, directory_entry_info entry_info)
+        : handle(std::move(entry_handle))
+        , info(std::move(entry_info))
+    {
+    }
+
+    basic_directory_entry(basic_directory_entry&&) = default;
+    basic_directory_entry& operator=(basic_directory_entry&&) = default;
+    basic_directory_entry(const basic_directory_entry&) = delete;
+    basic_directory_entry& operator=(const basic_directory_entry&) = delete;
+
+    const std::string& get_name() const { return info.name; }
+    uint64_t get_file_size() const { return info.file_size; }
+    format_t get_format() const { return info.format; }
+    uint32_t get_group_ID() const { return info.group_id; }
+    bool is_a_folder() const { return info.is_folder; }
+    const handle_type& get_handle() const { return handle; }
+
+    size_type get_directory_count() const
+    {
+        ensure_folder();
+        return info.count;
+    }
+
+    basic_directory_entry get_directory_entry(size_type directory_entry_number) const
+    {
+        if (directory_entry_number >= get_directory_count())
+            throw std::out_of_range("Directory entry out of range");
+
+        return Backend::open_child(handle, directory_entry_number);
+    }
+
+    /// The folder called name in this folder, if there is one
+    std::optional<basic_directory_entry> find_directory(const std::string& name) const
+    {
+        ensure_folder();
+        return Backend::find_directory(*this, name);
+    }
+
+    /// The entries in this folder whose names match filename_expression
+    std::vector<basic_directory_entry> find_matching_entries(
+        const std::regex& filename_expression) const
+    {
+        ensure_folder();
+        return Backend::find_matching_entries(*this, filename_expression);
+    }
+
+    void download_to(const std::string& destination) const
+    {
+        if (info.is_folder)
+            throw std::logic_error("Can not download a directory");
+
+        Backend::download_to(handle, destination);
+    }
+
+    /// Delete the file from the card. The entry can not be used afterwards.
+    void delete_file()
+    {
+        if (info.is_folder)
+            throw std::logic_error("Can not delete a directory");
+
+        Backend::delete_file(handle);
+    }
+
+private:
+    handle_type handle;
+    directory_entry_info info;
+
+    void ensure_folder() const
+    {
+        if (!info.is_folder)
+            throw std::logic_error("Not a directory");
+    }
+};
+
+/// Files and folders on a card in a card reader, which are read without the SDK
+struct card_reader_backend
+{
+    /// A file or folder, and the names in a folder sorted as the camera lists them. The names
+    /// are read once, when the folder is opened, so only the entries that are used are looked at.
+    struct handle_type
+    {
+        std::filesystem::path path;
+        /// The time the file was last written. Cameras set this to when the picture was taken.
+        std::time_t modified = 0;
+        std::vector<std::string> entries;
+    };
+
+    typedef basic_directory_entry<card_reader_backend> entry_type;
+
+    /// Open the file or folder at path. Throws std::system_error if it can not be read.
+    static entry_type open(std::filesystem::path path);
+    static entry_type open_child(const handle_type& folder, std::size_t index);
+    static std::optional<entry_type> find_directory(
+        const entry_type& folder, const std::string& name);
+    /// Only the matching files are opened, which matters on cards with thousands of files
+    static std::vector<entry_type> find_matching_entries(
+        const entry_type& folder, const std::regex& filename_expression);
+    /// Copy the file, with the kernel doing the copy where it can
+    static void download_to(const handle_type& file, const std::string& destination);
+    static void delete_file(handle_type& file);
+};
+
+/// A file or folder on a card in a card reader
+typedef basic_directory_entry<card_reader_backend> card_entry;
@@ -17,7 +17,9 @@
 #include "camera_interface_impl.hpp"
 #include "int_to_hex.hpp"
 #include "properties.hpp"
+#include <algorithm>
 #include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <string>
 
@@ -34,97 +36,140 @@ namespace implementation
 {
 using namespace std::string_literals;
 
-impl_directory_ref::impl_directory_ref(EdsDirectoryItemRef r)
-    : ref(r)
-    , file_size(0)
-    , format(0)
-    , is_folder(false)
-    , group_id(0)
-    , count(0)
+eds_result<eds_entry> eds_backend::open(eds_item_ref item)
 {
-    EdsDirectoryItemInfo item;
-
-    THROW_ERRORS(EdsGetDirectoryItemInfo(ref.get_ref(), &item), "directory_item",
+    EdsDirectoryItemInfo item_info;
+    RETURN_ERRORS(EdsGetDirectoryItemInfo(item.get_ref(), &item_info), "directory_item",
         "Failed to get directory item info");
 
-    file_size = item.size;
-    format = item.format;
-    name = item.szFileName;
-    is_folder = item.isFolder;
-    group_id = item.groupID;
+    directory_entry_info info;
+    info.name = item_info.szFileName;
+    info.file_size = item_info.size;
+    info.format = item_info.format;
+    info.is_folder = item_info.isFolder;
+    info.group_id = item_info.groupID;
 
-    if (is_folder)
+    if (info.is_folder)
     {
         EdsUInt32 listCount = 0;
-        THROW_ERRORS(EdsGetChildCount(ref.get_ref(), &listCount), "directory_item",
+        RETURN_ERRORS(EdsGetChildCount(item.get_ref(), &listCount), "directory_item",
             "Failed to get directory folder item count");
 
-        count = listCount;
+        info.count = listCount;
+    }
+
+    return eds_entry(std::move(item), std::move(info));
+}
+
+eds_result<eds_entry> eds_backend::try_open_child(
+    EdsBaseRef parent, std::size_t index, const char* message)
+{
+    EdsDirectoryItemRef dir(nullptr);
+    RETURN_ERRORS(EdsGetChildAtIndex(parent, static_cast<EdsInt32>(index), &dir), "directory_ref",
+        message);
+
+    return open(eds_item_ref(dir));
+}
+
+eds_entry eds_backend::open_child(const handle_type& folder, std::size_t index)
+{
+    return try_open_child(folder.get_ref(), index, "Failed to get directory entry").value();
+}
+
+std::optional<eds_entry> eds_backend::find_directory(
+    const eds_entry& folder, const std::string& name)
+{
+    // The SDK can only find an entry by opening each one in turn
+    for (std::size_t index = 0; index < folder.get_directory_count(); index++)
+    {
+        auto entry = open_child(folder.get_handle(), index);
+        if (entry.is_a_folder() && entry.get_name() == name)
+            return entry;
     }
+
+    return std::nullopt;
+}
+
+std::vector<eds_entry> eds_backend::find_matching_entries(
+    const eds_entry& folder, const std::regex& filename_expression)
+{
+    std::vector<eds_entry> list;
+    for (std::size_t index = 0; index < folder.get_directory_count(); index++)
+    {
+        auto entry = open_child(folder.get_handle(), index);
+        if (std::regex_match(entry.get_name(), filename_expression))
+            list.emplace_back(std::move(entry));
+    }
+
+    return list;
+}
+
+void eds_backend::delete_file(handle_type& file)
+{
+    THROW_ERRORS(EdsDeleteDirectoryItem(file.get_ref()), "directory_ref", "Failed to delete file");
+
+    // The SDK releases the items it deletes
+    file.release();
+}
+
+impl_directory_ref::impl_directory_ref(
+    eds_entry item, std::shared_ptr<impl_transfer_state> transfer_state)
+    : entry(std::move(item))
+    , transfers(std::move(transfer_state))
+{
 }
 
 impl_directory_ref::~impl_directory_ref() { }
 
 volume_ref::size_type impl_directory_ref::get_directory_count() const
 {
-    if (!is_folder)
-        throw std::logic_error("Not a directory");
-
-    return count;
+    return entry.get_directory_count();
 }
 
 std::shared_ptr<directory_ref> impl_directory_ref::get_directory_entry(
     volume_ref::size_type directory_entry_number) const
 {
-    if (!is_folder)
-        throw std::logic_error("Not a directory");
+    return try_get_directory_entry(directory_entry_number).value();
+}
 
-    if (directory_entry_number >= count)
+eds_result<std::shared_ptr<directory_ref>> impl_directory_ref::try_get_directory_entry(
+    volume_ref::size_type directory_entry_number) const
+{
+    ALLOCATION_SCOPE("enumeration");
+    if (directory_entry_number >= entry.get_directory_count())
     {
-        Poco::Logger::get("directory_ref")
-            .error("Directory entry out of range (%s)", std::to_string(directory_entry_number));
+        CAMERA_LOG(directory_ref_log, error, "Directory entry out of range (%s)",
+            std::to_string(directory_entry_number));
         throw std::out_of_range("Directory entry out of range");
     }
 
-    EdsDirectoryItemRef dir(nullptr);
-    THROW_ERRORS(
-        EdsGetChildAtIndex(ref.get_ref(), static_cast<EdsInt32>(directory_entry_number), &dir),
-        "directory_ref", "Failed to get directory entry");
-
-    std::shared_ptr<directory_ref> dir_impl = std::make_shared<impl_directory_ref>(dir);
+    auto child = eds_backend::try_open_child(
+        entry.get_handle().get_ref(), directory_entry_number, "Failed to get directory entry");
+    if (!child)
+        return child.error();
 
-    return dir_impl;
+    return std::shared_ptr<directory_ref>(
+        std::make_shared<impl_directory_ref>(std::move(*child), transfers));
 }
 
 std::shared_ptr<directory_ref> impl_directory_ref::find_directory(std::string image_folder) const
 {
-    if (!is_folder)
-        throw std::logic_error("Not a directory");
-
-    for (volume_ref::size_type directory_entry_number = 0; directory_entry_number < count;
-         directory_entry_number++)
-    {
-        EdsDirectoryItemRef dir(nullptr);
-        THROW_ERRORS(
-            EdsGetChildAtIndex(ref.get_ref(), static_cast<EdsInt32>(directory_entry_number), &dir),
-            "directory_ref", "Failed to get directory entry");
-
-        std::shared_ptr<directory_ref> dir_impl = std::make_shared<impl_directory_ref>(dir);
+    ALLOCATION_SCOPE("enumeration");
+    auto dir = entry.find_directory(image_folder);
+    if (!dir)
+        return nullptr;
 
-        if ((dir_impl->is_a_folder()) && (dir_impl->get_name().compare(image_folder) == 0))
-            return dir_impl;
-    }
-
-    return nullptr;
+    return std::make_shared<impl_directory_ref>(std::move(*dir), transfers);
 }
 
 std::time_t impl_directory_ref::get_timestamp() const
 {
+    ALLOCATION_SCOPE("thumbnails");
     Poco::LocalDateTime date_time(0);
 
-    if (!is_folder)
+    if (!entry.is_a_folder())
     {
-        thumbnail t(ref.get_ref());
+        thumbnail t(entry.get_handle().get_ref());
         date_time = t.get_date_stamp();
     }
 
@@ -146,11 +191,12 @@ std::time_t impl_directory_ref::get_timestamp() const
 
 std::string impl_directory_ref::get_date_time() const
 {
+    ALLOCATION_SCOPE("thumbnails");
     Poco::LocalDateTime date_time(0);
 
-    if (!is_folder)
+    if (!entry.is_a_folder())
     {
-        thumbnail t(ref.get_ref());
+        thumbnail t(entry.get_handle().get_ref());
         date_time = t.get_date_stamp();
     }
 
@@ -158,8 +204,24 @@ std::string impl_directory_ref::get_date_time() const
                             : ""s;
 }
 
+std::vector<uint8_t> impl_directory_ref::download_thumbnail() const
+{
+    ALLOCATION_SCOPE("thumbnails");
+    if (entry.is_a_folder())
+        throw std::invalid_argument("Folders do not have thumbnails");
+
+    thumbnail t(entry.get_handle().get_ref(), true);
+    return t.get_data();
+}
+
 void impl_directory_ref::download_to(std::string destination) const
 {
+    try_download_to(std::move(destination)).value();
+}
+
+eds_result<void> impl_directory_ref::try_download_to(std::string destination) const
+{
+    ALLOCATION_SCOPE("download");
 #ifdef __MACOS__
     cfrelease_object<CFStringRef> destRef(
         CFStringCreateWithCString(kCFAllocatorDefault, destination.c_str(), kCFStringEncodingUTF8));
@@ -169,25 +231,140 @@ void impl_directory_ref::download_to(std::string destination) const
     const std::wstring dest_name = destination; // FIXME:
 #endif
 
+    const auto item = entry.get_handle().get_ref();
     EdsStreamRef output_stream(nullptr);
-    THROW_ERRORS(EdsCreateFileStreamEx(dest_name.get_obj(), kEdsFileCreateDisposition_CreateAlways,
-                     kEdsAccess_ReadWrite, &output_stream),
+    RETURN_ERRORS(EdsCreateFileStreamEx(dest_name.get_obj(), kEdsFileCreateDisposition_CreateAlways,
+                      kEdsAccess_ReadWrite, &output_stream),
         "directory_ref.download", "Failed to create target file");
 
     camera_ref_lock<EdsStreamRef> stream(output_stream);
 
-    try
+    if (transfers && !transfers->begin(item))
+        return eds_error { EDS_ERR_COMM_DISCONNECTED, "Camera disconnected", true };
+
+    const auto download_err
+        = TIME_EDS_CALL(EdsDownload(item, entry.get_file_size(), stream.get_ref()));
+
+    return end_download(item, download_err);
+}
+
+eds_result<void> impl_directory_ref::try_download_observed(
+    std::string destination, const download_observer& observer) const
+{
+    ALLOCATION_SCOPE("download");
+    std::ofstream output(destination, std::ios::binary | std::ios::trunc);
+    if (!output)
+        return eds_error { EDS_ERR_FILE_OPEN_ERROR, "Failed to create target file" };
+
+    // Each block is downloaded into memory, so it can be observed before it is written
+    EdsStreamRef block_stream(nullptr);
+    RETURN_ERRORS(EdsCreateMemoryStream(download_block_size, &block_stream),
+        "directory_ref.download", "Failed to create download buffer");
+
+    camera_ref_lock<EdsStreamRef> stream(block_stream);
+
+    const auto item = entry.get_handle().get_ref();
+    if (transfers && !transfers->begin(item))
+        return eds_error { EDS_ERR_COMM_DISCONNECTED, "Camera disconnected", true };
+
+    EdsError download_err = EDS_ERR_OK;
+    bool written = true;
+    for (uint64_t done = 0; done < entry.get_file_size() && written;)
     {
-        THROW_ERRORS(EdsDownload(ref.get_ref(), file_size, stream.get_ref()),
-            "directory_ref.download", "Failed to download file");
+        const auto block = std::min(download_block_size, entry.get_file_size() - done);
+        EdsVoid* data = nullptr;
+        download_err = EdsSeek(stream.get_ref(), 0, kEdsSeek_Begin);
+        if (download_err == EDS_ERR_OK)
+            download_err = TIME_EDS_CALL(EdsDownload(item, block, stream.get_ref()));
+        if (download_err == EDS_ERR_OK)
+            download_err = EdsGetPointer(stream.get_ref(), &data);
+        if (download_err != EDS_ERR_OK)
+            break;
+
+        observer(static_cast<const uint8_t*>(data), static_cast<std::size_t>(block));
+        written = static_cast<bool>(
+            output.write(static_cast<const char*>(data), static_cast<std::streamsize>(block)));
+        done += block;
     }
-    catch (...)
+
+    // A failed write is handled as a failed download, so the camera is told it was cancelled
+    if (download_err == EDS_ERR_OK && !(written && output.flush()))
+        download_err = EDS_ERR_FILE_WRITE_ERROR;
+
+    return end_download(item, download_err);
+}
+
+eds_result<void> impl_directory_ref::end_download(
+    EdsDirectoryItemRef item, EdsError download_err) const
+{
+    if (transfers)
+        transfers->end(item);
+
+    if (download_err != EDS_ERR_OK)
     {
-        EdsDownloadCancel(ref.get_ref());
-        throw;
+        // A disconnected camera has already had its downloads cancelled
+        if (transfers && transfers->is_disconnected())
+        {
+            CAMERA_LOG(download_log, error, "Download cancelled, camera disconnected (0x%s)",
+                int_to_hex(download_err));
+            return eds_error { download_err, "Camera disconnected during download", true };
+        }
+
+        TIME_EDS_CALL(EdsDownloadCancel(item));
+        RETURN_ERRORS(download_err, "directory_ref.download", "Failed to download file");
     }
 
-    EdsDownloadComplete(ref.get_ref());
+    TIME_EDS_CALL(EdsDownloadComplete(item));
+    return {};
+}
+
+void impl_directory_ref::delete_file()
+{
+    // Deleting a file that is being downloaded would fail the download
+    if (transfers && transfers->is_transferring(entry.get_handle().get_ref()))
+        throw std::logic_error("Can not delete a file while it is being downloaded");
+
+    entry.delete_file();
+}
+
+bool impl_transfer_state::begin(EdsDirectoryItemRef item)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (disconnected)
+        return false;
+
+    in_flight.insert(item);
+    return true;
+}
+
+void impl_transfer_state::end(EdsDirectoryItemRef item)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    in_flight.erase(item);
+}
+
+bool impl_transfer_state::is_transferring(EdsDirectoryItemRef item)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return in_flight.count(item) != 0;
+}
+
+bool impl_transfer_state::has_transfers()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return !in_flight.empty();
+}
+
+void impl_transfer_state::cancel_all()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    disconnected = true;
+
+    for (auto item : in_flight)
+    {
+        CAMERA_LOG(download_log, warning, "Cancelling download");
+        TIME_EDS_CALL(EdsDownloadCancel(item));
+    }
 }
 
 } // namespace implementation
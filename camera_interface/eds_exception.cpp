@@ -17,13 +17,36 @@
 
 #include "EDSDK.h"
 
-static std::string format_error(std::string message, int err, std::string method)
+#include <sstream>
+
+static std::string format_error(const std::string& message, int err, const std::string& method)
+{
+    std::ostringstream text;
+    text << message << " (Error " << err << " [0x" << std::uppercase << std::hex
+         << static_cast<unsigned int>(err) << ']';
+    if (!method.empty())
+        text << " in method " << method;
+    text << ')';
+    return text.str();
+}
+
+eds_exception::eds_exception(std::string message, int err, std::string method)
+    : std::runtime_error(format_error(message, err, method))
+    , code(err)
+{
+}
+
+bool eds_error::is_busy() const { return code == EDS_ERR_DEVICE_BUSY; }
+
+bool eds_error::is_disconnected() const
 {
-    char buffer[42];
-    sprintf(buffer, " (Error %d [0x%X]", err, err);
-    return message + buffer + ((!method.empty()) ? (" in method " + method):"") + ")";
+    return camera_disconnected || code == EDS_ERR_COMM_DISCONNECTED
+        || code == EDS_ERR_COMM_USB_BUS_ERR || code == EDS_ERR_DEVICE_NOT_FOUND;
 }
 
-eds_exception::eds_exception(std::string message, int err, std::string method) : std::runtime_error(format_error(message, err, method))
+void throw_eds_error(const eds_error& error, const char* method)
 {
+    if (error.is_disconnected())
+        throw camera_disconnected_exception(error.message, static_cast<int>(error.code), method);
+    throw eds_exception(error.message, static_cast<int>(error.code), method);
 }
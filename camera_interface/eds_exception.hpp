@@ -5,10 +5,147 @@
 //  Created by Rob McKay on 08/01/2021.
 //
 
+#pragma once
+
+#include <cstdint>
+#include <optional>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
 
 class eds_exception : public std::runtime_error
 {
+    int code;
+
 public:
     eds_exception(std::string message, int err, std::string method = "");
+
+    /// The EdsError code
+    int error_code() const { return code; }
 };
+
+/// Thrown when an operation fails because the camera was disconnected or shut down
+class camera_disconnected_exception : public eds_exception
+{
+public:
+    using eds_exception::eds_exception;
+};
+
+/// An error returned by the Canon SDK, and what was being done when it happened
+struct eds_error
+{
+    uint32_t code;
+    /// A string literal, e.g. "Failed to get directory entry"
+    const char* message;
+    /// Set when the operation failed because the camera went away, whatever the code
+    bool camera_disconnected = false;
+
+    /// The camera was busy, so the operation can be tried again
+    bool is_busy() const;
+    bool is_disconnected() const;
+};
+
+/// Throw error as camera_disconnected_exception if the camera has gone, otherwise as
+/// eds_exception
+[[noreturn]] void throw_eds_error(const eds_error& error, const char* method = "");
+
+/// The value of an operation that can fail with an SDK error, or the error. Loops over thousands
+/// of files can skip or retry the files that fail without the cost of throwing; value() throws
+/// the error as the throwing API does. Only SDK errors are returned: misuse, such as an entry
+/// number out of range, still throws.
+template <typename T> class eds_result
+{
+    std::variant<T, eds_error> result;
+
+public:
+    eds_result(T value)
+        : result(std::in_place_index<0>, std::move(value))
+    {
+    }
+
+    eds_result(eds_error error)
+        : result(std::in_place_index<1>, error)
+    {
+    }
+
+    bool has_value() const { return result.index() == 0; }
+    explicit operator bool() const { return has_value(); }
+    /// The error, if there is no value
+    const eds_error& error() const { return std::get<1>(result); }
+
+    T& value() &
+    {
+        if (!has_value())
+            throw_eds_error(error());
+        return std::get<0>(result);
+    }
+
+    const T& value() const&
+    {
+        if (!has_value())
+            throw_eds_error(error());
+        return std::get<0>(result);
+    }
+
+    T&& value() &&
+    {
+        if (!has_value())
+            throw_eds_error(error());
+        return std::get<0>(std::move(result));
+    }
+
+    /// The value, which must be there
+    T& operator*() { return std::get<0>(result); }
+    const T& operator*() const { return std::get<0>(result); }
+    T* operator->() { return &std::get<0>(result); }
+    const T* operator->() const { return &std::get<0>(result); }
+};
+
+/// The result of an operation that only returns whether it worked
+template <> class eds_result<void>
+{
+    std::optional<eds_error> failure;
+
+public:
+    eds_result() = default;
+
+    eds_result(eds_error error)
+        : failure(error)
+    {
+    }
+
+    bool has_value() const { return !failure; }
+    explicit operator bool() const { return has_value(); }
+    const eds_error& error() const { return *failure; }
+
+    void value() const
+    {
+        if (failure)
+            throw_eds_error(*failure);
+    }
+};
+
+/// Call operation and return its value, or the error it throws as an eds_exception. This gives
+/// implementations that only have the throwing API the eds_result one.
+template <typename Operation>
+auto catch_eds_error(Operation operation, const char* message)
+    -> eds_result<decltype(operation())>
+{
+    try
+    {
+        if constexpr (std::is_void_v<decltype(operation())>)
+        {
+            operation();
+            return {};
+        }
+        else
+            return operation();
+    }
+    catch (const eds_exception& ex)
+    {
+        return eds_error { static_cast<uint32_t>(ex.error_code()), message,
+            dynamic_cast<const camera_disconnected_exception*>(&ex) != nullptr };
+    }
+}
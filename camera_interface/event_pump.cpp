@@ -0,0 +1,83 @@
+//
+//  event_pump.cpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#if !defined __MACOS__
+#if defined __APPLE__ && defined __MACH__
+#define __MACOS__ 1
+#else
+#error "Only for MacOS"
+#endif
+#endif
+
+#include "camera_interface.hpp"
+#include "camera_interface_impl.hpp"
+
+#include "EDSDK.h"
+
+#include "Poco/Logger.h"
+
+#include <memory>
+#include <mutex>
+
+namespace implementation
+{
+impl_event_pump::impl_event_pump()
+    : running(true)
+{
+    thread = std::thread(&impl_event_pump::run, this);
+}
+
+impl_event_pump::~impl_event_pump()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+void impl_event_pump::run()
+{
+    CAMERA_LOG(event_pump_log, debug, "Event pump started");
+    set_trace_thread_name("sdk events");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running)
+    {
+        lock.unlock();
+        {
+            // Any registered handlers are called from within EdsGetEvent
+            const std::lock_guard<std::recursive_mutex> dispatch(dispatching);
+            if (auto err = TIME_EDS_CALL(EdsGetEvent()); err != EDS_ERR_OK)
+                CAMERA_LOG(event_pump_log, error, "Failed to get events (0x%s)", int_to_hex(err));
+        }
+        lock.lock();
+
+        wake.wait_for(lock, interval, [this] { return !running; });
+    }
+
+    CAMERA_LOG(event_pump_log, debug, "Event pump stopped");
+}
+
+std::shared_ptr<impl_event_pump> impl_event_pump::acquire()
+{
+    static std::mutex instance_mutex;
+    static std::weak_ptr<impl_event_pump> instance;
+
+    std::lock_guard<std::mutex> lock(instance_mutex);
+    auto pump = instance.lock();
+    if (!pump)
+    {
+        pump = std::make_shared<impl_event_pump>();
+        instance = pump;
+    }
+
+    return pump;
+}
+
+} // namespace implementation
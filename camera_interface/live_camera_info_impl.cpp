@@ -0,0 +1,99 @@
+//
+//  live_camera_info_impl.cpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#if !defined __MACOS__
+#if defined __APPLE__ && defined __MACH__
+#define __MACOS__ 1
+#else
+#error "Only for MacOS"
+#endif
+#endif
+
+#include "camera_interface.hpp"
+#include "camera_interface_impl.hpp"
+
+#include "EDSDK.h"
+
+#include "Poco/Logger.h"
+
+#include <algorithm>
+
+namespace implementation
+{
+impl_live_camera_info::impl_live_camera_info(camera_ref_lock<EdsCameraRef> camera)
+    : ref(camera)
+    , snapshot(std::make_shared<impl_camera_info>(camera))
+    , any_changed(false)
+{
+    for (auto& flag : changed)
+        flag = false;
+
+    events = impl_event_pump::acquire();
+    THROW_ERRORS(EdsSetPropertyEventHandler(
+                     ref.get_ref(), kEdsPropertyEvent_All, property_event, this),
+        "live_camera_info", "Failed to set property event handler");
+}
+
+impl_live_camera_info::~impl_live_camera_info()
+{
+    // The last reference can be dropped on any thread, so wait for a property_event call that is
+    // running on the event thread to finish before this goes
+    const auto holding = events->hold_events();
+    TIME_EDS_CALL(
+        EdsSetPropertyEventHandler(ref.get_ref(), kEdsPropertyEvent_All, nullptr, nullptr));
+}
+
+EdsError EDSCALLBACK impl_live_camera_info::property_event(
+    EdsPropertyEvent event, EdsPropertyID id, EdsUInt32, EdsVoid* context)
+{
+    if (event != kEdsPropertyEvent_PropertyChanged)
+        return EDS_ERR_OK;
+
+    // Runs on the event thread, so only mark the property as changed; it is read again by the
+    // next get_snapshot call.
+    auto info = static_cast<impl_live_camera_info*>(context);
+    const auto& ids = impl_camera_info::property_ids;
+    const auto found = std::find(ids.begin(), ids.end(), id);
+    if (found != ids.end())
+    {
+        info->changed[found - ids.begin()] = true;
+        info->any_changed = true;
+    }
+
+    return EDS_ERR_OK;
+}
+
+std::shared_ptr<const camera_info> impl_live_camera_info::get_snapshot()
+{
+    if (any_changed)
+    {
+        std::lock_guard<std::mutex> lock(update_mutex);
+
+        if (any_changed.exchange(false))
+        {
+            // Copy on write, so snapshots already handed out never change
+            auto updated = std::make_shared<impl_camera_info>(*std::atomic_load(&snapshot));
+
+            for (size_t i = 0; i < changed.size(); i++)
+            {
+                if (changed[i].exchange(false))
+                {
+                    const auto id = impl_camera_info::property_ids[i];
+                    CAMERA_LOG(
+                        live_camera_info_log, debug, "Property 0x%s changed", int_to_hex(id));
+                    updated->read_property(ref.get_ref(), id);
+                }
+            }
+
+            std::atomic_store(&snapshot, std::shared_ptr<const impl_camera_info>(updated));
+        }
+    }
+
+    return std::atomic_load(&snapshot);
+}
+
+} // namespace implementation
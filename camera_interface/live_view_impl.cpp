@@ -0,0 +1,182 @@
+//
+//  live_view_impl.cpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#if !defined __MACOS__
+#if defined __APPLE__ && defined __MACH__
+#define __MACOS__ 1
+#else
+#error "Only for MacOS"
+#endif
+#endif
+
+#include "camera_interface.hpp"
+#include "camera_interface_impl.hpp"
+
+#include "EDSDK.h"
+
+#include "Poco/Logger.h"
+
+#include <stdexcept>
+
+namespace implementation
+{
+impl_live_view::impl_live_view(camera_ref_lock<EdsCameraRef> camera_lock, std::size_t buffer_frames)
+    : camera(camera_lock)
+{
+    if (buffer_frames < 2)
+        throw std::invalid_argument("Live view needs at least 2 frame buffers");
+
+    for (std::size_t i = 0; i < buffer_frames; i++)
+    {
+        auto stream = create_memory_stream();
+        EdsEvfImageRef image(nullptr);
+        THROW_ERRORS(EdsCreateEvfImageRef(stream.get_ref(), &image), "live_view",
+            "Failed to create live view image");
+        slots.push_back(std::make_unique<frame_slot>(std::move(stream), image));
+        // The slot holds its own reference to the image
+        EdsRelease(image);
+    }
+
+    if (TIME_EDS_CALL(EdsGetPropertyData(camera.get_ref(), kEdsPropID_Evf_OutputDevice, 0,
+            sizeof(previous_output_device), &previous_output_device))
+        != EDS_ERR_OK)
+        previous_output_device = 0;
+
+    const EdsUInt32 output_device = previous_output_device | kEdsEvfOutputDevice_PC;
+    THROW_ERRORS(EdsSetPropertyData(camera.get_ref(), kEdsPropID_Evf_OutputDevice, 0,
+                     sizeof(output_device), &output_device),
+        "live_view", "Failed to start live view");
+
+    thread = std::thread(&impl_live_view::run, this);
+}
+
+impl_live_view::~impl_live_view() { stop(); }
+
+void impl_live_view::stop()
+{
+    running = false;
+    frame_ready.notify_all();
+
+    if (!thread.joinable())
+        return;
+    thread.join();
+
+    if (auto err = TIME_EDS_CALL(EdsSetPropertyData(camera.get_ref(),
+            kEdsPropID_Evf_OutputDevice, 0, sizeof(previous_output_device), &previous_output_device));
+        err != EDS_ERR_OK)
+    {
+        CAMERA_LOG(live_view_log, warning, "Failed to stop live view (0x%s)", int_to_hex(err));
+    }
+}
+
+void impl_live_view::run()
+{
+    set_trace_thread_name("live view");
+
+    uint64_t sequence = 0;
+
+    while (running)
+    {
+        auto& slot = *slots[sequence % slots.size()];
+        bool downloaded;
+        {
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            downloaded = download_frame(slot, sequence + 1);
+        }
+
+        if (!downloaded)
+        {
+            // The camera has no frame ready yet (e.g. live view is still starting)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+
+        sequence++;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            latest_sequence = sequence;
+            if (sequence == 1)
+                first_frame_at = slot.captured_at;
+            latest_frame_at = slot.captured_at;
+            total_latency += slot.latency;
+            max_latency = std::max(max_latency, slot.latency);
+        }
+        frame_ready.notify_all();
+    }
+}
+
+bool impl_live_view::download_frame(frame_slot& slot, uint64_t sequence)
+{
+    // Reuse the stream's memory by writing the frame from the start again
+    TIME_EDS_CALL(EdsSeek(slot.stream.get_ref(), 0, kEdsSeek_Begin));
+
+    const auto started = std::chrono::steady_clock::now();
+    const auto err = TIME_EDS_CALL(EdsDownloadEvfImage(camera.get_ref(), slot.image.get_ref()));
+    if (err == EDS_ERR_OBJECT_NOTREADY)
+        return false;
+
+    if (err != EDS_ERR_OK)
+    {
+        CAMERA_LOG(
+            live_view_log, error, "Failed to download live view image (0x%s)", int_to_hex(err));
+        running = false;
+        return false;
+    }
+
+    EdsUInt64 size(0);
+    TIME_EDS_CALL(EdsGetPosition(slot.stream.get_ref(), &size));
+
+    slot.sequence = sequence;
+    slot.size = static_cast<std::size_t>(size);
+    slot.captured_at = std::chrono::steady_clock::now();
+    slot.latency
+        = std::chrono::duration_cast<std::chrono::microseconds>(slot.captured_at - started);
+    return true;
+}
+
+bool impl_live_view::next_frame(
+    uint64_t after_sequence, std::chrono::milliseconds timeout, const consumer_t& consumer)
+{
+    uint64_t sequence;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        frame_ready.wait_for(
+            lock, timeout, [&] { return latest_sequence > after_sequence || !running; });
+        if (latest_sequence <= after_sequence)
+            return false;
+        sequence = latest_sequence;
+    }
+
+    // The frame is read in place; the frame thread waits for this slot if it gets round to it
+    auto& slot = *slots[(sequence - 1) % slots.size()];
+    std::lock_guard<std::mutex> lock(slot.mutex);
+
+    EdsVoid* pointer(nullptr);
+    THROW_ERRORS(EdsGetPointer(slot.stream.get_ref(), &pointer), "live_view",
+        "Failed to get live view image data");
+
+    consumer({ slot.sequence,
+        gsl::span<const uint8_t>(static_cast<const uint8_t*>(pointer), slot.size),
+        slot.captured_at, slot.latency });
+    return true;
+}
+
+live_view_stats impl_live_view::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    live_view_stats stats { latest_sequence, 0.0, std::chrono::microseconds(0), max_latency };
+    if (latest_sequence > 0)
+        stats.mean_latency = total_latency / latest_sequence;
+
+    const std::chrono::duration<double> elapsed = latest_frame_at - first_frame_at;
+    if (latest_sequence > 1 && elapsed.count() > 0)
+        stats.frames_per_second = static_cast<double>(latest_sequence - 1) / elapsed.count();
+
+    return stats;
+}
+}
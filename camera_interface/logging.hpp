@@ -0,0 +1,73 @@
+//
+//  logging.hpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#pragma once
+
+#include <atomic>
+
+#include "Poco/Logger.h"
+
+/* The classes below are not exported */
+#pragma GCC visibility push(hidden)
+
+namespace implementation
+{
+/// A logger that is looked up by name the first time it is used rather than for every message,
+/// as Poco::Logger::get takes a global lock. It can be constant initialised, so a static one is
+/// safe to use from anywhere.
+class component_logger
+{
+    const char* const name;
+    std::atomic<Poco::Logger*> logger { nullptr };
+
+public:
+    constexpr explicit component_logger(const char* logger_name)
+        : name(logger_name)
+    {
+    }
+
+    component_logger(const component_logger&) = delete;
+    component_logger& operator=(const component_logger&) = delete;
+
+    Poco::Logger& get()
+    {
+        auto found = logger.load(std::memory_order_acquire);
+        if (!found)
+        {
+            // Loggers live as long as the program, so racing threads store the same one
+            found = &Poco::Logger::get(name);
+            logger.store(found, std::memory_order_release);
+        }
+        return *found;
+    }
+};
+
+/// The loggers used by the library
+inline component_logger camera_connection_log("camera_connection");
+inline component_logger camera_list_log("camera_list");
+inline component_logger camera_ref_log("camera_ref");
+inline component_logger camera_info_log("camera_info");
+inline component_logger live_camera_info_log("live_camera_info");
+inline component_logger volume_ref_log("volume_ref");
+inline component_logger directory_ref_log("directory_ref");
+inline component_logger download_log("directory_ref.download");
+inline component_logger event_pump_log("event_pump");
+inline component_logger live_view_log("live_view");
+} // namespace implementation
+
+#pragma GCC visibility pop
+
+/// Log a message to a component_logger at level (debug, notice, warning, error...). The message
+/// and its arguments are only evaluated when the logger's level lets the message through, so a
+/// disabled message costs a level check.
+#define CAMERA_LOG(component, level, ...)                                                          \
+    do                                                                                             \
+    {                                                                                              \
+        Poco::Logger& camera_logger = (component).get();                                           \
+        if (camera_logger.level())                                                                 \
+            camera_logger.level(__VA_ARGS__);                                                      \
+    } while (false)
@@ -0,0 +1,435 @@
+//
+//  mounted_volume_impl.cpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#include "mounted_volume_impl.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined __linux__
+#include <sys/sendfile.h>
+#elif defined __APPLE__
+#include <copyfile.h>
+#endif
+
+namespace implementation
+{
+namespace
+{
+    /// Object format codes, as the SDK reports them (kEdsObjectFormat_*)
+    constexpr directory_ref::format_t format_unknown = 0;
+    constexpr directory_ref::format_t format_jpeg = 0x3801;
+    constexpr directory_ref::format_t format_cr2 = 0xB103;
+    constexpr directory_ref::format_t format_cr3 = 0xB108;
+
+    /// Largest amount copied by one system call
+    constexpr uint64_t max_copy_chunk = 1ull << 30;
+
+    directory_ref::format_t format_of(const std::filesystem::path& path)
+    {
+        auto extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+            [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+
+        if (extension == ".CR2")
+            return format_cr2;
+        if (extension == ".CR3")
+            return format_cr3;
+        if (extension == ".JPG" || extension == ".JPEG")
+            return format_jpeg;
+        return format_unknown;
+    }
+
+    [[noreturn]] void throw_errno(const std::string& message)
+    {
+        throw std::system_error(errno, std::generic_category(), message);
+    }
+
+    class file_descriptor
+    {
+        int fd;
+
+    public:
+        explicit file_descriptor(int opened)
+            : fd(opened)
+        {
+        }
+
+        ~file_descriptor()
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+
+        file_descriptor(const file_descriptor&) = delete;
+        file_descriptor& operator=(const file_descriptor&) = delete;
+
+        int get() const { return fd; }
+    };
+
+    /// Copy the rest of in to out through a buffer, for when the kernel can not do it
+    uint64_t copy_through_buffer(int in, int out)
+    {
+        std::vector<char> buffer(1024 * 1024);
+        uint64_t copied = 0;
+        for (;;)
+        {
+            const auto read_size = ::read(in, buffer.data(), buffer.size());
+            if (read_size < 0 && errno == EINTR)
+                continue;
+            if (read_size < 0)
+                throw_errno("Failed to read file");
+            if (read_size == 0)
+                return copied;
+
+            for (ssize_t written = 0; written < read_size;)
+            {
+                const auto write_size = ::write(out, buffer.data() + written, read_size - written);
+                if (write_size < 0 && errno == EINTR)
+                    continue;
+                if (write_size < 0)
+                    throw_errno("Failed to write file");
+                written += write_size;
+            }
+            copied += static_cast<uint64_t>(read_size);
+        }
+    }
+
+    /// Pass the contents of path to observer a block at a time
+    void read_file_contents(
+        const std::filesystem::path& path, const directory_ref::download_observer& observer)
+    {
+        const file_descriptor in(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (in.get() < 0)
+            throw_errno("Failed to open " + path.string());
+
+        std::vector<uint8_t> buffer(1024 * 1024);
+        for (;;)
+        {
+            const auto read_size = ::read(in.get(), buffer.data(), buffer.size());
+            if (read_size < 0 && errno == EINTR)
+                continue;
+            if (read_size < 0)
+                throw_errno("Failed to read " + path.string());
+            if (read_size == 0)
+                return;
+
+            observer(buffer.data(), static_cast<std::size_t>(read_size));
+        }
+    }
+
+#if defined __linux__
+    /// Errors that mean this way of copying is not supported for these files, rather than that
+    /// the copy failed
+    bool is_unsupported(int error)
+    {
+        return error == EXDEV || error == EINVAL || error == ENOSYS || error == EOPNOTSUPP
+            || error == EPERM;
+    }
+
+    /// Copy size bytes from in to out with copy_file_range, which lets the file systems copy the
+    /// data (or share it), falling back to sendfile, which copies in the kernel between any two
+    /// files, and then to a buffer.
+    uint64_t copy_in_kernel(int in, int out, uint64_t size)
+    {
+        bool use_copy_file_range = true;
+        bool use_sendfile = true;
+        uint64_t copied = 0;
+
+        while (copied < size)
+        {
+            const auto chunk = static_cast<size_t>(std::min(size - copied, max_copy_chunk));
+            ssize_t copy_size = 0;
+            if (use_copy_file_range)
+            {
+                copy_size = ::copy_file_range(in, nullptr, out, nullptr, chunk, 0);
+                if (copy_size < 0 && copied == 0 && is_unsupported(errno))
+                {
+                    use_copy_file_range = false;
+                    continue;
+                }
+            }
+            else if (use_sendfile)
+            {
+                copy_size = ::sendfile(out, in, nullptr, chunk);
+                if (copy_size < 0 && copied == 0 && is_unsupported(errno))
+                {
+                    use_sendfile = false;
+                    continue;
+                }
+            }
+            else
+            {
+                return copied + copy_through_buffer(in, out);
+            }
+
+            if (copy_size < 0 && errno == EINTR)
+                continue;
+            if (copy_size < 0)
+                throw_errno("Failed to copy file");
+            if (copy_size == 0)
+                break;
+
+            copied += static_cast<uint64_t>(copy_size);
+        }
+
+        return copied;
+    }
+#endif
+} // namespace
+
+void copy_file_contents(
+    const std::filesystem::path& source, const std::filesystem::path& destination)
+{
+    const file_descriptor in(::open(source.c_str(), O_RDONLY | O_CLOEXEC));
+    if (in.get() < 0)
+        throw_errno("Failed to open " + source.string());
+
+    struct stat source_stat;
+    if (::fstat(in.get(), &source_stat) != 0)
+        throw_errno("Failed to read the size of " + source.string());
+
+    const file_descriptor out(
+        ::open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+    if (out.get() < 0)
+        throw_errno("Failed to create " + destination.string());
+
+    const auto size = static_cast<uint64_t>(source_stat.st_size);
+#if defined __linux__
+    // Card readers are read from start to end, so ask for more read ahead
+    ::posix_fadvise(in.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    const auto copied = copy_in_kernel(in.get(), out.get(), size);
+#elif defined __APPLE__
+    if (::fcopyfile(in.get(), out.get(), nullptr, COPYFILE_DATA) != 0)
+        throw_errno("Failed to copy " + source.string());
+    const auto copied = size;
+#else
+    const auto copied = copy_through_buffer(in.get(), out.get());
+#endif
+
+    if (copied != size)
+        throw std::runtime_error("The size of " + source.string() + " changed while it was copied");
+}
+
+} // namespace implementation
+
+card_entry card_reader_backend::open(std::filesystem::path path)
+{
+    using implementation::throw_errno;
+
+    struct stat item;
+    if (::stat(path.c_str(), &item) != 0)
+        throw_errno("Failed to read " + path.string());
+
+    directory_entry_info info;
+    info.name = path.filename().string();
+    info.is_folder = S_ISDIR(item.st_mode);
+
+    handle_type handle;
+    handle.modified = item.st_mtime;
+
+    if (info.is_folder)
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(path))
+        {
+            // Skip hidden files, e.g. the ones macOS leaves on cards
+            auto name = entry.path().filename().string();
+            if (!name.empty() && name[0] != '.')
+                handle.entries.push_back(std::move(name));
+        }
+        std::sort(handle.entries.begin(), handle.entries.end());
+        info.count = handle.entries.size();
+    }
+    else
+    {
+        info.file_size = static_cast<uint64_t>(item.st_size);
+        info.format = implementation::format_of(path);
+    }
+
+    handle.path = std::move(path);
+    return card_entry(std::move(handle), std::move(info));
+}
+
+card_entry card_reader_backend::open_child(const handle_type& folder, std::size_t index)
+{
+    return open(folder.path / folder.entries[index]);
+}
+
+std::optional<card_entry> card_reader_backend::find_directory(
+    const card_entry& folder, const std::string& name)
+{
+    const auto& entries = folder.get_handle().entries;
+    if (!std::binary_search(entries.begin(), entries.end(), name))
+        return std::nullopt;
+
+    auto dir = open(folder.get_handle().path / name);
+    if (!dir.is_a_folder())
+        return std::nullopt;
+    return dir;
+}
+
+std::vector<card_entry> card_reader_backend::find_matching_entries(
+    const card_entry& folder, const std::regex& filename_expression)
+{
+    std::vector<card_entry> list;
+    for (const auto& name : folder.get_handle().entries)
+    {
+        if (std::regex_match(name, filename_expression))
+            list.emplace_back(open(folder.get_handle().path / name));
+    }
+
+    return list;
+}
+
+void card_reader_backend::download_to(const handle_type& file, const std::string& destination)
+{
+    implementation::copy_file_contents(file.path, destination);
+}
+
+void card_reader_backend::delete_file(handle_type& file)
+{
+    std::filesystem::remove(file.path);
+}
+
+namespace implementation
+{
+impl_mounted_directory_ref::impl_mounted_directory_ref(card_entry card_item)
+    : entry(std::move(card_item))
+{
+}
+
+impl_mounted_directory_ref::~impl_mounted_directory_ref() { }
+
+std::string impl_mounted_directory_ref::get_date_time() const
+{
+    if (entry.is_a_folder())
+        return "";
+
+    std::tm local;
+    localtime_r(&entry.get_handle().modified, &local);
+
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%d-%b-%Y %H:%M:%S", &local);
+    return buf;
+}
+
+void impl_mounted_directory_ref::download_to(std::string destination) const
+{
+    entry.download_to(destination);
+}
+
+eds_result<void> impl_mounted_directory_ref::try_download_observed(
+    std::string destination, const download_observer& observer) const
+{
+    entry.download_to(destination);
+    read_file_contents(entry.get_handle().path, observer);
+    return {};
+}
+
+std::vector<uint8_t> impl_mounted_directory_ref::download_thumbnail() const
+{
+    // Reading the thumbnail from the EXIF data needs the SDK
+    throw std::runtime_error("Thumbnails are not available for files on a card reader");
+}
+
+volume_ref::size_type impl_mounted_directory_ref::get_directory_count() const
+{
+    return entry.get_directory_count();
+}
+
+std::shared_ptr<directory_ref> impl_mounted_directory_ref::get_directory_entry(
+    volume_ref::size_type directory_entry_number) const
+{
+    return std::make_shared<impl_mounted_directory_ref>(
+        entry.get_directory_entry(directory_entry_number));
+}
+
+std::shared_ptr<directory_ref> impl_mounted_directory_ref::find_directory(
+    std::string image_folder) const
+{
+    auto dir = entry.find_directory(image_folder);
+    if (!dir)
+        return nullptr;
+
+    return std::make_shared<impl_mounted_directory_ref>(std::move(*dir));
+}
+
+impl_mounted_volume_ref::impl_mounted_volume_ref(std::filesystem::path mounted_at)
+    : root(card_reader_backend::open(mounted_at))
+    , mount_point(std::move(mounted_at))
+    , max_capacity(0)
+    , free_space(0)
+    , access(access_type_t::unknown)
+{
+    if (!root.is_a_folder())
+        throw std::invalid_argument(mount_point.string() + " is not a folder");
+
+    // Sizes are in KB, as the camera reports them
+    max_capacity = std::filesystem::space(mount_point).capacity / 1024;
+    read_free_space();
+
+    access = (::access(mount_point.c_str(), W_OK) == 0) ? access_type_t::read_write
+                                                         : access_type_t::read;
+}
+
+impl_mounted_volume_ref::~impl_mounted_volume_ref() { }
+
+uint64_t impl_mounted_volume_ref::read_free_space()
+{
+    free_space = std::filesystem::space(mount_point).available / 1024;
+    return free_space;
+}
+
+std::string impl_mounted_volume_ref::get_label() const
+{
+    // Cards are mounted under their label, e.g. /media/rob/EOS_DIGITAL
+    auto path = std::filesystem::absolute(mount_point).lexically_normal();
+    if (!path.has_filename())
+        path = path.parent_path();
+
+    const auto label = path.filename().string();
+    return label.empty() ? mount_point.string() : label;
+}
+
+std::shared_ptr<directory_ref> impl_mounted_volume_ref::select_directory(
+    size_type directory_number)
+{
+    return std::make_shared<impl_mounted_directory_ref>(
+        root.get_directory_entry(directory_number));
+}
+
+std::vector<std::shared_ptr<directory_ref>> impl_mounted_volume_ref::find_matching_files(
+    std::string image_folder, std::regex filename_expression)
+{
+    const auto dcim_dir = root.find_directory("DCIM");
+    if (!dcim_dir)
+        return {};
+
+    const auto image_dir = dcim_dir->find_directory(image_folder);
+    if (!image_dir)
+        return {};
+
+    std::vector<std::shared_ptr<directory_ref>> list;
+    for (auto& file : image_dir->find_matching_entries(filename_expression))
+        list.emplace_back(std::make_shared<impl_mounted_directory_ref>(std::move(file)));
+
+    return list;
+}
+
+} // namespace implementation
+
+std::shared_ptr<volume_ref> open_mounted_volume(const std::string& mount_point)
+{
+    return std::make_shared<implementation::impl_mounted_volume_ref>(mount_point);
+}
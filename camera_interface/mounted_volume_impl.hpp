@@ -0,0 +1,95 @@
+//
+//  mounted_volume_impl.hpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#pragma once
+
+#include "camera_interface.hpp"
+
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+/* The classes below are not exported */
+#pragma GCC visibility push(hidden)
+
+namespace implementation
+{
+/// A folder or file on a card in a card reader, adapting a card_entry to directory_ref. The
+/// files are read directly, without the SDK, so none of this depends on EDSDK and it builds on
+/// any POSIX platform.
+class impl_mounted_directory_ref : public directory_ref
+{
+    card_entry entry;
+
+public:
+    explicit impl_mounted_directory_ref(card_entry card_item);
+    virtual ~impl_mounted_directory_ref();
+
+    size_type get_file_size() const override { return entry.get_file_size(); }
+    format_t get_format() const override { return entry.get_format(); }
+    std::string get_name() const override { return entry.get_name(); }
+    bool is_a_folder() const override { return entry.is_a_folder(); };
+    std::string get_date_time() const override;
+    /// The time the file was last written. Cameras set this to when the picture was taken.
+    std::time_t get_timestamp() const override
+    {
+        return entry.is_a_folder() ? 0 : entry.get_handle().modified;
+    }
+    uint32_t get_group_ID() const override { return 0; }
+    void download_to(std::string destination) const override;
+    /// The file is copied as download_to does, then read from the card for observer
+    eds_result<void> try_download_observed(
+        std::string destination, const download_observer& observer) const override;
+    void delete_file() override { entry.delete_file(); }
+    std::vector<uint8_t> download_thumbnail() const override;
+
+    volume_ref::size_type get_directory_count() const override;
+    std::shared_ptr<directory_ref> get_directory_entry(
+        volume_ref::size_type directory_entry_number) const override;
+    std::shared_ptr<directory_ref> find_directory(std::string image_folder) const override;
+
+    const card_entry& get_entry() const { return entry; }
+};
+
+/// A card in a card reader, mounted at mount_point (the folder with DCIM in it)
+class impl_mounted_volume_ref : public volume_ref
+{
+    card_entry root;
+    std::filesystem::path mount_point;
+    uint64_t max_capacity;
+    uint64_t free_space;
+    access_type_t access;
+
+public:
+    explicit impl_mounted_volume_ref(std::filesystem::path mounted_at);
+    virtual ~impl_mounted_volume_ref();
+
+    uint64_t get_max_capacity() const override { return max_capacity; }
+    uint64_t get_free_space() const override { return free_space; }
+    uint64_t read_free_space() override;
+    std::string get_label() const override;
+    storage_type_t get_storage_type() const override { return storage_type_t::none; }
+    access_type_t get_access() const override { return access; }
+
+    size_type get_directory_count() const override { return root.get_directory_count(); }
+    std::shared_ptr<directory_ref> select_directory(size_type directory_number) override;
+
+    std::vector<std::shared_ptr<directory_ref>> find_matching_files(
+        std::string image_folder, std::regex filename_expression) override;
+};
+
+/// Copy the file source to destination, replacing it, with the kernel doing the copy where it can
+/// (copy_file_range or sendfile on Linux, fcopyfile on macOS) so the data is not copied through
+/// user space. Throws std::system_error if the copy fails.
+void copy_file_contents(
+    const std::filesystem::path& source, const std::filesystem::path& destination);
+} // namespace implementation
+
+#pragma GCC visibility pop
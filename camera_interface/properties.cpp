@@ -6,103 +6,240 @@
 //
 
 #include "properties.hpp"
+#include "api_stats.hpp"
 #include "eds_exception.hpp"
+#include <optional>
 #include <string>
+#include <type_traits>
 
 using namespace std::string_literals;
 
 static const std::string UNKNOWN = "<Unknown>"s;
 
-bool is_property_available(EdsBaseRef ref, EdsPropertyID id)
+static bool is_unavailable(EdsError err)
+{
+    return (err == EDS_ERR_PROPERTIES_UNAVAILABLE) || (err == EDS_ERR_PROTECTION_VIOLATION);
+}
+
+/// The value of result, or throw its error with the property id in the message, as
+/// camera_disconnected_exception if the camera has gone
+template <typename T> static T value_of(eds_result<T> result, EdsPropertyID id, const char* method)
+{
+    if (!result)
+    {
+        const auto& error = result.error();
+        const auto message = error.message + " "s + std::to_string(id);
+        if (error.is_disconnected())
+            throw camera_disconnected_exception(message, static_cast<int>(error.code), method);
+        throw eds_exception(message, static_cast<int>(error.code), method);
+    }
+
+    if constexpr (!std::is_void_v<T>)
+        return std::move(*result);
+}
+
+eds_result<bool> try_is_property_available(EdsBaseRef ref, EdsPropertyID id)
 {
     EdsDataType data_type = kEdsDataType_Unknown;
     EdsUInt32 data_size = 0;
 
-    if (auto err = EdsGetPropertySize(ref, id, 0, &data_type, &data_size); err != EDS_ERR_OK)
+    if (auto err = TIME_EDS_CALL(EdsGetPropertySize(ref, id, 0, &data_type, &data_size));
+        err != EDS_ERR_OK)
     {
-        switch (err)
-        {
-        case EDS_ERR_PROPERTIES_UNAVAILABLE:
-        case EDS_ERR_PROTECTION_VIOLATION:
+        if (is_unavailable(err))
             return false;
-        default:
-            throw eds_exception("Failed to read camera property metadata "s + std::to_string(id),
-                err, __FUNCTION__);
-        }
+
+        return eds_error { err, "Failed to read camera property metadata" };
     }
 
     return true;
 }
 
-void ensure_data_type_is(EdsDataType wanted_data_type, EdsPropertyID id, EdsBaseRef ref)
+bool is_property_available(EdsBaseRef ref, EdsPropertyID id)
+{
+    return value_of(try_is_property_available(ref, id), id, __FUNCTION__);
+}
+
+eds_result<void> check_data_type(EdsDataType wanted_data_type, EdsPropertyID id, EdsBaseRef ref)
 {
     EdsDataType data_type = kEdsDataType_Unknown;
     EdsUInt32 data_size = 0;
 
-    if (auto err = EdsGetPropertySize(ref, id, 0, &data_type, &data_size); err != EDS_ERR_OK)
+    if (auto err = TIME_EDS_CALL(EdsGetPropertySize(ref, id, 0, &data_type, &data_size));
+        err != EDS_ERR_OK)
     {
-        throw eds_exception(
-            "Failed to read camera property metadata "s + std::to_string(id), err, __FUNCTION__);
+        return eds_error { err, "Failed to read camera property metadata" };
     }
 
     if (data_type != wanted_data_type)
-        throw eds_exception("Invalid data type ("s + std::to_string(data_type)
-                + ") while reading camera property "s + std::to_string(id),
-            EDS_ERR_PROPERTIES_MISMATCH);
+        return eds_error { EDS_ERR_PROPERTIES_MISMATCH,
+            "Invalid data type while reading camera property" };
+
+    return {};
 }
 
-std::string get_camera_property_string(EdsBaseRef ref, EdsPropertyID id)
+void ensure_data_type_is(EdsDataType wanted_data_type, EdsPropertyID id, EdsBaseRef ref)
 {
-    char buffer[2048];
-    ensure_data_type_is(kEdsDataType_String, id, ref);
+    value_of(check_data_type(wanted_data_type, id, ref), id, __FUNCTION__);
+}
+
+/// Read a property of type T, after checking that the camera holds that type
+template <typename T>
+static eds_result<T> read_typed(EdsBaseRef ref, EdsPropertyID id, EdsDataType data_type)
+{
+    if (auto checked = check_data_type(data_type, id, ref); !checked)
+        return checked.error();
 
-    if (auto err = EdsGetPropertyData(ref, id, 0, sizeof(buffer), buffer); err != EDS_ERR_OK)
+    T buffer;
+    if (auto err = TIME_EDS_CALL(EdsGetPropertyData(ref, id, 0, sizeof(buffer), &buffer));
+        err != EDS_ERR_OK)
     {
-        throw eds_exception(
-            "Failed to read camera property "s + std::to_string(id), err, __FUNCTION__);
+        return eds_error { err, "Failed to read camera property" };
     }
 
     return buffer;
 }
 
-int32_t get_camera_property_int32(EdsBaseRef ref, EdsPropertyID id)
+eds_result<std::string> try_get_camera_property_string(EdsBaseRef ref, EdsPropertyID id)
 {
-    ensure_data_type_is(kEdsDataType_Int32, id, ref);
+    if (auto checked = check_data_type(kEdsDataType_String, id, ref); !checked)
+        return checked.error();
 
-    int32_t buffer;
-    if (auto err = EdsGetPropertyData(ref, id, 0, sizeof(buffer), &buffer); err != EDS_ERR_OK)
+    char buffer[2048];
+    if (auto err = TIME_EDS_CALL(EdsGetPropertyData(ref, id, 0, sizeof(buffer), buffer));
+        err != EDS_ERR_OK)
     {
-        throw eds_exception(
-            "Failed to read camera property "s + std::to_string(id), err, __FUNCTION__);
+        return eds_error { err, "Failed to read camera property" };
     }
 
-    return buffer;
+    buffer[sizeof(buffer) - 1] = '\0';
+    return std::string(buffer);
+}
+
+std::string get_camera_property_string(EdsBaseRef ref, EdsPropertyID id)
+{
+    return value_of(try_get_camera_property_string(ref, id), id, __FUNCTION__);
+}
+
+eds_result<int32_t> try_get_camera_property_int32(EdsBaseRef ref, EdsPropertyID id)
+{
+    return read_typed<int32_t>(ref, id, kEdsDataType_Int32);
+}
+
+int32_t get_camera_property_int32(EdsBaseRef ref, EdsPropertyID id)
+{
+    return value_of(try_get_camera_property_int32(ref, id), id, __FUNCTION__);
+}
+
+eds_result<uint32_t> try_get_camera_property_uint32(EdsBaseRef ref, EdsPropertyID id)
+{
+    return read_typed<uint32_t>(ref, id, kEdsDataType_UInt32);
 }
 
 uint32_t get_camera_property_uint32(EdsBaseRef ref, EdsPropertyID id)
 {
-    ensure_data_type_is(kEdsDataType_UInt32, id, ref);
+    return value_of(try_get_camera_property_uint32(ref, id), id, __FUNCTION__);
+}
+
+eds_result<Poco::LocalDateTime> try_get_camera_property_datetime(EdsBaseRef ref, EdsPropertyID id)
+{
+    const auto value = read_typed<EdsTime>(ref, id, kEdsDataType_Time);
+    if (!value)
+        return value.error();
 
-    uint32_t buffer;
-    if (auto err = EdsGetPropertyData(ref, id, 0, sizeof(buffer), &buffer); err != EDS_ERR_OK)
+    const auto& dt = *value;
+    return Poco::LocalDateTime(
+        dt.year, dt.month, dt.day, dt.hour, dt.minute, dt.second, dt.milliseconds);
+}
+
+Poco::LocalDateTime get_camera_property_datetime(EdsBaseRef ref, EdsPropertyID id)
+{
+    return value_of(try_get_camera_property_datetime(ref, id), id, __FUNCTION__);
+}
+
+/// Read a fixed size property, which is empty if the camera does not have it
+template <typename T>
+static eds_result<std::optional<T>> read_fixed_size(EdsBaseRef ref, EdsPropertyID id)
+{
+    T buffer;
+    if (auto err = TIME_EDS_CALL(EdsGetPropertyData(ref, id, 0, sizeof(buffer), &buffer));
+        err != EDS_ERR_OK)
     {
-        throw eds_exception(
-            "Failed to read camera property "s + std::to_string(id), err, __FUNCTION__);
+        if (is_unavailable(err))
+            return std::optional<T>();
+
+        return eds_error { err, "Failed to read camera property" };
     }
 
-    return buffer;
+    return std::optional<T>(buffer);
 }
 
-Poco::LocalDateTime get_camera_property_datetime(EdsBaseRef ref, EdsPropertyID id)
+/// The property_value holding the value of a fixed size property, or the error reading it
+template <typename T>
+static eds_result<property_value> fixed_size_value(EdsBaseRef ref, EdsPropertyID id)
 {
-    ensure_data_type_is(kEdsDataType_Time, id, ref);
-    EdsTime dt;
-    if (auto err = EdsGetPropertyData(ref, id, 0, sizeof(dt), &dt); err != EDS_ERR_OK)
+    const auto value = read_fixed_size<T>(ref, id);
+    if (!value)
+        return value.error();
+    if (!*value)
+        return property_value { id, std::monostate() };
+    return property_value { id, **value };
+}
+
+eds_result<property_value> try_read_camera_property(
+    EdsBaseRef ref, const property_descriptor& descriptor)
+{
+    // The data type is taken from the descriptor so only EdsGetPropertyData is needed, rather than
+    // the EdsGetPropertySize calls made by is_property_available and ensure_data_type_is.
+    switch (descriptor.type)
     {
-        throw eds_exception(
-            "Failed to read camera property "s + std::to_string(id), err, __FUNCTION__);
+    case property_descriptor::type_t::string:
+    {
+        char buffer[2048];
+        if (auto err = TIME_EDS_CALL(
+                EdsGetPropertyData(ref, descriptor.id, 0, sizeof(buffer), buffer));
+            err != EDS_ERR_OK)
+        {
+            if (is_unavailable(err))
+                return property_value { descriptor.id, std::monostate() };
+
+            return eds_error { err, "Failed to read camera property" };
+        }
+        buffer[sizeof(buffer) - 1] = '\0';
+        return property_value { descriptor.id, std::string(buffer) };
     }
 
-    return Poco::LocalDateTime(
-        dt.year, dt.month, dt.day, dt.hour, dt.minute, dt.second, dt.milliseconds);
+    case property_descriptor::type_t::int32:
+        return fixed_size_value<int32_t>(ref, descriptor.id);
+
+    case property_descriptor::type_t::uint32:
+        return fixed_size_value<uint32_t>(ref, descriptor.id);
+
+    case property_descriptor::type_t::date_time:
+    {
+        const auto value = read_fixed_size<EdsTime>(ref, descriptor.id);
+        if (!value)
+            return value.error();
+        if (!*value)
+            return property_value { descriptor.id, std::monostate() };
+
+        const auto& dt = **value;
+        std::tm tm {};
+        tm.tm_year = static_cast<int>(dt.year) - 1900;
+        tm.tm_mon = static_cast<int>(dt.month) - 1;
+        tm.tm_mday = static_cast<int>(dt.day);
+        tm.tm_hour = static_cast<int>(dt.hour);
+        tm.tm_min = static_cast<int>(dt.minute);
+        tm.tm_sec = static_cast<int>(dt.second);
+        tm.tm_isdst = -1;
+        return property_value { descriptor.id, tm };
+    }
+    }
+
+    throw std::logic_error("Unknown property type");
+}
+
+property_value read_camera_property(EdsBaseRef ref, const property_descriptor& descriptor)
+{
+    return value_of(try_read_camera_property(ref, descriptor), descriptor.id, __FUNCTION__);
 }
@@ -8,18 +8,34 @@
 #endif
 
 #include "EDSDK.h"
+#include "camera_interface.hpp"
 #include "Poco/LocalDateTime.h"
 #include <cstdint>
 #include <string>
 
+// The try_ functions return SDK errors, and the others throw them as eds_exception
+
+/// Whether the camera has the property. It not being available is not an error.
+eds_result<bool> try_is_property_available(EdsBaseRef ref, EdsPropertyID id);
 bool is_property_available(EdsBaseRef ref, EdsPropertyID id);
 
+eds_result<void> check_data_type(EdsDataType wanted_data_type, EdsPropertyID id, EdsBaseRef ref);
 void ensure_data_type_is(EdsDataType wanted_data_type, EdsPropertyID id, EdsBaseRef ref);
 
+eds_result<std::string> try_get_camera_property_string(EdsBaseRef ref, EdsPropertyID id);
 std::string get_camera_property_string(EdsBaseRef ref, EdsPropertyID id);
 
+eds_result<int32_t> try_get_camera_property_int32(EdsBaseRef ref, EdsPropertyID id);
 int32_t get_camera_property_int32(EdsBaseRef ref, EdsPropertyID id);
 
+eds_result<uint32_t> try_get_camera_property_uint32(EdsBaseRef ref, EdsPropertyID id);
 uint32_t get_camera_property_uint32(EdsBaseRef ref, EdsPropertyID id);
 
+eds_result<Poco::LocalDateTime> try_get_camera_property_datetime(EdsBaseRef ref, EdsPropertyID id);
 Poco::LocalDateTime get_camera_property_datetime(EdsBaseRef ref, EdsPropertyID id);
+
+/// Read a property described by the property table with a single SDK call. Properties which are
+/// not available on the camera are returned without a value rather than as an error.
+eds_result<property_value> try_read_camera_property(
+    EdsBaseRef ref, const property_descriptor& descriptor);
+property_value read_camera_property(EdsBaseRef ref, const property_descriptor& descriptor);
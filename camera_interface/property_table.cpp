@@ -0,0 +1,135 @@
+//
+//  property_table.cpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#include "property_table.hpp"
+#include "int_to_hex.hpp"
+
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/LocalDateTime.h"
+
+#include <cstring>
+#include <string>
+
+using namespace std::string_literals;
+
+static const std::string UNKNOWN = "<Unknown>"s;
+
+template <typename T> static const T* get_value(const property_value& value)
+{
+    return std::get_if<T>(&value.value);
+}
+
+namespace implementation
+{
+std::string format_string(const property_value& value)
+{
+    const auto v = get_value<std::string>(value);
+    return v ? *v : UNKNOWN;
+}
+
+std::string format_int32(const property_value& value)
+{
+    const auto v = get_value<int32_t>(value);
+    return v ? std::to_string(*v) : UNKNOWN;
+}
+
+std::string format_uint32(const property_value& value)
+{
+    const auto v = get_value<uint32_t>(value);
+    return v ? std::to_string(*v) : UNKNOWN;
+}
+
+/// Properties holding a camera specific code are shown as the raw code
+std::string format_code(const property_value& value)
+{
+    const auto v = get_value<uint32_t>(value);
+    return v ? "0x"s + int_to_hex(*v) : UNKNOWN;
+}
+
+std::string format_date_time(const property_value& value)
+{
+    const auto v = get_value<std::tm>(value);
+    if (!v)
+        return UNKNOWN;
+
+    const Poco::LocalDateTime date_time(
+        v->tm_year + 1900, v->tm_mon + 1, v->tm_mday, v->tm_hour, v->tm_min, v->tm_sec);
+    return Poco::DateTimeFormatter::format(date_time, "%d-%b-%Y %H:%M:%S"s);
+}
+
+std::string format_battery_level(int32_t level)
+{
+    if (static_cast<uint32_t>(level) != 0xffffffff)
+        return std::to_string(level) + "%";
+    return "AC power";
+}
+
+std::string format_battery_level(const property_value& value)
+{
+    const auto v = get_value<int32_t>(value);
+    return v ? format_battery_level(*v) : UNKNOWN;
+}
+
+std::string format_save_to(uint32_t save_to_code)
+{
+    std::string result;
+
+    if (save_to_code & 1)
+        result += "Memory Card"s;
+
+    if (save_to_code & 2)
+    {
+        if (!result.empty())
+            result += ", "s;
+
+        result += "Host Computer"s;
+    }
+
+    return result;
+}
+
+std::string format_save_to(const property_value& value)
+{
+    const auto v = get_value<uint32_t>(value);
+    return v ? format_save_to(*v) : UNKNOWN;
+}
+
+std::string format_lens_status(const property_value& value)
+{
+    const auto v = get_value<uint32_t>(value);
+    return v ? ((*v != 0) ? "Lens Attached"s : "No Lens"s) : UNKNOWN;
+}
+} // namespace implementation
+
+std::string property_value::to_string() const
+{
+    const auto descriptor = find_property_descriptor(id);
+    return (descriptor != nullptr) ? descriptor->format(*this) : UNKNOWN;
+}
+
+gsl::span<const property_descriptor> get_property_descriptors()
+{
+    return implementation::property_table;
+}
+
+const property_descriptor* find_property_descriptor(property_value::property_id_t id)
+{
+    for (const auto& descriptor : implementation::property_table)
+        if (descriptor.id == id)
+            return &descriptor;
+
+    return nullptr;
+}
+
+const property_descriptor* find_property_descriptor(const std::string& key)
+{
+    for (const auto& descriptor : implementation::property_table)
+        if (key == descriptor.key)
+            return &descriptor;
+
+    return nullptr;
+}
@@ -0,0 +1,91 @@
+//
+//  property_table.hpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#pragma once
+
+// Ensure that __MACOS__ is defined when compiling for macOS. (required for EDSDK.h)
+#if !defined __MACOS__
+#if defined __APPLE__ && defined __MACH__
+#define __MACOS__ 1
+#endif
+#endif
+
+#include "EDSDK.h"
+#include "camera_interface.hpp"
+#include <cstdint>
+#include <string>
+
+namespace implementation
+{
+std::string format_string(const property_value& value);
+std::string format_int32(const property_value& value);
+std::string format_uint32(const property_value& value);
+std::string format_code(const property_value& value);
+std::string format_date_time(const property_value& value);
+std::string format_battery_level(const property_value& value);
+std::string format_save_to(const property_value& value);
+std::string format_lens_status(const property_value& value);
+
+std::string format_battery_level(int32_t level);
+std::string format_save_to(uint32_t save_to_code);
+
+typedef property_descriptor::type_t type_t;
+
+/// Every camera property that read_properties knows how to read and format
+inline constexpr property_descriptor property_table[] = {
+    { kEdsPropID_ProductName, "product_name", "Product", type_t::string, format_string },
+    { kEdsPropID_BodyIDEx, "body_id", "Body", type_t::string, format_string },
+    { kEdsPropID_OwnerName, "owner_name", "Owner Name", type_t::string, format_string },
+    { kEdsPropID_MakerName, "maker_name", "Maker", type_t::string, format_string },
+    { kEdsPropID_DateTime, "date_time", "Date/Time", type_t::date_time, format_date_time },
+    { kEdsPropID_FirmwareVersion, "firmware_version", "Firmware", type_t::string, format_string },
+    { kEdsPropID_BatteryLevel, "battery_level", "Battery Level", type_t::int32,
+        format_battery_level },
+    { kEdsPropID_BatteryQuality, "battery_quality", "Battery Quality", type_t::uint32,
+        format_uint32 },
+    { kEdsPropID_SaveTo, "save_to", "Save to", type_t::uint32, format_save_to },
+    { kEdsPropID_CurrentStorage, "current_storage", "Current Storage", type_t::string,
+        format_string },
+    { kEdsPropID_CurrentFolder, "current_folder", "Current Folder", type_t::string,
+        format_string },
+    { kEdsPropID_HDDirectoryStructure, "hd_directory_structure", "HD Directory", type_t::string,
+        format_string },
+    { kEdsPropID_LensStatus, "lens_status", "Lens Status", type_t::uint32, format_lens_status },
+    { kEdsPropID_LensName, "lens_name", "Lens Name", type_t::string, format_string },
+    { kEdsPropID_Artist, "artist", "Artist", type_t::string, format_string },
+    { kEdsPropID_Copyright, "copyright", "Copyright", type_t::string, format_string },
+    { kEdsPropID_AvailableShots, "available_shots", "Available Shots", type_t::uint32,
+        format_uint32 },
+    { kEdsPropID_ImageQuality, "image_quality", "Image Quality", type_t::uint32, format_code },
+    { kEdsPropID_JpegQuality, "jpeg_quality", "JPEG Quality", type_t::uint32, format_uint32 },
+    { kEdsPropID_Orientation, "orientation", "Orientation", type_t::uint32, format_uint32 },
+    { kEdsPropID_WhiteBalance, "white_balance", "White Balance", type_t::int32, format_int32 },
+    { kEdsPropID_ColorTemperature, "color_temperature", "Colour Temperature", type_t::uint32,
+        format_uint32 },
+    { kEdsPropID_ColorSpace, "color_space", "Colour Space", type_t::uint32, format_code },
+    { kEdsPropID_PictureStyle, "picture_style", "Picture Style", type_t::uint32, format_code },
+    { kEdsPropID_AEMode, "ae_mode", "AE Mode", type_t::uint32, format_code },
+    { kEdsPropID_AEModeSelect, "ae_mode_select", "AE Mode Dial", type_t::uint32, format_code },
+    { kEdsPropID_DriveMode, "drive_mode", "Drive Mode", type_t::uint32, format_code },
+    { kEdsPropID_ISOSpeed, "iso_speed", "ISO Speed", type_t::uint32, format_code },
+    { kEdsPropID_MeteringMode, "metering_mode", "Metering Mode", type_t::uint32, format_code },
+    { kEdsPropID_AFMode, "af_mode", "AF Mode", type_t::uint32, format_code },
+    { kEdsPropID_Av, "av", "Aperture (Av)", type_t::uint32, format_code },
+    { kEdsPropID_Tv, "tv", "Shutter (Tv)", type_t::uint32, format_code },
+    { kEdsPropID_ExposureCompensation, "exposure_compensation", "Exposure Comp.",
+        type_t::uint32, format_code },
+    { kEdsPropID_Bracket, "bracket", "Bracket", type_t::uint32, format_code },
+    { kEdsPropID_Evf_OutputDevice, "evf_output_device", "EVF Output", type_t::uint32,
+        format_code },
+    { kEdsPropID_Evf_Mode, "evf_mode", "EVF Mode", type_t::uint32, format_uint32 },
+    { kEdsPropID_Record, "record", "Movie Record", type_t::uint32, format_uint32 },
+    { kEdsPropID_TempStatus, "temperature_status", "Temperature", type_t::uint32, format_code },
+    { kEdsPropID_AutoPowerOffSetting, "auto_power_off", "Auto Power Off", type_t::uint32,
+        format_uint32 },
+};
+
+} // namespace implementation
@@ -0,0 +1,121 @@
+//
+//  raw_image_impl.cpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#if !defined __MACOS__
+#if defined __APPLE__ && defined __MACH__
+#define __MACOS__ 1
+#else
+#error "Only for MacOS"
+#endif
+#endif
+
+#include "camera_interface.hpp"
+#include "camera_interface_impl.hpp"
+
+#include "EDSDK.h"
+
+#include "Poco/Logger.h"
+
+#include <CoreGraphics/CoreGraphics.h>
+#include <ImageIO/ImageIO.h>
+
+#include "cfrelease_object.hpp"
+
+namespace implementation
+{
+namespace
+{
+CFURLRef create_url(const std::string& path)
+{
+    const cfrelease_object<CFStringRef> path_string(
+        CFStringCreateWithCString(kCFAllocatorDefault, path.c_str(), kCFStringEncodingUTF8));
+    return CFURLCreateWithFileSystemPath(
+        kCFAllocatorDefault, path_string.get_obj(), kCFURLPOSIXPathStyle, false);
+}
+
+camera_ref_lock<EdsStreamRef> open_file_stream(const std::string& path)
+{
+    const cfrelease_object<CFURLRef> url(create_url(path));
+
+    EdsStreamRef stream(nullptr);
+    THROW_ERRORS(EdsCreateFileStreamEx(url.get_obj(), kEdsFileCreateDisposition_OpenExisting,
+                     kEdsAccess_Read, &stream),
+        "develop_raw_image", "Failed to open raw image");
+
+    camera_ref_lock<EdsStreamRef> locked(stream);
+    EdsRelease(stream);
+    return locked;
+}
+
+/// Encode the RGB pixels as a JPEG or TIFF file with ImageIO
+void save_image(const std::string& destination, developed_format format, const void* pixels,
+    std::size_t width, std::size_t height)
+{
+    const std::size_t bits = (format == developed_format::tiff16) ? 16 : 8;
+    const std::size_t bytes_per_row = width * 3 * bits / 8;
+    const CGBitmapInfo bitmap_info
+        = kCGImageAlphaNone | ((bits == 16) ? kCGBitmapByteOrder16Host : kCGBitmapByteOrderDefault);
+
+    const cfrelease_object<CGColorSpaceRef> colour_space(
+        CGColorSpaceCreateWithName(kCGColorSpaceSRGB));
+    const cfrelease_object<CGDataProviderRef> provider(
+        CGDataProviderCreateWithData(nullptr, pixels, bytes_per_row * height, nullptr));
+    const cfrelease_object<CGImageRef> image(CGImageCreate(width, height, bits, bits * 3,
+        bytes_per_row, colour_space.get_obj(), bitmap_info, provider.get_obj(), nullptr, false,
+        kCGRenderingIntentDefault));
+
+    const cfrelease_object<CFURLRef> url(create_url(destination));
+    const auto type
+        = (format == developed_format::jpeg) ? CFSTR("public.jpeg") : CFSTR("public.tiff");
+    const auto output = CGImageDestinationCreateWithURL(url.get_obj(), type, 1, nullptr);
+    if (output == nullptr)
+        throw eds_exception(
+            "Failed to create " + destination, EDS_ERR_FILE_WRITE_ERROR, __FUNCTION__);
+    const cfrelease_object<CGImageDestinationRef> destination_ref(output);
+
+    const double quality = 0.9;
+    const cfrelease_object<CFNumberRef> quality_number(
+        CFNumberCreate(kCFAllocatorDefault, kCFNumberDoubleType, &quality));
+    const void* keys[] = { kCGImageDestinationLossyCompressionQuality };
+    const void* values[] = { quality_number.get_obj() };
+    const cfrelease_object<CFDictionaryRef> properties(CFDictionaryCreate(kCFAllocatorDefault,
+        keys, values, 1, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks));
+
+    CGImageDestinationAddImage(output, image.get_obj(), properties.get_obj());
+    if (!CGImageDestinationFinalize(output))
+        throw eds_exception(
+            "Failed to write " + destination, EDS_ERR_FILE_WRITE_ERROR, __FUNCTION__);
+}
+}
+}
+
+void develop_raw_image(
+    const std::string& source, const std::string& destination, developed_format format)
+{
+    auto input = implementation::open_file_stream(source);
+    auto image = implementation::create_image_ref(input.get_ref());
+
+    EdsImageInfo info;
+    THROW_ERRORS(EdsGetImageInfo(image.get_ref(), kEdsImageSrc_FullView, &info),
+        "develop_raw_image", "Failed to read raw image");
+
+    // The SDK does the raw processing when the full view is read as RGB
+    const auto& area = info.effectiveRect;
+    auto pixels = implementation::create_memory_stream();
+    THROW_ERRORS(EdsGetImage(image.get_ref(), kEdsImageSrc_FullView,
+                     (format == developed_format::tiff16) ? kEdsTargetImageType_RGB16
+                                                          : kEdsTargetImageType_RGB,
+                     area, area.size, pixels.get_ref()),
+        "develop_raw_image", "Failed to develop raw image");
+
+    EdsVoid* pointer(nullptr);
+    THROW_ERRORS(EdsGetPointer(pixels.get_ref(), &pointer), "develop_raw_image",
+        "Failed to get developed image");
+
+    implementation::save_image(destination, format, pointer,
+        static_cast<std::size_t>(area.size.width), static_cast<std::size_t>(area.size.height));
+}
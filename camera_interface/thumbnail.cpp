@@ -30,7 +30,11 @@ camera_ref_lock<EdsStreamRef> create_memory_stream()
     EdsStreamRef stream(nullptr);
     THROW_ERRORS(EdsCreateMemoryStream(0, &stream), "create_memory_stream",
         "Failed to create memory stream");
-    return stream;
+
+    // The lock holds its own reference, so the stream is freed when the lock goes
+    camera_ref_lock<EdsStreamRef> locked(stream);
+    EdsRelease(stream);
+    return locked;
 }
 
 camera_ref_lock<EdsImageRef> create_image_ref(EdsStreamRef stream)
@@ -38,10 +42,13 @@ camera_ref_lock<EdsImageRef> create_image_ref(EdsStreamRef stream)
     EdsImageRef img_ref(nullptr);
     THROW_ERRORS(
         EdsCreateImageRef(stream, &img_ref), "create_image_ref", "Failed to create image ref");
-    return img_ref;
+
+    camera_ref_lock<EdsImageRef> locked(img_ref);
+    EdsRelease(img_ref);
+    return locked;
 }
 
-thumbnail::thumbnail(EdsDirectoryItemRef dir_item)
+thumbnail::thumbnail(EdsDirectoryItemRef dir_item, bool keep_data)
     : date_time(0)
 {
     auto stream = create_memory_stream();
@@ -49,6 +56,19 @@ thumbnail::thumbnail(EdsDirectoryItemRef dir_item)
     THROW_ERRORS(EdsDownloadThumbnail(dir_item, stream.get_ref()), "thumbnail",
         "Failed to download thumbnail");
 
+    if (keep_data)
+    {
+        EdsVoid* pointer(nullptr);
+        EdsUInt64 length(0);
+        THROW_ERRORS(EdsGetPointer(stream.get_ref(), &pointer), "thumbnail",
+            "Failed to get thumbnail data");
+        THROW_ERRORS(EdsGetLength(stream.get_ref(), &length), "thumbnail",
+            "Failed to get thumbnail length");
+
+        const auto bytes = static_cast<const uint8_t*>(pointer);
+        data.assign(bytes, bytes + length);
+    }
+
     auto img = create_image_ref(stream.get_ref());
 
     if (is_property_available(img.get_ref(), kEdsPropID_DateTime))
@@ -0,0 +1,189 @@
+//
+//  trace.cpp
+//  camera_interface
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#include "trace.hpp"
+#include "camera_interface.hpp"
+
+#include <cstdio>
+#include <iomanip>
+#include <memory>
+#include <vector>
+
+#include <unistd.h>
+
+namespace implementation
+{
+std::atomic<bool> trace_recorder::enabled_flag { false };
+
+namespace
+{
+    struct trace_state
+    {
+        std::mutex mutex;
+        /// Buffers outlive their threads, so spans from finished threads are still written
+        std::vector<std::shared_ptr<trace_buffer>> buffers;
+        trace_recorder::clock::time_point epoch = trace_recorder::clock::now();
+    };
+
+    trace_state& state()
+    {
+        static trace_state instance;
+        return instance;
+    }
+
+    void write_string(std::ostream& out, const std::string& value)
+    {
+        out << '"';
+        for (const char c : value)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out << escaped;
+            }
+            else
+                out << c;
+        }
+        out << '"';
+    }
+
+    double microseconds(trace_recorder::clock::duration duration)
+    {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+}
+
+void trace_recorder::set_enabled(bool enable)
+{
+    if (enable && !enabled())
+    {
+        std::lock_guard<std::mutex> lock(state().mutex);
+        state().epoch = clock::now();
+    }
+
+    enabled_flag.store(enable, std::memory_order_relaxed);
+}
+
+trace_buffer& trace_recorder::this_thread()
+{
+    thread_local std::shared_ptr<trace_buffer> buffer;
+    if (!buffer)
+    {
+        buffer = std::make_shared<trace_buffer>();
+
+        std::lock_guard<std::mutex> lock(state().mutex);
+        buffer->thread_number = static_cast<uint32_t>(state().buffers.size() + 1);
+        state().buffers.push_back(buffer);
+    }
+
+    return *buffer;
+}
+
+void trace_recorder::record(const char* category, const char* name, clock::time_point started,
+    clock::time_point finished, std::string detail)
+{
+    auto& buffer = this_thread();
+
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.events.push_back({ category, name, std::move(detail), started, finished - started });
+}
+
+void trace_recorder::set_thread_name(std::string name)
+{
+    auto& buffer = this_thread();
+
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.thread_name = std::move(name);
+}
+
+void trace_recorder::write(std::ostream& out)
+{
+    std::vector<std::shared_ptr<trace_buffer>> buffers;
+    clock::time_point epoch;
+    {
+        std::lock_guard<std::mutex> lock(state().mutex);
+        buffers = state().buffers;
+        epoch = state().epoch;
+    }
+
+    const auto pid = ::getpid();
+    bool first = true;
+    const auto separator = [&out, &first] {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::fixed << std::setprecision(3);
+    for (const auto& buffer : buffers)
+    {
+        std::deque<trace_event> events;
+        std::string thread_name;
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            events.swap(buffer->events);
+            thread_name = buffer->thread_name;
+        }
+
+        if (!thread_name.empty())
+        {
+            separator();
+            out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid
+                << ",\"tid\":" << buffer->thread_number << ",\"args\":{\"name\":";
+            write_string(out, thread_name);
+            out << "}}";
+        }
+
+        for (const auto& event : events)
+        {
+            separator();
+            out << "{\"ph\":\"X\",\"cat\":\"" << event.category << "\",\"name\":\"" << event.name
+                << "\",\"pid\":" << pid << ",\"tid\":" << buffer->thread_number
+                << ",\"ts\":" << microseconds(event.started - epoch)
+                << ",\"dur\":" << microseconds(event.duration);
+            if (!event.detail.empty())
+            {
+                out << ",\"args\":{\"detail\":";
+                write_string(out, event.detail);
+                out << '}';
+            }
+            out << '}';
+        }
+    }
+    out << "\n]}\n";
+    out.flush();
+}
+} // namespace implementation
+
+using implementation::trace_recorder;
+
+void set_trace_enabled(bool enabled) { trace_recorder::set_enabled(enabled); }
+
+void write_trace(std::ostream& out) { trace_recorder::write(out); }
+
+void set_trace_thread_name(const std::string& name) { trace_recorder::set_thread_name(name); }
+
+trace_span::trace_span(const char* span_category, const char* span_name, std::string span_detail)
+    : category(span_category)
+    , name(span_name)
+    , recording(trace_recorder::enabled())
+{
+    if (recording)
+    {
+        detail = std::move(span_detail);
+        started = trace_recorder::clock::now();
+    }
+}
+
+trace_span::~trace_span()
+{
+    if (recording)
+        trace_recorder::record(
+            category, name, started, trace_recorder::clock::now(), std::move(detail));
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace implementation
+{
+/// A span of time on one thread. name and category point at strings that live as long as the
+/// program (literals, or the function names of the api_stats call sites).
+struct trace_event
+{
+    const char* category;
+    const char* name;
+    std::string detail;
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::duration duration;
+};
+
+/// The spans recorded by one thread. Only that thread adds to it, so its lock is only contended
+/// while the trace is being written.
+struct trace_buffer
+{
+    uint32_t thread_number;
+    std::string thread_name;
+    std::mutex mutex;
+    /// A deque, so a long trace grows in blocks without copying what has been recorded
+    std::deque<trace_event> events;
+};
+
+/// Records spans into a buffer per thread while tracing is enabled. Recording a span costs two
+/// clock reads and an uncontended lock; while tracing is off it costs a relaxed atomic load.
+class trace_recorder
+{
+public:
+    typedef std::chrono::steady_clock clock;
+
+    static bool enabled() { return enabled_flag.load(std::memory_order_relaxed); }
+    static void set_enabled(bool enable);
+
+    static void record(const char* category, const char* name, clock::time_point started,
+        clock::time_point finished, std::string detail = {});
+    static void set_thread_name(std::string name);
+
+    /// Write the spans recorded so far as Chrome trace event JSON and clear them
+    static void write(std::ostream& out);
+
+private:
+    static trace_buffer& this_thread();
+
+    static std::atomic<bool> enabled_flag;
+};
+} // namespace implementation
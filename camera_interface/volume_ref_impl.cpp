@@ -24,8 +24,10 @@
 
 namespace implementation
 {
-impl_volume_ref::impl_volume_ref(EdsVolumeRef r)
+impl_volume_ref::impl_volume_ref(
+    EdsVolumeRef r, std::shared_ptr<impl_transfer_state> transfer_state)
     : ref(r)
+    , transfers(std::move(transfer_state))
     , count(0)
     , max_capacity(0)
     , free_space(0)
@@ -41,6 +43,7 @@ impl_volume_ref::impl_volume_ref(EdsVolumeRef r)
 
     THROW_ERRORS(EdsGetVolumeInfo(ref.get_ref(), &volume), "volume", "Failed to get volume info");
 
+    // The SDK reports both in KB, whatever the name of freeSpaceInBytes suggests
     max_capacity = volume.maxCapacity;
     free_space = volume.freeSpaceInBytes;
     label = volume.szVolumeLabel;
@@ -84,55 +87,68 @@ impl_volume_ref::impl_volume_ref(EdsVolumeRef r)
 
 impl_volume_ref::~impl_volume_ref() { }
 
+uint64_t impl_volume_ref::read_free_space()
+{
+    EdsVolumeInfo volume;
+    THROW_ERRORS(EdsGetVolumeInfo(ref.get_ref(), &volume), "volume", "Failed to get volume info");
+
+    free_space = volume.freeSpaceInBytes;
+    return free_space;
+}
+
 std::shared_ptr<directory_ref> impl_volume_ref::select_directory(size_type directory_number)
 {
+    return try_select_directory(directory_number).value();
+}
+
+eds_result<std::shared_ptr<directory_ref>> impl_volume_ref::try_select_directory(
+    size_type directory_number)
+{
+    ALLOCATION_SCOPE("enumeration");
     if (directory_number >= count)
     {
-        Poco::Logger::get("volume_ref")
-            .error("Directory entry out of range (%lu)", directory_number);
+        CAMERA_LOG(volume_ref_log, error, "Directory entry out of range (%lu)", directory_number);
         throw std::out_of_range("Directory entry out of range");
     }
 
-    EdsDirectoryItemRef dir(nullptr);
-    THROW_ERRORS(EdsGetChildAtIndex(ref.get_ref(), static_cast<EdsInt32>(directory_number), &dir),
-        "volume_ref", "Failed to select directory entry");
-
-    std::shared_ptr<directory_ref> dir_impl = std::make_shared<impl_directory_ref>(dir);
+    auto dir = eds_backend::try_open_child(
+        ref.get_ref(), directory_number, "Failed to select directory entry");
+    if (!dir)
+        return dir.error();
 
-    return dir_impl;
+    return std::shared_ptr<directory_ref>(
+        std::make_shared<impl_directory_ref>(std::move(*dir), transfers));
 }
 
-std::shared_ptr<directory_ref> impl_volume_ref::find_directory(std::string dir_name)
+std::optional<eds_entry> impl_volume_ref::find_directory(const std::string& dir_name)
 {
     for (size_type i = 0; i < count; i++)
     {
-        auto dir = select_directory(i);
-        if (dir->is_a_folder() && (dir->get_name().compare(dir_name) == 0))
+        auto dir = eds_backend::try_open_child(ref.get_ref(), i, "Failed to select directory entry")
+                       .value();
+        if (dir.is_a_folder() && dir.get_name() == dir_name)
             return dir;
     }
 
-    return nullptr;
+    return std::nullopt;
 }
 
 std::vector<std::shared_ptr<directory_ref>> impl_volume_ref::find_matching_files(
     std::string image_folder, std::regex filename_expression)
 {
+    ALLOCATION_SCOPE("enumeration");
+    // Only the matching files are handed out as directory_refs. The folders and the files that
+    // do not match are values, so they are released as soon as they have been looked at.
     std::vector<std::shared_ptr<directory_ref>> list;
-    auto dcim_dir = find_directory("DCIM");
+    const auto dcim_dir = find_directory("DCIM");
 
     if (dcim_dir)
     {
         const auto image_dir = dcim_dir->find_directory(image_folder);
         if (image_dir)
         {
-            const auto count = image_dir->get_directory_count();
-            for (directory_ref::size_type i = 0; i < count; i++)
-            {
-                auto f = image_dir->get_directory_entry(i);
-
-                if (std::regex_match(f->get_name(), filename_expression))
-                    list.emplace_back(f);
-            }
+            for (auto& file : image_dir->find_matching_entries(filename_expression))
+                list.emplace_back(std::make_shared<impl_directory_ref>(std::move(file), transfers));
         }
     }
 
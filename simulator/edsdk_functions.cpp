@@ -0,0 +1,884 @@
+//
+//  edsdk_functions.cpp
+//  edsdk_simulator
+//
+//  The Eds* functions, implemented with the simulated cameras.
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#include "simulator_objects.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+using namespace simulator;
+
+namespace
+{
+constexpr std::size_t transfer_chunk_size = 1024 * 1024;
+
+template <typename T> T* as(EdsBaseRef ref) { return dynamic_cast<T*>(ref); }
+
+/// The camera a call on ref goes to, for its latency
+camera_object* camera_of(EdsBaseRef ref) { return ref ? ref->camera() : nullptr; }
+} // namespace
+
+EdsError EDSAPI EdsInitializeSDK()
+{
+    auto& sdk = state();
+    std::lock_guard<std::mutex> lock(sdk.mutex);
+
+    if (sdk.initialised++ > 0)
+        return EDS_ERR_OK;
+
+    configuration config;
+    if (sdk.configured)
+    {
+        config = *sdk.configured;
+    }
+    else if (const char* settings = std::getenv("CAMERA_SIMULATOR"))
+    {
+        try
+        {
+            config = parse_configuration(settings);
+        }
+        catch (const std::invalid_argument& ex)
+        {
+            std::cerr << "CAMERA_SIMULATOR: " << ex.what() << std::endl;
+            sdk.initialised--;
+            return EDS_ERR_INVALID_PARAMETER;
+        }
+    }
+
+    sdk.faults.set_faults(config.faults, config.fault_seed);
+    sdk.camera_list = std::make_unique<camera_list_object>(config);
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsTerminateSDK()
+{
+    auto& sdk = state();
+    std::lock_guard<std::mutex> lock(sdk.mutex);
+
+    if (sdk.initialised == 0)
+        return EDS_ERR_OK;
+
+    if (--sdk.initialised == 0)
+    {
+        sdk.camera_list.reset();
+        sdk.camera_added_handler = nullptr;
+        sdk.camera_added_context = nullptr;
+    }
+    return EDS_ERR_OK;
+}
+
+EdsUInt32 EDSAPI EdsRetain(EdsBaseRef inRef)
+{
+    if (!inRef)
+        return 0xffffffff;
+    return ++inRef->references;
+}
+
+EdsUInt32 EDSAPI EdsRelease(EdsBaseRef inRef)
+{
+    if (!inRef)
+        return 0xffffffff;
+
+    const auto remaining = --inRef->references;
+    if (remaining == 0 && !inRef->sdk_owned)
+        delete inRef;
+    return remaining;
+}
+
+EdsError EDSAPI EdsGetChildCount(EdsBaseRef inRef, EdsUInt32* outCount)
+{
+    if (!inRef || !outCount)
+        return EDS_ERR_INVALID_POINTER;
+
+    camera_call call;
+    if (auto camera = camera_of(inRef))
+        call = camera->call("EdsGetChildCount", as<item_object>(inRef));
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+    return inRef->child_count(*outCount);
+}
+
+EdsError EDSAPI EdsGetChildAtIndex(EdsBaseRef inRef, EdsInt32 inIndex, EdsBaseRef* outRef)
+{
+    if (!inRef || !outRef)
+        return EDS_ERR_INVALID_POINTER;
+
+    camera_call call;
+    if (auto camera = camera_of(inRef))
+        call = camera->call("EdsGetChildAtIndex", as<item_object>(inRef));
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+    return inRef->child_at(inIndex, *outRef);
+}
+
+EdsError EDSAPI EdsGetParent(EdsBaseRef /*inRef*/, EdsBaseRef* /*outParentRef*/)
+{
+    return EDS_ERR_NOT_SUPPORTED;
+}
+
+EdsError EDSAPI EdsGetPropertySize(EdsBaseRef inRef, EdsPropertyID inPropertyID,
+    EdsInt32 /*inParam*/, EdsDataType* outDataType, EdsUInt32* outSize)
+{
+    if (!inRef || !outDataType || !outSize)
+        return EDS_ERR_INVALID_POINTER;
+
+    camera_call call;
+    if (auto camera = as<camera_object>(inRef))
+        call = camera->call("EdsGetPropertySize");
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+
+    const auto value = inRef->get_property(inPropertyID);
+    if (!value)
+        return EDS_ERR_PROPERTIES_UNAVAILABLE;
+
+    *outDataType = value->type;
+    *outSize = value->size;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsGetPropertyData(EdsBaseRef inRef, EdsPropertyID inPropertyID,
+    EdsInt32 /*inParam*/, EdsUInt32 inPropertySize, EdsVoid* outPropertyData)
+{
+    if (!inRef || !outPropertyData)
+        return EDS_ERR_INVALID_POINTER;
+
+    camera_call call;
+    if (auto camera = as<camera_object>(inRef))
+        call = camera->call("EdsGetPropertyData");
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+
+    const auto value = inRef->get_property(inPropertyID);
+    if (!value)
+        return EDS_ERR_PROPERTIES_UNAVAILABLE;
+    if (value->type != kEdsDataType_String && inPropertySize < value->size)
+        return EDS_ERR_PROPERTIES_MISMATCH;
+
+    std::memset(outPropertyData, 0, inPropertySize);
+    std::memcpy(outPropertyData, value->data.data(),
+        std::min<std::size_t>(value->data.size(), inPropertySize));
+    if (value->type == kEdsDataType_String && inPropertySize > 0)
+        static_cast<char*>(outPropertyData)[inPropertySize - 1] = 0;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsSetPropertyData(EdsBaseRef inRef, EdsPropertyID inPropertyID,
+    EdsInt32 /*inParam*/, EdsUInt32 inPropertySize, const EdsVoid* inPropertyData)
+{
+    if (!inRef || !inPropertyData)
+        return EDS_ERR_INVALID_POINTER;
+
+    camera_call call;
+    if (auto camera = as<camera_object>(inRef))
+        call = camera->call("EdsSetPropertyData");
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+
+    const auto bytes = static_cast<const uint8_t*>(inPropertyData);
+    return inRef->set_property(inPropertyID,
+        { kEdsDataType_Unknown, inPropertySize,
+            std::vector<uint8_t>(bytes, bytes + inPropertySize) });
+}
+
+EdsError EDSAPI EdsGetPropertyDesc(
+    EdsBaseRef inRef, EdsPropertyID inPropertyID, EdsPropertyDesc* outPropertyDesc)
+{
+    if (!inRef || !outPropertyDesc)
+        return EDS_ERR_INVALID_POINTER;
+    if (!inRef->get_property(inPropertyID))
+        return EDS_ERR_PROPERTIES_UNAVAILABLE;
+
+    // The simulated cameras do not restrict the values of their properties
+    *outPropertyDesc = {};
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsGetCameraList(EdsCameraListRef* outCameraListRef)
+{
+    if (!outCameraListRef)
+        return EDS_ERR_INVALID_POINTER;
+
+    auto& sdk = state();
+    std::lock_guard<std::mutex> lock(sdk.mutex);
+    if (!sdk.camera_list)
+        return EDS_ERR_INTERNAL_ERROR;
+
+    sdk.camera_list->references++;
+    *outCameraListRef = sdk.camera_list.get();
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsGetDeviceInfo(EdsCameraRef inCameraRef, EdsDeviceInfo* outDeviceInfo)
+{
+    auto camera = as<camera_object>(inCameraRef);
+    if (!camera || !outDeviceInfo)
+        return EDS_ERR_INVALID_HANDLE;
+
+    *outDeviceInfo = camera->device_info;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsOpenSession(EdsCameraRef inCameraRef)
+{
+    auto camera = as<camera_object>(inCameraRef);
+    if (!camera)
+        return EDS_ERR_INVALID_HANDLE;
+
+    const auto call = camera->call("EdsOpenSession");
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+    camera->sessions++;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsCloseSession(EdsCameraRef inCameraRef)
+{
+    auto camera = as<camera_object>(inCameraRef);
+    if (!camera)
+        return EDS_ERR_INVALID_HANDLE;
+
+    const auto call = camera->call("EdsCloseSession");
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+    if (camera->sessions == 0)
+        return EDS_ERR_SESSION_NOT_OPEN;
+
+    camera->sessions--;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsSendCommand(
+    EdsCameraRef inCameraRef, EdsCameraCommand inCommand, EdsInt32 /*inParam*/)
+{
+    auto camera = as<camera_object>(inCameraRef);
+    if (!camera)
+        return EDS_ERR_INVALID_HANDLE;
+
+    const auto call = camera->call("EdsSendCommand");
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+
+    switch (inCommand)
+    {
+    case kEdsCameraCommand_TakePicture:
+    {
+        if (camera->volumes.empty())
+            return EDS_ERR_TAKE_PICTURE_CARD_NG;
+
+        const auto item = camera->volumes.front()->add_picture();
+
+        EdsUInt32 save_to = 0;
+        if (const auto value = camera->get_property(kEdsPropID_SaveTo))
+            std::memcpy(&save_to, value->data.data(), sizeof(save_to));
+
+        // Pictures saved to the host are offered for transfer, as in tethered shooting
+        const EdsObjectEvent event = (save_to & 2) ? kEdsObjectEvent_DirItemRequestTransfer
+                                                   : kEdsObjectEvent_DirItemCreated;
+        camera->queue_event({ pending_event::object_changed, 0, event, item });
+        return EDS_ERR_OK;
+    }
+
+    case kEdsCameraCommand_ExtendShutDownTimer:
+        return EDS_ERR_OK;
+
+    default:
+        return EDS_ERR_NOT_SUPPORTED;
+    }
+}
+
+EdsError EDSAPI EdsSendStatusCommand(
+    EdsCameraRef inCameraRef, EdsCameraStatusCommand /*inStatusCommand*/, EdsInt32 /*inParam*/)
+{
+    auto camera = as<camera_object>(inCameraRef);
+    if (!camera)
+        return EDS_ERR_INVALID_HANDLE;
+
+    const auto call = camera->call("EdsSendStatusCommand");
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsSetCapacity(EdsCameraRef inCameraRef, EdsCapacity /*inCapacity*/)
+{
+    auto camera = as<camera_object>(inCameraRef);
+    if (!camera)
+        return EDS_ERR_INVALID_HANDLE;
+
+    const auto call = camera->call("EdsSetCapacity");
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsGetVolumeInfo(EdsVolumeRef inVolumeRef, EdsVolumeInfo* outVolumeInfo)
+{
+    auto volume = as<volume_object>(inVolumeRef);
+    if (!volume || !outVolumeInfo)
+        return EDS_ERR_INVALID_HANDLE;
+
+    const auto call = volume->camera()->call("EdsGetVolumeInfo");
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+    *outVolumeInfo = volume->info();
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsFormatVolume(EdsVolumeRef /*inVolumeRef*/) { return EDS_ERR_NOT_SUPPORTED; }
+
+EdsError EDSAPI EdsGetDirectoryItemInfo(
+    EdsDirectoryItemRef inDirItemRef, EdsDirectoryItemInfo* outDirItemInfo)
+{
+    auto item = as<item_object>(inDirItemRef);
+    if (!item || !outDirItemInfo)
+        return EDS_ERR_INVALID_HANDLE;
+
+    const auto call = item->camera()->call("EdsGetDirectoryItemInfo", item);
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+    *outDirItemInfo = item->info();
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsDeleteDirectoryItem(EdsDirectoryItemRef inDirItemRef)
+{
+    auto item = as<item_object>(inDirItemRef);
+    if (!item)
+        return EDS_ERR_INVALID_HANDLE;
+
+    // Deleting folders is not simulated
+    if (item->kind != item_object::kind_t::file)
+        return EDS_ERR_NOT_SUPPORTED;
+
+    const auto call = item->camera()->call("EdsDeleteDirectoryItem", item);
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+    if (!item->volume.delete_picture(item->folder, item->file))
+        return EDS_ERR_FILE_NOT_FOUND;
+
+    // As with the SDK, a deleted item is released
+    EdsRelease(inDirItemRef);
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsDownload(
+    EdsDirectoryItemRef inDirItemRef, EdsUInt64 inReadSize, EdsStreamRef outStream)
+{
+    auto item = as<item_object>(inDirItemRef);
+    auto stream = as<stream_object>(outStream);
+    if (!item || !stream || item->kind != item_object::kind_t::file)
+        return EDS_ERR_INVALID_HANDLE;
+
+    auto camera = item->camera();
+    item->cancelled = false;
+    auto call = camera->call("EdsDownload", item);
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+
+    // Downloads can be split into blocks, each starting where the last one finished
+    const auto size = std::min<uint64_t>(inReadSize, item->file.size - item->downloaded);
+    std::vector<uint8_t> chunk(std::min<uint64_t>(size, transfer_chunk_size));
+    const auto started = clock::now();
+
+    // An injected fault stops the download once this much has been transferred
+    const auto& injected = call.mid_transfer_fault;
+    const uint64_t fails_at = injected
+        ? static_cast<uint64_t>(injected->at_fraction * static_cast<double>(item->file.size))
+        : UINT64_MAX;
+
+    for (uint64_t done = 0; done < size;)
+    {
+        // The last chunk before the fault stops where the fault happens
+        auto count = static_cast<std::size_t>(std::min<uint64_t>(chunk.size(), size - done));
+        if (fails_at > item->downloaded)
+            count = static_cast<std::size_t>(
+                std::min<uint64_t>(count, fails_at - item->downloaded));
+
+        content::raw_file(item->file, item->downloaded, chunk.data(), count);
+        if (auto err = stream->write(count, chunk.data()); err != EDS_ERR_OK)
+            return err;
+
+        done += count;
+        item->downloaded += count;
+        state().faults.count_download(count);
+        camera->transfer(started, done);
+
+        if (item->downloaded >= fails_at)
+        {
+            if (injected->kind != fault::kind_t::disconnect)
+                return static_cast<EdsError>(injected->error);
+
+            // As with a real camera, the download only returns once the disconnect has been
+            // noticed and the download cancelled
+            camera->disconnect(injected->reconnect_after);
+            call.usb.unlock();
+            camera->wait_for_cancel(*item, std::chrono::seconds(2));
+            return EDS_ERR_COMM_DISCONNECTED;
+        }
+
+        if (!stream->report_progress(static_cast<EdsUInt32>(100 * done / size)))
+            return EDS_ERR_OPERATION_CANCELLED;
+    }
+
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsDownloadCancel(EdsDirectoryItemRef inDirItemRef)
+{
+    auto item = as<item_object>(inDirItemRef);
+    if (!item)
+        return EDS_ERR_INVALID_HANDLE;
+
+    // A download can be cancelled after the camera has been disconnected
+    auto camera = item->camera();
+    const auto call = camera->call("EdsDownloadCancel", item);
+    if (call.error != EDS_ERR_OK && call.error != EDS_ERR_COMM_DISCONNECTED)
+        return call.error;
+
+    camera->cancel_download(*item);
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsDownloadComplete(EdsDirectoryItemRef inDirItemRef)
+{
+    auto item = as<item_object>(inDirItemRef);
+    if (!item)
+        return EDS_ERR_INVALID_HANDLE;
+
+    const auto call = item->camera()->call("EdsDownloadComplete", item);
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+    item->downloaded = 0;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsDownloadThumbnail(EdsDirectoryItemRef inDirItemRef, EdsStreamRef outStream)
+{
+    auto item = as<item_object>(inDirItemRef);
+    auto stream = as<stream_object>(outStream);
+    if (!item || !stream || item->kind != item_object::kind_t::file)
+        return EDS_ERR_INVALID_HANDLE;
+
+    auto camera = item->camera();
+    const auto call = camera->call("EdsDownloadThumbnail", item);
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+
+    const auto started = clock::now();
+    const auto thumbnail = content::jpeg(item->file.taken, item->file.number,
+        camera->timing.thumbnail_size);
+    if (auto err = stream->write(thumbnail.size(), thumbnail.data()); err != EDS_ERR_OK)
+        return err;
+
+    camera->transfer(started, thumbnail.size());
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsGetAttribute(
+    EdsDirectoryItemRef inDirItemRef, EdsFileAttributes* outFileAttribute)
+{
+    if (!as<item_object>(inDirItemRef) || !outFileAttribute)
+        return EDS_ERR_INVALID_HANDLE;
+
+    *outFileAttribute = kEdsFileAttribute_Normal;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsSetAttribute(
+    EdsDirectoryItemRef /*inDirItemRef*/, EdsFileAttributes /*inFileAttribute*/)
+{
+    return EDS_ERR_NOT_SUPPORTED;
+}
+
+EdsError EDSAPI EdsCreateFileStream(const EdsChar* inFileName,
+    EdsFileCreateDisposition inCreateDisposition, EdsAccess inDesiredAccess,
+    EdsStreamRef* outStream)
+{
+    if (!inFileName || !outStream)
+        return EDS_ERR_INVALID_POINTER;
+
+    const bool read_only = (inDesiredAccess == kEdsAccess_Read);
+    std::FILE* file = std::fopen(inFileName, read_only ? "rb" : "r+b");
+    const bool exists = (file != nullptr);
+
+    switch (inCreateDisposition)
+    {
+    case kEdsFileCreateDisposition_CreateNew:
+        if (exists)
+        {
+            std::fclose(file);
+            return EDS_ERR_FILE_ALREADY_EXISTS;
+        }
+        file = std::fopen(inFileName, "w+b");
+        break;
+
+    case kEdsFileCreateDisposition_CreateAlways:
+        if (exists)
+            std::fclose(file);
+        file = std::fopen(inFileName, "w+b");
+        break;
+
+    case kEdsFileCreateDisposition_OpenExisting:
+        if (!exists)
+            return EDS_ERR_FILE_NOT_FOUND;
+        break;
+
+    case kEdsFileCreateDisposition_OpenAlways:
+        if (!exists)
+            file = std::fopen(inFileName, "w+b");
+        break;
+
+    case kEdsFileCreateDisposition_TruncateExsisting:
+        if (!exists)
+            return EDS_ERR_FILE_NOT_FOUND;
+        file = std::freopen(inFileName, "w+b", file);
+        break;
+    }
+
+    if (!file)
+        return EDS_ERR_FILE_OPEN_ERROR;
+
+    *outStream = new file_stream(file);
+    return EDS_ERR_OK;
+}
+
+// The real SDK takes a CFURL on macOS and a path elsewhere
+EdsError EDSAPI EdsCreateFileStreamEx(
+#if defined __MACOS__ || TARGET_OS_IPHONE
+    const CFURLRef inURL,
+#else
+    const char* inFileName,
+#endif
+    EdsFileCreateDisposition inCreateDisposition, EdsAccess inDesiredAccess,
+    EdsStreamRef* outStream)
+{
+#if defined __MACOS__ || TARGET_OS_IPHONE
+    char inFileName[1024];
+    if (!CFURLGetFileSystemRepresentation(
+            inURL, true, reinterpret_cast<UInt8*>(inFileName), sizeof(inFileName)))
+        return EDS_ERR_INVALID_PARAMETER;
+#endif
+
+    return EdsCreateFileStream(inFileName, inCreateDisposition, inDesiredAccess, outStream);
+}
+
+EdsError EDSAPI EdsCreateMemoryStream(EdsUInt64 inBufferSize, EdsStreamRef* outStream)
+{
+    if (!outStream)
+        return EDS_ERR_INVALID_POINTER;
+
+    auto stream = new memory_stream();
+    stream->data.reserve(inBufferSize);
+    *outStream = stream;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsCreateMemoryStreamFromPointer(
+    EdsVoid* /*inUserBuffer*/, EdsUInt64 /*inBufferSize*/, EdsStreamRef* /*outStream*/)
+{
+    return EDS_ERR_NOT_SUPPORTED;
+}
+
+EdsError EDSAPI EdsGetPointer(EdsStreamRef inStream, EdsVoid** outPointer)
+{
+    auto stream = as<memory_stream>(inStream);
+    if (!stream || !outPointer)
+        return EDS_ERR_INVALID_HANDLE;
+
+    *outPointer = stream->data.data();
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsRead(
+    EdsStreamRef inStreamRef, EdsUInt64 inReadSize, EdsVoid* outBuffer, EdsUInt64* outReadSize)
+{
+    auto stream = as<stream_object>(inStreamRef);
+    if (!stream || !outBuffer || !outReadSize)
+        return EDS_ERR_INVALID_HANDLE;
+
+    return stream->read(inReadSize, outBuffer, *outReadSize);
+}
+
+EdsError EDSAPI EdsWrite(EdsStreamRef inStreamRef, EdsUInt64 inWriteSize, const EdsVoid* inBuffer,
+    EdsUInt64* outWrittenSize)
+{
+    auto stream = as<stream_object>(inStreamRef);
+    if (!stream || !inBuffer || !outWrittenSize)
+        return EDS_ERR_INVALID_HANDLE;
+
+    const auto err = stream->write(inWriteSize, inBuffer);
+    *outWrittenSize = (err == EDS_ERR_OK) ? inWriteSize : 0;
+    return err;
+}
+
+EdsError EDSAPI EdsSeek(EdsStreamRef inStreamRef, EdsInt64 inSeekOffset, EdsSeekOrigin inSeekOrigin)
+{
+    auto stream = as<stream_object>(inStreamRef);
+    if (!stream)
+        return EDS_ERR_INVALID_HANDLE;
+
+    return stream->seek(inSeekOffset, inSeekOrigin);
+}
+
+EdsError EDSAPI EdsGetPosition(EdsStreamRef inStreamRef, EdsUInt64* outPosition)
+{
+    auto stream = as<stream_object>(inStreamRef);
+    if (!stream || !outPosition)
+        return EDS_ERR_INVALID_HANDLE;
+
+    *outPosition = stream->position();
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsGetLength(EdsStreamRef inStreamRef, EdsUInt64* outLength)
+{
+    auto stream = as<stream_object>(inStreamRef);
+    if (!stream || !outLength)
+        return EDS_ERR_INVALID_HANDLE;
+
+    *outLength = stream->length();
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsCopyData(
+    EdsStreamRef inStreamRef, EdsUInt64 inWriteSize, EdsStreamRef outStreamRef)
+{
+    auto source = as<stream_object>(inStreamRef);
+    auto destination = as<stream_object>(outStreamRef);
+    if (!source || !destination)
+        return EDS_ERR_INVALID_HANDLE;
+
+    std::vector<uint8_t> buffer(std::min<uint64_t>(inWriteSize, transfer_chunk_size));
+    for (uint64_t done = 0; done < inWriteSize;)
+    {
+        uint64_t read_size = 0;
+        const auto count = std::min<uint64_t>(buffer.size(), inWriteSize - done);
+        if (auto err = source->read(count, buffer.data(), read_size); err != EDS_ERR_OK)
+            return err;
+        if (read_size == 0)
+            return EDS_ERR_STREAM_END_OF_STREAM;
+        if (auto err = destination->write(read_size, buffer.data()); err != EDS_ERR_OK)
+            return err;
+        done += read_size;
+    }
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsSetProgressCallback(EdsBaseRef inRef, EdsProgressCallback inProgressCallback,
+    EdsProgressOption inProgressOption, EdsVoid* inContext)
+{
+    auto stream = as<stream_object>(inRef);
+    if (!stream)
+        return EDS_ERR_INVALID_HANDLE;
+
+    stream->progress = inProgressCallback;
+    stream->progress_option = inProgressOption;
+    stream->progress_context = inContext;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsCreateImageRef(EdsStreamRef inStreamRef, EdsImageRef* outImageRef)
+{
+    auto stream = as<stream_object>(inStreamRef);
+    if (!stream || !outImageRef)
+        return EDS_ERR_INVALID_HANDLE;
+
+    *outImageRef = new image_object(*stream);
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsGetImageInfo(
+    EdsImageRef inImageRef, EdsImageSource /*inImageSource*/, EdsImageInfo* outImageInfo)
+{
+    auto image = as<image_object>(inImageRef);
+    if (!image || !outImageInfo)
+        return EDS_ERR_INVALID_HANDLE;
+    if (!image->is_raw)
+        return EDS_ERR_FILE_FORMAT_UNRECOGNIZED;
+
+    const auto width = static_cast<EdsInt32>(image_object::width);
+    const auto height = static_cast<EdsInt32>(image_object::height);
+    *outImageInfo = { image_object::width, image_object::height, 3, 16,
+        { { 0, 0 }, { width, height } }, 0, 0 };
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsGetImage(EdsImageRef inImageRef, EdsImageSource /*inImageSource*/,
+    EdsTargetImageType inImageType, EdsRect /*inSrcRect*/, EdsSize inDstSize,
+    EdsStreamRef outStreamRef)
+{
+    auto image = as<image_object>(inImageRef);
+    auto output = as<stream_object>(outStreamRef);
+    if (!image || !output)
+        return EDS_ERR_INVALID_HANDLE;
+    if (!image->is_raw)
+        return EDS_ERR_FILE_FORMAT_UNRECOGNIZED;
+    if (inImageType != kEdsTargetImageType_RGB && inImageType != kEdsTargetImageType_RGB16)
+        return EDS_ERR_INVALID_PARAMETER;
+
+    // Developing happens on the computer, so it takes time without holding the camera
+    std::chrono::microseconds latency(0);
+    {
+        auto& sdk = state();
+        std::lock_guard<std::mutex> lock(sdk.mutex);
+        if (sdk.camera_list)
+            latency = sdk.camera_list->config.timing.latency_of("EdsGetImage");
+    }
+    std::this_thread::sleep_for(latency);
+
+    // A gradient, with 1 or 2 bytes per component
+    const std::size_t component_size = (inImageType == kEdsTargetImageType_RGB16) ? 2 : 1;
+    std::vector<uint8_t> row;
+    for (EdsInt32 y = 0; y < inDstSize.height; y++)
+    {
+        row.clear();
+        for (EdsInt32 x = 0; x < inDstSize.width * 3; x++)
+            row.insert(row.end(), component_size, static_cast<uint8_t>(x + y));
+
+        if (auto err = output->write(row.size(), row.data()); err != EDS_ERR_OK)
+            return err;
+    }
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsCreateEvfImageRef(EdsStreamRef inStreamRef, EdsEvfImageRef* outEvfImageRef)
+{
+    auto stream = as<stream_object>(inStreamRef);
+    if (!stream || !outEvfImageRef)
+        return EDS_ERR_INVALID_HANDLE;
+
+    *outEvfImageRef = new evf_image_object(*stream);
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsDownloadEvfImage(EdsCameraRef inCameraRef, EdsEvfImageRef inEvfImageRef)
+{
+    auto camera = as<camera_object>(inCameraRef);
+    auto image = as<evf_image_object>(inEvfImageRef);
+    if (!camera || !image)
+        return EDS_ERR_INVALID_HANDLE;
+
+    // Live view frames only go to the computer once the output device has been set
+    EdsUInt32 output_device = 0;
+    if (const auto value = camera->get_property(kEdsPropID_Evf_OutputDevice))
+        std::memcpy(&output_device, value->data.data(), sizeof(output_device));
+    if ((output_device & kEdsEvfOutputDevice_PC) == 0)
+        return EDS_ERR_OBJECT_NOTREADY;
+
+    const auto call = camera->call("EdsDownloadEvfImage");
+    if (call.error != EDS_ERR_OK)
+        return call.error;
+
+    // A new frame is ready at the live view frame rate
+    const auto interval = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(1 / camera->timing.live_view_frames_per_second));
+    const auto now = clock::now();
+    if (camera->next_live_view_frame > now)
+        std::this_thread::sleep_until(camera->next_live_view_frame);
+    camera->next_live_view_frame = std::max(now, camera->next_live_view_frame) + interval;
+
+    const auto started = clock::now();
+    const auto frame = content::jpeg(
+        std::time(nullptr), ++camera->live_view_frames, camera->timing.thumbnail_size);
+    if (auto err = image->stream.write(frame.size(), frame.data()); err != EDS_ERR_OK)
+        return err;
+
+    camera->transfer(started, frame.size());
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsSetCameraAddedHandler(
+    EdsCameraAddedHandler inCameraAddedHandler, EdsVoid* inContext)
+{
+    // The simulated cameras are all connected when the SDK is initialised, and the handler is
+    // only called when one is reconnected after an injected disconnect
+    auto& sdk = state();
+    std::lock_guard<std::mutex> lock(sdk.mutex);
+    sdk.camera_added_handler = inCameraAddedHandler;
+    sdk.camera_added_context = inContext;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsSetPropertyEventHandler(EdsCameraRef inCameraRef, EdsPropertyEvent /*inEvent*/,
+    EdsPropertyEventHandler inPropertyEventHandler, EdsVoid* inContext)
+{
+    auto camera = as<camera_object>(inCameraRef);
+    if (!camera)
+        return EDS_ERR_INVALID_HANDLE;
+
+    std::lock_guard<std::mutex> lock(camera->handler_mutex);
+    camera->property_handler = inPropertyEventHandler;
+    camera->property_context = inContext;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsSetObjectEventHandler(EdsCameraRef inCameraRef, EdsObjectEvent /*inEvent*/,
+    EdsObjectEventHandler inObjectEventHandler, EdsVoid* inContext)
+{
+    auto camera = as<camera_object>(inCameraRef);
+    if (!camera)
+        return EDS_ERR_INVALID_HANDLE;
+
+    std::lock_guard<std::mutex> lock(camera->handler_mutex);
+    camera->object_handler = inObjectEventHandler;
+    camera->object_context = inContext;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsSetCameraStateEventHandler(EdsCameraRef inCameraRef, EdsStateEvent /*inEvent*/,
+    EdsStateEventHandler inStateEventHandler, EdsVoid* inContext)
+{
+    auto camera = as<camera_object>(inCameraRef);
+    if (!camera)
+        return EDS_ERR_INVALID_HANDLE;
+
+    std::lock_guard<std::mutex> lock(camera->handler_mutex);
+    camera->state_handler = inStateEventHandler;
+    camera->state_context = inContext;
+    return EDS_ERR_OK;
+}
+
+EdsError EDSAPI EdsCreateStream(EdsIStream* /*inStream*/, EdsStreamRef* /*outStreamRef*/)
+{
+    return EDS_ERR_NOT_SUPPORTED;
+}
+
+EdsError EDSAPI EdsGetEvent()
+{
+    auto& sdk = state();
+    std::vector<camera_object*> cameras;
+    EdsCameraAddedHandler camera_added = nullptr;
+    EdsVoid* camera_added_context = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(sdk.mutex);
+        if (!sdk.camera_list)
+            return EDS_ERR_OK;
+
+        for (const auto& camera : sdk.camera_list->cameras)
+            cameras.push_back(camera.get());
+        camera_added = sdk.camera_added_handler;
+        camera_added_context = sdk.camera_added_context;
+    }
+
+    bool reconnected = false;
+    for (auto camera : cameras)
+    {
+        camera->dispatch_events();
+        if (camera->reconnect_if_due())
+            reconnected = true;
+    }
+
+    if (reconnected && camera_added)
+        camera_added(camera_added_context);
+    return EDS_ERR_OK;
+}
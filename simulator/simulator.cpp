@@ -0,0 +1,958 @@
+//
+//  simulator.cpp
+//  edsdk_simulator
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#include "simulator_objects.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace simulator
+{
+namespace
+{
+    /// Parse a size, which can end in K, M or G (powers of 1024)
+    uint64_t parse_size(const std::string& key, const std::string& text)
+    {
+        std::size_t end = 0;
+        double value = 0;
+        try
+        {
+            value = std::stod(text, &end);
+        }
+        catch (const std::exception&)
+        {
+            throw std::invalid_argument("Bad value for " + key + ": '" + text + "'");
+        }
+
+        const auto suffix = text.substr(end);
+        if (suffix == "K" || suffix == "k")
+            value *= 1024;
+        else if (suffix == "M" || suffix == "m")
+            value *= 1024 * 1024;
+        else if (suffix == "G" || suffix == "g")
+            value *= 1024.0 * 1024 * 1024;
+        else if (!suffix.empty() || value < 0)
+            throw std::invalid_argument("Bad value for " + key + ": '" + text + "'");
+
+        return static_cast<uint64_t>(value);
+    }
+
+    /// Parse a number between 0 and 1
+    double parse_fraction(const std::string& key, const std::string& text)
+    {
+        std::size_t end = 0;
+        double value = -1;
+        try
+        {
+            value = std::stod(text, &end);
+        }
+        catch (const std::exception&)
+        {
+        }
+
+        if (end != text.size() || value < 0 || value > 1)
+            throw std::invalid_argument("Bad value for " + key + ": '" + text + "'");
+        return value;
+    }
+
+    /// Parse a fault, e.g. EdsDownload:disconnect:at=0.5:file=IMG_0003.CR2
+    fault parse_fault(const std::string& text)
+    {
+        std::vector<std::string> parts;
+        std::istringstream fields(text);
+        for (std::string field; std::getline(fields, field, ':');)
+            parts.push_back(field);
+
+        if (parts.size() < 2 || parts[0].empty())
+            throw std::invalid_argument("Expected function:fault, not '" + text + "'");
+
+        fault result;
+        result.function = parts[0];
+
+        for (std::size_t i = 1; i < parts.size(); i++)
+        {
+            const auto equals = parts[i].find('=');
+            const auto key = parts[i].substr(0, equals);
+            const auto value = (equals == std::string::npos) ? "" : parts[i].substr(equals + 1);
+
+            if (i == 1 && key == "busy")
+                result.kind = fault::kind_t::error;
+            else if (i == 1 && key == "disconnect")
+                result.kind = fault::kind_t::disconnect;
+            else if (i == 1 && key == "error")
+            {
+                result.kind = fault::kind_t::error;
+                try
+                {
+                    result.error = static_cast<uint32_t>(std::stoul(value, nullptr, 0));
+                }
+                catch (const std::exception&)
+                {
+                    throw std::invalid_argument("Bad error code in fault '" + text + "'");
+                }
+            }
+            else if (i == 1 && key == "delay")
+            {
+                result.kind = fault::kind_t::delay;
+                result.delay = std::chrono::microseconds(parse_size(key, value));
+            }
+            else if (i == 1)
+                throw std::invalid_argument("Unknown fault '" + key + "' in '" + text + "'");
+            else if (key == "p")
+                result.probability = parse_fraction(key, value);
+            else if (key == "after")
+                result.after_calls = parse_size(key, value);
+            else if (key == "times")
+                result.times = parse_size(key, value);
+            else if (key == "file")
+                result.file = value;
+            else if (key == "at")
+                result.at_fraction = parse_fraction(key, value);
+            else if (key == "reconnect_ms")
+                result.reconnect_after = std::chrono::milliseconds(parse_size(key, value));
+            else
+                throw std::invalid_argument("Unknown fault option '" + key + "' in '" + text + "'");
+        }
+
+        return result;
+    }
+
+    uint32_t format_of(const std::string& extension)
+    {
+        std::string upper(extension);
+        std::transform(upper.begin(), upper.end(), upper.begin(),
+            [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+
+        if (upper == ".CR2")
+            return kEdsObjectFormat_CR2;
+        if (upper == ".CR3")
+            return kEdsObjectFormat_CR3;
+        if (upper == ".JPG")
+            return kEdsObjectFormat_Jpeg;
+        return kEdsObjectFormat_Unknown;
+    }
+
+    /// Random looking but repeatable bytes (splitmix64)
+    uint64_t mix(uint64_t x)
+    {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    constexpr char date_marker[] = "SIM1";
+    constexpr std::size_t raw_date_offset = 16;
+    constexpr std::size_t jpeg_date_offset = 6;
+    constexpr std::size_t header_size = 32;
+
+    void write_date(uint8_t* at, std::time_t taken)
+    {
+        std::memcpy(at, date_marker, 4);
+        const auto value = static_cast<int64_t>(taken);
+        for (int i = 0; i < 8; i++)
+            at[4 + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    std::optional<std::time_t> read_date_at(const uint8_t* at)
+    {
+        if (std::memcmp(at, date_marker, 4) != 0)
+            return std::nullopt;
+
+        int64_t value = 0;
+        for (int i = 0; i < 8; i++)
+            value |= static_cast<int64_t>(at[4 + i]) << (8 * i);
+        return static_cast<std::time_t>(value);
+    }
+} // namespace
+
+void configure(const configuration& config)
+{
+    std::lock_guard<std::mutex> lock(state().mutex);
+    state().configured = config;
+}
+
+configuration parse_configuration(const std::string& settings)
+{
+    configuration config;
+    std::size_t camera_count = 1;
+    card card_settings;
+    std::size_t card_count = 1;
+    bool capacity_set = false;
+
+    std::istringstream items(settings);
+    std::string item;
+    while (std::getline(items, item, ','))
+    {
+        if (item.empty())
+            continue;
+
+        const auto equals = item.find('=');
+        if (equals == std::string::npos)
+            throw std::invalid_argument("Expected key=value, not '" + item + "'");
+
+        const auto key = item.substr(0, equals);
+        const auto value = item.substr(equals + 1);
+
+        if (key == "cameras")
+            camera_count = parse_size(key, value);
+        else if (key == "cards")
+            card_count = parse_size(key, value);
+        else if (key == "files")
+            card_settings.files = static_cast<uint32_t>(parse_size(key, value));
+        else if (key == "files_per_folder")
+            card_settings.files_per_folder
+                = std::max<uint32_t>(1, static_cast<uint32_t>(parse_size(key, value)));
+        else if (key == "file_size")
+            card_settings.file_size = parse_size(key, value);
+        else if (key == "capacity")
+        {
+            card_settings.capacity = parse_size(key, value);
+            capacity_set = true;
+        }
+        else if (key == "extension")
+            card_settings.extension = value;
+        else if (key == "bandwidth")
+            config.timing.bytes_per_second = static_cast<double>(parse_size(key, value));
+        else if (key == "thumbnail_size")
+            config.timing.thumbnail_size = std::max<uint64_t>(64, parse_size(key, value));
+        else if (key == "live_view_fps")
+            config.timing.live_view_frames_per_second
+                = std::max<double>(1, static_cast<double>(parse_size(key, value)));
+        else if (key == "fault")
+            config.faults.push_back(parse_fault(value));
+        else if (key == "fault_seed")
+            config.fault_seed = parse_size(key, value);
+        else if (key == "latency_us")
+            config.timing.call_latency = std::chrono::microseconds(parse_size(key, value));
+        else if (key.size() > 3 && key.compare(key.size() - 3, 3, "_us") == 0)
+            config.timing.call_latencies[key.substr(0, key.size() - 3)]
+                = std::chrono::microseconds(parse_size(key, value));
+        else
+            throw std::invalid_argument("Unknown setting '" + key + "'");
+    }
+
+    // Unless told otherwise, make the cards big enough for their files with some space to spare
+    const auto used = static_cast<uint64_t>(card_settings.files) * card_settings.file_size;
+    if (!capacity_set && used + used / 4 > card_settings.capacity)
+        card_settings.capacity = used + used / 4;
+
+    camera first_camera;
+    first_camera.cards.assign(card_count, card_settings);
+    for (std::size_t i = 1; i < card_count; i++)
+    {
+        first_camera.cards[i].label = "SD";
+        first_camera.cards[i].storage_type = kEdsStorageType_SD;
+    }
+
+    config.cameras.assign(camera_count, first_camera);
+    for (std::size_t i = 0; i < camera_count; i++)
+    {
+        config.cameras[i].port = "usb:" + std::to_string(i);
+        config.cameras[i].body_id = std::to_string(12345678901ull + i);
+    }
+
+    return config;
+}
+
+sdk_state& state()
+{
+    static sdk_state sdk;
+    return sdk;
+}
+
+void inject_faults(const std::vector<fault>& faults, uint64_t seed)
+{
+    state().faults.set_faults(faults, seed);
+}
+
+fault_statistics get_fault_statistics() { return state().faults.statistics(); }
+
+void reset_fault_statistics() { state().faults.reset_statistics(); }
+
+void fault_injector::set_faults(const std::vector<fault>& configured, uint64_t seed)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    faults.clear();
+    for (const auto& settings : configured)
+        faults.push_back({ settings });
+
+    random.seed(seed);
+    active = !faults.empty();
+}
+
+std::optional<fault> fault_injector::next(const char* function, const item_object* item)
+{
+    if (!active.load(std::memory_order_relaxed))
+        return std::nullopt;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::optional<std::string> file_name;
+
+    for (auto& candidate : faults)
+    {
+        const auto& settings = candidate.settings;
+        if (settings.function != "*" && settings.function != function)
+            continue;
+
+        if (!settings.file.empty())
+        {
+            if (!item || item->kind != item_object::kind_t::file)
+                continue;
+            if (!file_name)
+                file_name = item->volume.file_name(item->file);
+            if (*file_name != settings.file)
+                continue;
+        }
+
+        if (++candidate.calls <= settings.after_calls || candidate.injected >= settings.times)
+            continue;
+        if (settings.probability < 1
+            && std::uniform_real_distribution<double>(0, 1)(random) >= settings.probability)
+            continue;
+
+        candidate.injected++;
+        injected++;
+        return settings;
+    }
+
+    return std::nullopt;
+}
+
+fault_statistics fault_injector::statistics() const
+{
+    return { injected, disconnects, bytes_downloaded, bytes_wasted };
+}
+
+void fault_injector::reset_statistics()
+{
+    injected = 0;
+    disconnects = 0;
+    bytes_downloaded = 0;
+    bytes_wasted = 0;
+}
+
+property property::string(const std::string& value)
+{
+    std::vector<uint8_t> data(value.begin(), value.end());
+    data.push_back(0);
+    return { kEdsDataType_String, EDS_MAX_NAME, data };
+}
+
+property property::time(std::time_t value)
+{
+    std::tm local {};
+    localtime_r(&value, &local);
+
+    const EdsTime time { static_cast<EdsUInt32>(local.tm_year + 1900),
+        static_cast<EdsUInt32>(local.tm_mon + 1), static_cast<EdsUInt32>(local.tm_mday),
+        static_cast<EdsUInt32>(local.tm_hour), static_cast<EdsUInt32>(local.tm_min),
+        static_cast<EdsUInt32>(local.tm_sec), 0 };
+    return property::value(kEdsDataType_Time, time);
+}
+
+camera_list_object::camera_list_object(const configuration& configured)
+    : __EdsObject(true)
+    , config(configured)
+{
+    for (const auto& camera_settings : config.cameras)
+        cameras.push_back(std::make_unique<camera_object>(camera_settings, config.timing));
+}
+
+// Disconnected cameras are left out of the list until they are reconnected
+EdsError camera_list_object::child_count(EdsUInt32& count)
+{
+    count = static_cast<EdsUInt32>(std::count_if(cameras.begin(), cameras.end(),
+        [](const std::unique_ptr<camera_object>& camera) { return !camera->is_disconnected(); }));
+    return EDS_ERR_OK;
+}
+
+EdsError camera_list_object::child_at(EdsInt32 index, EdsBaseRef& child)
+{
+    for (const auto& camera : cameras)
+    {
+        if (camera->is_disconnected() || index-- != 0)
+            continue;
+
+        child = camera.get();
+        child->references++;
+        return EDS_ERR_OK;
+    }
+
+    return EDS_ERR_INVALID_INDEX;
+}
+
+camera_object::camera_object(const simulator::camera& camera_settings, const timing_model& model)
+    : __EdsObject(true)
+    , settings(camera_settings)
+    , timing(model)
+    , device_info {}
+{
+    std::strncpy(device_info.szPortName, settings.port.c_str(), EDS_MAX_NAME - 1);
+    std::strncpy(
+        device_info.szDeviceDescription, settings.product_name.c_str(), EDS_MAX_NAME - 1);
+    device_info.deviceSubType = 1;
+
+    for (const auto& card_settings : settings.cards)
+        volumes.push_back(std::make_unique<volume_object>(*this, card_settings));
+
+    const std::string storage = settings.cards.empty() ? "" : settings.cards.front().label;
+    properties = {
+        { kEdsPropID_ProductName, property::string(settings.product_name) },
+        { kEdsPropID_BodyIDEx, property::string(settings.body_id) },
+        { kEdsPropID_OwnerName, property::string(settings.owner_name) },
+        { kEdsPropID_MakerName, property::string("Canon") },
+        { kEdsPropID_FirmwareVersion, property::string(settings.firmware_version) },
+        { kEdsPropID_BatteryLevel, property::value(kEdsDataType_Int32, settings.battery_level) },
+        { kEdsPropID_BatteryQuality,
+            property::value(kEdsDataType_UInt32, EdsUInt32(kEdsBatteryQuality_Full)) },
+        { kEdsPropID_SaveTo, property::value(kEdsDataType_UInt32, EdsUInt32(1)) },
+        { kEdsPropID_CurrentStorage, property::string(storage) },
+        { kEdsPropID_CurrentFolder, property::string("100CANON") },
+        { kEdsPropID_LensStatus, property::value(kEdsDataType_UInt32, EdsUInt32(1)) },
+        { kEdsPropID_LensName, property::string(settings.lens_name) },
+        { kEdsPropID_Artist, property::string("") },
+        { kEdsPropID_Copyright, property::string("") },
+        { kEdsPropID_Evf_OutputDevice,
+            property::value(kEdsDataType_UInt32, EdsUInt32(kEdsEvfOutputDevice_TFT)) },
+    };
+}
+
+EdsError camera_object::child_count(EdsUInt32& count)
+{
+    count = static_cast<EdsUInt32>(volumes.size());
+    return EDS_ERR_OK;
+}
+
+EdsError camera_object::child_at(EdsInt32 index, EdsBaseRef& child)
+{
+    if (index < 0 || static_cast<std::size_t>(index) >= volumes.size())
+        return EDS_ERR_INVALID_INDEX;
+
+    child = volumes[static_cast<std::size_t>(index)].get();
+    child->references++;
+    return EDS_ERR_OK;
+}
+
+std::optional<property> camera_object::get_property(EdsPropertyID id)
+{
+    switch (id)
+    {
+    case kEdsPropID_DateTime:
+        return property::time(std::time(nullptr));
+
+    case kEdsPropID_AvailableShots:
+    {
+        if (volumes.empty())
+            return property::value(kEdsDataType_UInt32, EdsUInt32(0));
+
+        const auto card_info = volumes.front()->info();
+        const auto file_size = std::max<uint64_t>(1, settings.cards.front().file_size);
+        return property::value(kEdsDataType_UInt32,
+            static_cast<EdsUInt32>(card_info.freeSpaceInBytes * 1024 / file_size));
+    }
+
+    default:
+    {
+        std::lock_guard<std::mutex> lock(property_mutex);
+        const auto found = properties.find(id);
+        if (found == properties.end())
+            return std::nullopt;
+        return found->second;
+    }
+    }
+}
+
+EdsError camera_object::set_property(EdsPropertyID id, const property& value)
+{
+    {
+        std::lock_guard<std::mutex> lock(property_mutex);
+        const auto found = properties.find(id);
+        if (found == properties.end())
+            return EDS_ERR_PROPERTIES_UNAVAILABLE;
+        if (found->second.type != kEdsDataType_String && found->second.size != value.size)
+            return EDS_ERR_INVALID_PARAMETER;
+
+        found->second.data = value.data;
+    }
+
+    queue_event({ pending_event::property_changed, id, 0, nullptr });
+    return EDS_ERR_OK;
+}
+
+camera_call camera_object::call(const char* function, const item_object* item)
+{
+    camera_call result;
+    if (disconnected)
+    {
+        result.error = EDS_ERR_COMM_DISCONNECTED;
+        return result;
+    }
+
+    const auto injected = state().faults.next(function, item);
+    result.usb = std::unique_lock<std::mutex>(usb);
+
+    auto latency = timing.latency_of(function);
+    if (injected && injected->kind == fault::kind_t::delay)
+        latency += injected->delay;
+    if (latency.count() > 0)
+        std::this_thread::sleep_for(latency);
+
+    if (!injected || injected->kind == fault::kind_t::delay)
+        return result;
+
+    // Downloads can fail part way through, once some of the file has been transferred
+    if (injected->at_fraction > 0 && std::strcmp(function, "EdsDownload") == 0)
+    {
+        result.mid_transfer_fault = injected;
+        return result;
+    }
+
+    if (injected->kind == fault::kind_t::disconnect)
+    {
+        disconnect(injected->reconnect_after);
+        result.error = EDS_ERR_COMM_DISCONNECTED;
+    }
+    else
+        result.error = static_cast<EdsError>(injected->error);
+
+    return result;
+}
+
+void camera_object::disconnect(std::chrono::milliseconds reconnect_after)
+{
+    std::lock_guard<std::mutex> lock(handler_mutex);
+    if (disconnected.exchange(true))
+        return;
+
+    state().faults.count_disconnect();
+    reconnect_at = clock::now() + reconnect_after;
+    events.push_back({ pending_event::state_changed, 0, 0, nullptr, kEdsStateEvent_Shutdown });
+}
+
+bool camera_object::reconnect_if_due()
+{
+    if (!disconnected)
+        return false;
+
+    // The same lock order as a call that disconnects the camera
+    std::lock_guard<std::mutex> usb_lock(usb);
+    std::lock_guard<std::mutex> lock(handler_mutex);
+    if (!disconnected || clock::now() < reconnect_at)
+        return false;
+
+    // The sessions were lost with the connection
+    sessions = 0;
+    disconnected = false;
+    return true;
+}
+
+void camera_object::wait_for_cancel(const item_object& item, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(cancel_mutex);
+    download_cancelled.wait_for(lock, timeout, [&item] { return item.cancelled.load(); });
+}
+
+void camera_object::cancel_download(item_object& item)
+{
+    state().faults.count_wasted(item.downloaded.exchange(0));
+    {
+        std::lock_guard<std::mutex> lock(cancel_mutex);
+        item.cancelled = true;
+    }
+    download_cancelled.notify_all();
+}
+
+void camera_object::transfer(clock::time_point started, uint64_t size) const
+{
+    if (timing.bytes_per_second <= 0)
+        return;
+
+    const std::chrono::duration<double> duration(
+        static_cast<double>(size) / timing.bytes_per_second);
+    std::this_thread::sleep_until(
+        started + std::chrono::duration_cast<clock::duration>(duration));
+}
+
+void camera_object::queue_event(const pending_event& event)
+{
+    std::lock_guard<std::mutex> lock(handler_mutex);
+    events.push_back(event);
+}
+
+void camera_object::dispatch_events()
+{
+    std::deque<pending_event> ready;
+    EdsPropertyEventHandler on_property = nullptr;
+    EdsVoid* on_property_context = nullptr;
+    EdsObjectEventHandler on_object = nullptr;
+    EdsVoid* on_object_context = nullptr;
+    EdsStateEventHandler on_state = nullptr;
+    EdsVoid* on_state_context = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(handler_mutex);
+        ready.swap(events);
+        on_property = property_handler;
+        on_property_context = property_context;
+        on_object = object_handler;
+        on_object_context = object_context;
+        on_state = state_handler;
+        on_state_context = state_context;
+    }
+
+    // The handlers are called without any locks held, as they usually call back into the SDK
+    for (const auto& event : ready)
+    {
+        if (event.type == pending_event::property_changed)
+        {
+            if (on_property)
+                on_property(kEdsPropertyEvent_PropertyChanged, event.property_id, 0,
+                    on_property_context);
+        }
+        else if (event.type == pending_event::state_changed)
+        {
+            if (on_state)
+                on_state(event.state_event, 0, on_state_context);
+        }
+        else if (on_object)
+        {
+            // The handler is given the reference to the object
+            on_object(event.object_event, event.object, on_object_context);
+        }
+        else
+        {
+            EdsRelease(event.object);
+        }
+    }
+}
+
+EdsError volume_object::child_count(EdsUInt32& count)
+{
+    count = 1;
+    return EDS_ERR_OK;
+}
+
+EdsError volume_object::child_at(EdsInt32 index, EdsBaseRef& child)
+{
+    if (index != 0)
+        return EDS_ERR_INVALID_INDEX;
+
+    child = new item_object(*this, item_object::kind_t::dcim);
+    return EDS_ERR_OK;
+}
+
+EdsVolumeInfo volume_object::info()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    EdsVolumeInfo volume {};
+    volume.storageType = settings.storage_type;
+    volume.access = kEdsAccess_ReadWrite;
+    // Cameras report both sizes in KB, despite the name of freeSpaceInBytes, and volume_ref passes
+    // them on unchanged
+    volume.maxCapacity = settings.capacity / 1024;
+    const auto used = (settings.files - deleted.size()) * settings.file_size;
+    volume.freeSpaceInBytes = (used < settings.capacity) ? (settings.capacity - used) / 1024 : 0;
+    std::strncpy(volume.szVolumeLabel, settings.label.c_str(), EDS_MAX_NAME - 1);
+    return volume;
+}
+
+uint32_t volume_object::folder_count()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return (settings.files + settings.files_per_folder - 1) / settings.files_per_folder;
+}
+
+uint32_t volume_object::files_in_folder(uint32_t folder)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto first = static_cast<uint64_t>(folder) * settings.files_per_folder;
+    if (first >= settings.files)
+        return 0;
+
+    const auto files = std::min<uint64_t>(settings.files_per_folder, settings.files - first);
+    const auto removed = std::distance(
+        deleted.lower_bound(first), deleted.lower_bound(first + settings.files_per_folder));
+    return static_cast<uint32_t>(files - static_cast<uint64_t>(removed));
+}
+
+picture volume_object::picture_at(uint32_t folder, uint32_t position)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto sequence = static_cast<uint64_t>(folder) * settings.files_per_folder + position;
+    return { position + 1,
+        settings.first_picture
+            + static_cast<std::time_t>(sequence * settings.picture_interval.count()),
+        settings.file_size };
+}
+
+uint32_t volume_object::position_of(uint32_t folder, uint32_t index)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto first = static_cast<uint64_t>(folder) * settings.files_per_folder;
+
+    // Skip over the deleted pictures before it, in order
+    uint64_t position = index;
+    for (auto removed = deleted.lower_bound(first);
+         removed != deleted.end() && *removed <= first + position; ++removed)
+        position++;
+    return static_cast<uint32_t>(position);
+}
+
+bool volume_object::delete_picture(uint32_t folder, const picture& file)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto position = file.number - 1;
+    return deleted.insert(static_cast<uint64_t>(folder) * settings.files_per_folder + position)
+        .second;
+}
+
+// The file name settings never change, so they can be read without the lock
+std::string volume_object::file_name(const picture& file) const
+{
+    char number[8];
+    std::snprintf(number, sizeof(number), "%04u", file.number % 10000);
+    return settings.file_prefix + number + settings.extension;
+}
+
+uint32_t volume_object::file_format() const { return format_of(settings.extension); }
+
+EdsDirectoryItemRef volume_object::add_picture()
+{
+    uint32_t folder = 0;
+    uint32_t index = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        folder = settings.files / settings.files_per_folder;
+        index = settings.files % settings.files_per_folder;
+        settings.files++;
+    }
+    return new item_object(*this, item_object::kind_t::file, folder, picture_at(folder, index));
+}
+
+EdsError item_object::child_count(EdsUInt32& count)
+{
+    switch (kind)
+    {
+    case kind_t::dcim:
+        count = volume.folder_count();
+        return EDS_ERR_OK;
+    case kind_t::folder:
+        count = volume.files_in_folder(folder);
+        return EDS_ERR_OK;
+    case kind_t::file:
+        break;
+    }
+    return EDS_ERR_INVALID_HANDLE;
+}
+
+EdsError item_object::child_at(EdsInt32 index, EdsBaseRef& child)
+{
+    EdsUInt32 count = 0;
+    if (auto err = child_count(count); err != EDS_ERR_OK)
+        return err;
+    if (index < 0 || static_cast<EdsUInt32>(index) >= count)
+        return EDS_ERR_INVALID_INDEX;
+
+    const auto position = static_cast<uint32_t>(index);
+    if (kind == kind_t::dcim)
+        child = new item_object(volume, kind_t::folder, position);
+    else
+        child = new item_object(volume, kind_t::file, folder,
+            volume.picture_at(folder, volume.position_of(folder, position)));
+    return EDS_ERR_OK;
+}
+
+EdsDirectoryItemInfo item_object::info() const
+{
+    EdsDirectoryItemInfo item {};
+    char name[EDS_MAX_NAME];
+
+    switch (kind)
+    {
+    case kind_t::dcim:
+        std::snprintf(name, sizeof(name), "DCIM");
+        item.isFolder = true;
+        break;
+    case kind_t::folder:
+        std::snprintf(name, sizeof(name), "%03uCANON", 100 + folder);
+        item.isFolder = true;
+        break;
+    case kind_t::file:
+    {
+        std::snprintf(name, sizeof(name), "%s", volume.file_name(file).c_str());
+        item.size = file.size;
+        item.format = volume.file_format();
+        item.dateTime = static_cast<EdsUInt32>(file.taken);
+        break;
+    }
+    }
+
+    std::strncpy(item.szFileName, name, EDS_MAX_NAME - 1);
+    return item;
+}
+
+bool stream_object::report_progress(EdsUInt32 percent)
+{
+    if (!progress || progress_option == kEdsProgressOption_NoReport)
+        return true;
+    if (progress_option == kEdsProgressOption_Done && percent < 100)
+        return true;
+
+    EdsBool cancel = false;
+    progress(percent, progress_context, &cancel);
+    return !cancel;
+}
+
+EdsError memory_stream::read(uint64_t size, void* buffer, uint64_t& read_size)
+{
+    read_size = (offset < data.size()) ? std::min<uint64_t>(size, data.size() - offset) : 0;
+    std::memcpy(buffer, data.data() + offset, read_size);
+    offset += read_size;
+    return EDS_ERR_OK;
+}
+
+EdsError memory_stream::write(uint64_t size, const void* buffer)
+{
+    if (offset + size > data.size())
+        data.resize(offset + size);
+
+    std::memcpy(data.data() + offset, buffer, size);
+    offset += size;
+    return EDS_ERR_OK;
+}
+
+EdsError memory_stream::seek(int64_t distance, EdsSeekOrigin origin)
+{
+    int64_t from = 0;
+    if (origin == kEdsSeek_Cur)
+        from = static_cast<int64_t>(offset);
+    else if (origin == kEdsSeek_End)
+        from = static_cast<int64_t>(data.size());
+
+    if (from + distance < 0)
+        return EDS_ERR_STREAM_SEEK_ERROR;
+
+    offset = static_cast<uint64_t>(from + distance);
+    return EDS_ERR_OK;
+}
+
+EdsError file_stream::read(uint64_t size, void* buffer, uint64_t& read_size)
+{
+    read_size = std::fread(buffer, 1, size, file);
+    return (std::ferror(file) != 0) ? EDS_ERR_FILE_IO_ERROR : EDS_ERR_OK;
+}
+
+EdsError file_stream::write(uint64_t size, const void* buffer)
+{
+    return (std::fwrite(buffer, 1, size, file) == size) ? EDS_ERR_OK : EDS_ERR_FILE_WRITE_ERROR;
+}
+
+EdsError file_stream::seek(int64_t offset, EdsSeekOrigin origin)
+{
+    const int whence
+        = (origin == kEdsSeek_Cur) ? SEEK_CUR : (origin == kEdsSeek_End) ? SEEK_END : SEEK_SET;
+    return (fseeko(file, static_cast<off_t>(offset), whence) == 0) ? EDS_ERR_OK
+                                                                   : EDS_ERR_STREAM_SEEK_ERROR;
+}
+
+uint64_t file_stream::position() { return static_cast<uint64_t>(ftello(file)); }
+
+uint64_t file_stream::length()
+{
+    const auto current = ftello(file);
+    fseeko(file, 0, SEEK_END);
+    const auto end = ftello(file);
+    fseeko(file, current, SEEK_SET);
+    return static_cast<uint64_t>(end);
+}
+
+image_object::image_object(stream_object& source)
+{
+    const auto current = source.position();
+    uint8_t header[header_size] = {};
+    uint64_t read_size = 0;
+
+    if (source.seek(0, kEdsSeek_Begin) == EDS_ERR_OK
+        && source.read(sizeof(header), header, read_size) == EDS_ERR_OK)
+        taken = content::read_date(header, read_size, is_raw);
+
+    source.seek(static_cast<int64_t>(current), kEdsSeek_Begin);
+}
+
+std::optional<property> image_object::get_property(EdsPropertyID id)
+{
+    if (id == kEdsPropID_DateTime && taken)
+        return property::time(*taken);
+    return std::nullopt;
+}
+
+namespace content
+{
+    void raw_file(const picture& file, uint64_t offset, uint8_t* buffer, std::size_t size)
+    {
+        // Whole 8 byte words of repeatable noise, seeded by the file number
+        const uint64_t seed = mix(file.number) ^ static_cast<uint64_t>(file.taken);
+        for (std::size_t i = 0; i < size;)
+        {
+            const uint64_t position = offset + i;
+            const uint64_t word = mix(seed + position / 8);
+            const auto start = static_cast<std::size_t>(position % 8);
+            const auto count = std::min<std::size_t>(8 - start, size - i);
+            for (std::size_t b = 0; b < count; b++)
+                buffer[i + b] = static_cast<uint8_t>(word >> (8 * (start + b)));
+            i += count;
+        }
+
+        if (offset >= header_size)
+            return;
+
+        // A TIFF header with the CR2 signature, as the SDK checks for
+        uint8_t header[header_size] = { 'I', 'I', 0x2a, 0, 0x10, 0, 0, 0, 'C', 'R', 2, 0 };
+        write_date(header + raw_date_offset, file.taken);
+        for (int i = 0; i < 4; i++)
+            header[raw_date_offset + 12 + i] = static_cast<uint8_t>(file.number >> (8 * i));
+
+        const auto count = std::min<std::size_t>(header_size - offset, size);
+        std::memcpy(buffer, header + offset, count);
+    }
+
+    std::vector<uint8_t> jpeg(std::time_t taken, uint64_t sequence, uint64_t size)
+    {
+        std::vector<uint8_t> data(std::max<uint64_t>(size, header_size), 0);
+
+        // SOI, then an APP1 segment holding the date and sequence number, then EOI
+        const uint8_t start[] = { 0xff, 0xd8, 0xff, 0xe1, 0x00, 0x16 };
+        std::copy(std::begin(start), std::end(start), data.begin());
+        write_date(data.data() + jpeg_date_offset, taken);
+        for (int i = 0; i < 8; i++)
+            data[jpeg_date_offset + 12 + i] = static_cast<uint8_t>(sequence >> (8 * i));
+
+        data[data.size() - 2] = 0xff;
+        data[data.size() - 1] = 0xd9;
+        return data;
+    }
+
+    std::optional<std::time_t> read_date(const uint8_t* data, std::size_t size, bool& is_raw)
+    {
+        is_raw = size >= raw_date_offset && data[0] == 'I' && data[1] == 'I' && data[8] == 'C'
+            && data[9] == 'R';
+
+        if (is_raw && size >= raw_date_offset + 12)
+            return read_date_at(data + raw_date_offset);
+
+        if (size >= jpeg_date_offset + 12 && data[0] == 0xff && data[1] == 0xd8)
+            return read_date_at(data + jpeg_date_offset);
+
+        return std::nullopt;
+    }
+} // namespace content
+} // namespace simulator
@@ -0,0 +1,141 @@
+//
+//  simulator.hpp
+//  edsdk_simulator
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+/// A simulated camera SDK. The edsdk_simulator library implements the Eds* functions used by
+/// camera_interface with simulated cameras, so the tools and benchmarks can be built and run
+/// without a camera (or the Canon EDSDK). Calls that go to a camera take as long as the timing
+/// model says, one at a time per camera as they would over USB, and file contents are generated
+/// as they are downloaded, so cards with 100k files cost almost nothing to set up.
+///
+/// The configuration is taken from the CAMERA_SIMULATOR environment variable when the SDK is
+/// initialised, unless configure() has been called.
+namespace simulator
+{
+struct card
+{
+    std::string label = "CF";
+    uint32_t storage_type = 1; ///< kEdsStorageType_CF
+    uint64_t capacity = 64ull * 1024 * 1024 * 1024;
+    uint32_t files = 100;
+    /// Cameras start a new folder (100CANON, 101CANON, ...) when the file numbers reach 9999
+    uint32_t files_per_folder = 9999;
+    uint64_t file_size = 25 * 1024 * 1024;
+    std::string file_prefix = "IMG_";
+    std::string extension = ".CR2";
+    /// When the first picture was taken, and the time between pictures
+    std::time_t first_picture = 1609495200; // 2021-01-01 10:00:00 UTC
+    std::chrono::seconds picture_interval { 30 };
+};
+
+struct camera
+{
+    std::string port = "usb:0";
+    std::string product_name = "Canon EOS 5D Mark IV";
+    std::string body_id = "012345678901";
+    std::string owner_name = "Simulated Owner";
+    std::string firmware_version = "1.3.3";
+    std::string lens_name = "EF24-105mm f/4L IS II USM";
+    int32_t battery_level = 85;
+    std::vector<card> cards { card {} };
+};
+
+struct timing_model
+{
+    /// How long each call that goes to a camera takes before any data is transferred
+    std::chrono::microseconds call_latency { 500 };
+    /// Latency for particular calls, e.g. { "EdsDownloadThumbnail", 15ms }
+    std::map<std::string, std::chrono::microseconds> call_latencies {
+        { "EdsDownloadThumbnail", std::chrono::microseconds(8000) },
+        { "EdsOpenSession", std::chrono::microseconds(150000) },
+    };
+    /// USB transfer rate for downloads
+    double bytes_per_second = 35e6;
+    uint64_t thumbnail_size = 16 * 1024;
+    double live_view_frames_per_second = 30;
+
+    std::chrono::microseconds latency_of(const std::string& function) const
+    {
+        const auto latency = call_latencies.find(function);
+        return (latency != call_latencies.end()) ? latency->second : call_latency;
+    }
+};
+
+/// A fault injected into the calls made to a function, to test how the tools recover
+struct fault
+{
+    enum class kind_t
+    {
+        error, ///< The call fails with error
+        delay, ///< The call takes delay longer
+        disconnect ///< The camera is disconnected, and reconnected after reconnect_after
+    };
+
+    /// The function (e.g. "EdsDownload"), or "*" for every call that goes to a camera
+    std::string function = "*";
+    kind_t kind = kind_t::error;
+    uint32_t error = 0x81; ///< EDS_ERR_DEVICE_BUSY
+    std::chrono::microseconds delay { 0 };
+    /// The chance of a matching call having the fault
+    double probability = 1;
+    /// The number of matching calls before the first fault, and the most faults there can be
+    uint64_t after_calls = 0;
+    uint64_t times = UINT64_MAX;
+    /// Only calls on this file (e.g. "IMG_0003.CR2") match, if it is set
+    std::string file;
+    /// How much of a download is transferred before an error or disconnect
+    double at_fraction = 0;
+    std::chrono::milliseconds reconnect_after { 1000 };
+};
+
+/// What the injected faults have cost
+struct fault_statistics
+{
+    uint64_t faults = 0;
+    uint64_t disconnects = 0;
+    /// Bytes downloaded, and how many of them were thrown away by cancelled downloads
+    uint64_t bytes_downloaded = 0;
+    uint64_t bytes_wasted = 0;
+};
+
+struct configuration
+{
+    std::vector<camera> cameras { camera {} };
+    timing_model timing;
+    std::vector<fault> faults;
+    /// Seed for the fault probabilities, so runs can be repeated
+    uint64_t fault_seed = 1;
+};
+
+/// Use this configuration from the next time the SDK is initialised
+void configure(const configuration& config);
+
+/// The configuration described by settings, which is a comma separated list of key=value pairs
+/// that change the default configuration. Sizes can end in K, M or G. e.g.
+///   cameras=2,files=100000,file_size=30M,latency_us=300,bandwidth=40M,EdsDownload_us=2000
+/// Keys: cameras, files, files_per_folder, file_size, extension, capacity, latency_us,
+/// <function>_us, bandwidth (bytes per second), thumbnail_size, live_view_fps, fault, fault_seed.
+/// Each fault is the function (or *), the fault and its options, separated by colons. The fault
+/// is busy, error=<code>, delay=<us> or disconnect, and the options are p=<probability>,
+/// after=<calls>, times=<faults>, file=<name>, at=<fraction> and reconnect_ms=<ms>. e.g.
+///   fault=EdsDownload:busy:p=0.05,fault=EdsDownload:disconnect:file=IMG_0003.CR2:at=0.5
+/// Throws std::invalid_argument if a setting is not understood.
+configuration parse_configuration(const std::string& settings);
+
+/// Replace the faults injected into the running SDK, e.g. between benchmarks
+void inject_faults(const std::vector<fault>& faults, uint64_t seed = 1);
+fault_statistics get_fault_statistics();
+void reset_fault_statistics();
+} // namespace simulator
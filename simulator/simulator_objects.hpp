@@ -0,0 +1,418 @@
+//
+//  simulator_objects.hpp
+//  edsdk_simulator
+//
+//  Created by Rob McKay on 19/10/2026.
+//
+
+#pragma once
+
+#include "EDSDK.h"
+#include "EDSDKErrors.h"
+#include "simulator.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace simulator
+{
+class camera_object;
+
+/// The value of a property, as EdsGetPropertyData copies it out
+struct property
+{
+    EdsDataType type = kEdsDataType_Unknown;
+    EdsUInt32 size = 0;
+    std::vector<uint8_t> data;
+
+    static property string(const std::string& value);
+    static property time(std::time_t value);
+
+    template <typename T> static property value(EdsDataType type, T value)
+    {
+        const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+        return { type, sizeof(T), std::vector<uint8_t>(bytes, bytes + sizeof(T)) };
+    }
+};
+} // namespace simulator
+
+/// Every object handed out by the simulator. Objects that belong to the SDK (the camera list,
+/// cameras and volumes) live until the SDK is terminated; everything else is deleted when its
+/// last reference is released.
+struct __EdsObject
+{
+    std::atomic<EdsUInt32> references { 1 };
+    const bool sdk_owned;
+
+    explicit __EdsObject(bool owned_by_sdk = false)
+        : sdk_owned(owned_by_sdk)
+    {
+    }
+
+    virtual ~__EdsObject() = default;
+
+    __EdsObject(const __EdsObject&) = delete;
+    __EdsObject& operator=(const __EdsObject&) = delete;
+
+    /// The camera that calls on this object go to, if any
+    virtual simulator::camera_object* camera() { return nullptr; }
+
+    virtual EdsError child_count(EdsUInt32& /*count*/) { return EDS_ERR_INVALID_HANDLE; }
+    virtual EdsError child_at(EdsInt32 /*index*/, EdsBaseRef& /*child*/)
+    {
+        return EDS_ERR_INVALID_HANDLE;
+    }
+
+    virtual std::optional<simulator::property> get_property(EdsPropertyID /*id*/)
+    {
+        return std::nullopt;
+    }
+    virtual EdsError set_property(EdsPropertyID /*id*/, const simulator::property& /*value*/)
+    {
+        return EDS_ERR_PROPERTIES_UNAVAILABLE;
+    }
+};
+
+namespace simulator
+{
+typedef std::chrono::steady_clock clock;
+
+/// The file number, date and size of a picture on a card. Everything else about it is derived
+/// from these, so no memory is used for a file until it is asked for.
+struct picture
+{
+    uint32_t number;
+    std::time_t taken;
+    uint64_t size;
+};
+
+class volume_object : public __EdsObject
+{
+public:
+    volume_object(camera_object& camera_ref, const card& card_settings)
+        : __EdsObject(true)
+        , owner(camera_ref)
+        , settings(card_settings)
+    {
+    }
+
+    camera_object* camera() override { return &owner; }
+
+    EdsError child_count(EdsUInt32& count) override;
+    EdsError child_at(EdsInt32 index, EdsBaseRef& child) override;
+
+    EdsVolumeInfo info();
+
+    uint32_t folder_count();
+    uint32_t files_in_folder(uint32_t folder);
+    /// The picture at position in folder, counting the deleted ones
+    picture picture_at(uint32_t folder, uint32_t position);
+    /// The position in folder of the index'th picture that has not been deleted
+    uint32_t position_of(uint32_t folder, uint32_t index);
+    /// Delete the picture. Returns false if it had already been deleted.
+    bool delete_picture(uint32_t folder, const picture& file);
+    std::string file_name(const picture& file) const;
+    uint32_t file_format() const;
+    /// Add a picture to the card, as if the shutter had been pressed. Returns a new reference to
+    /// its directory item.
+    EdsDirectoryItemRef add_picture();
+
+private:
+    camera_object& owner;
+    std::mutex mutex;
+    card settings;
+    /// The sequence numbers (folder * files_per_folder + position) of the deleted pictures
+    std::set<uint64_t> deleted;
+};
+
+/// A folder or file on a card
+class item_object : public __EdsObject
+{
+public:
+    enum class kind_t
+    {
+        dcim,
+        folder,
+        file
+    };
+
+    item_object(volume_object& volume_ref, kind_t item_kind, uint32_t folder_number = 0,
+        picture picture_file = {})
+        : volume(volume_ref)
+        , kind(item_kind)
+        , folder(folder_number)
+        , file(picture_file)
+    {
+    }
+
+    camera_object* camera() override { return volume.camera(); }
+
+    EdsError child_count(EdsUInt32& count) override;
+    EdsError child_at(EdsInt32 index, EdsBaseRef& child) override;
+
+    EdsDirectoryItemInfo info() const;
+
+    volume_object& volume;
+    const kind_t kind;
+    const uint32_t folder;
+    const picture file;
+    /// How much of the file has been downloaded by EdsDownload
+    std::atomic<uint64_t> downloaded { 0 };
+    /// Set by EdsDownloadCancel, for a download stopped part way by a disconnect
+    std::atomic<bool> cancelled { false };
+};
+
+/// Injects the configured faults into the calls made to the cameras
+class fault_injector
+{
+public:
+    void set_faults(const std::vector<fault>& faults, uint64_t seed);
+
+    /// The fault for this call, if there is one. item is the folder or file the call is on.
+    std::optional<fault> next(const char* function, const item_object* item);
+
+    void count_disconnect() { disconnects++; }
+    void count_download(uint64_t bytes) { bytes_downloaded += bytes; }
+    void count_wasted(uint64_t bytes) { bytes_wasted += bytes; }
+
+    fault_statistics statistics() const;
+    void reset_statistics();
+
+private:
+    struct active_fault
+    {
+        fault settings;
+        uint64_t calls = 0;
+        uint64_t injected = 0;
+    };
+
+    /// Checked first, so calls cost nothing extra while there are no faults
+    std::atomic<bool> active { false };
+    std::mutex mutex;
+    std::vector<active_fault> faults;
+    std::mt19937_64 random;
+
+    std::atomic<uint64_t> injected { 0 };
+    std::atomic<uint64_t> disconnects { 0 };
+    std::atomic<uint64_t> bytes_downloaded { 0 };
+    std::atomic<uint64_t> bytes_wasted { 0 };
+};
+
+struct pending_event
+{
+    enum type_t
+    {
+        property_changed,
+        object_changed,
+        state_changed
+    } type;
+    EdsPropertyID property_id;
+    EdsObjectEvent object_event;
+    EdsBaseRef object;
+    EdsStateEvent state_event = 0;
+};
+
+/// A call holding a camera's USB connection. error is set if the call failed, with
+/// mid_transfer_fault holding a fault that happens part way through the call's transfer.
+struct camera_call
+{
+    std::unique_lock<std::mutex> usb;
+    EdsError error = EDS_ERR_OK;
+    std::optional<fault> mid_transfer_fault;
+};
+
+class camera_object : public __EdsObject
+{
+public:
+    camera_object(const simulator::camera& settings, const timing_model& timing);
+
+    camera_object* camera() override { return this; }
+
+    EdsError child_count(EdsUInt32& count) override;
+    EdsError child_at(EdsInt32 index, EdsBaseRef& child) override;
+
+    std::optional<property> get_property(EdsPropertyID id) override;
+    EdsError set_property(EdsPropertyID id, const property& value) override;
+
+    /// Holds the camera's USB connection for a call, after the call's latency. Calls to the same
+    /// camera are made one at a time. Calls fail with EDS_ERR_COMM_DISCONNECTED while the camera
+    /// is disconnected, or with the error of an injected fault.
+    camera_call call(const char* function, const item_object* item = nullptr);
+
+    /// Disconnect the camera, as if its cable had been pulled, for reconnect_after. Call with
+    /// the USB connection held.
+    void disconnect(std::chrono::milliseconds reconnect_after);
+    /// Reconnect the camera if it has been disconnected for long enough. Returns true if it was.
+    bool reconnect_if_due();
+    bool is_disconnected() const { return disconnected; }
+
+    /// Wait until item's download is cancelled, or timeout has passed
+    void wait_for_cancel(const item_object& item, std::chrono::milliseconds timeout);
+    void cancel_download(item_object& item);
+
+    /// Wait until size bytes would have been transferred since started
+    void transfer(clock::time_point started, uint64_t size) const;
+
+    void queue_event(const pending_event& event);
+    /// Call the handlers for the events queued since the last time
+    void dispatch_events();
+
+    const simulator::camera settings;
+    const timing_model& timing;
+    EdsDeviceInfo device_info;
+    std::vector<std::unique_ptr<volume_object>> volumes;
+
+    std::mutex handler_mutex;
+    EdsPropertyEventHandler property_handler = nullptr;
+    EdsVoid* property_context = nullptr;
+    EdsObjectEventHandler object_handler = nullptr;
+    EdsVoid* object_context = nullptr;
+    EdsStateEventHandler state_handler = nullptr;
+    EdsVoid* state_context = nullptr;
+
+    int sessions = 0;
+    clock::time_point next_live_view_frame;
+    uint64_t live_view_frames = 0;
+
+private:
+    std::mutex usb;
+    std::atomic<bool> disconnected { false };
+    clock::time_point reconnect_at;
+    std::mutex cancel_mutex;
+    std::condition_variable download_cancelled;
+    std::mutex property_mutex;
+    std::map<EdsPropertyID, property> properties;
+    std::deque<pending_event> events;
+};
+
+class camera_list_object : public __EdsObject
+{
+public:
+    explicit camera_list_object(const configuration& config);
+
+    EdsError child_count(EdsUInt32& count) override;
+    EdsError child_at(EdsInt32 index, EdsBaseRef& child) override;
+
+    const configuration config;
+    std::vector<std::unique_ptr<camera_object>> cameras;
+};
+
+class stream_object : public __EdsObject
+{
+public:
+    virtual EdsError read(uint64_t size, void* buffer, uint64_t& read_size) = 0;
+    virtual EdsError write(uint64_t size, const void* buffer) = 0;
+    virtual EdsError seek(int64_t offset, EdsSeekOrigin origin) = 0;
+    virtual uint64_t position() = 0;
+    virtual uint64_t length() = 0;
+
+    EdsProgressCallback progress = nullptr;
+    EdsProgressOption progress_option = kEdsProgressOption_NoReport;
+    EdsVoid* progress_context = nullptr;
+
+    /// Report progress to the callback. Returns false if the callback cancelled the operation.
+    bool report_progress(EdsUInt32 percent);
+};
+
+/// A stream in memory, which grows as it is written to
+class memory_stream : public stream_object
+{
+public:
+    EdsError read(uint64_t size, void* buffer, uint64_t& read_size) override;
+    EdsError write(uint64_t size, const void* buffer) override;
+    EdsError seek(int64_t offset, EdsSeekOrigin origin) override;
+    uint64_t position() override { return offset; }
+    uint64_t length() override { return data.size(); }
+
+    std::vector<uint8_t> data;
+
+private:
+    uint64_t offset = 0;
+};
+
+class file_stream : public stream_object
+{
+public:
+    explicit file_stream(std::FILE* opened)
+        : file(opened)
+    {
+    }
+    ~file_stream() override { std::fclose(file); }
+
+    EdsError read(uint64_t size, void* buffer, uint64_t& read_size) override;
+    EdsError write(uint64_t size, const void* buffer) override;
+    EdsError seek(int64_t offset, EdsSeekOrigin origin) override;
+    uint64_t position() override;
+    uint64_t length() override;
+
+private:
+    std::FILE* file;
+};
+
+/// An image read from a stream holding a simulated thumbnail or raw file
+class image_object : public __EdsObject
+{
+public:
+    /// The size developed images come out at
+    static constexpr EdsUInt32 width = 600;
+    static constexpr EdsUInt32 height = 400;
+
+    explicit image_object(stream_object& source);
+
+    std::optional<property> get_property(EdsPropertyID id) override;
+
+    bool is_raw = false;
+    std::optional<std::time_t> taken;
+};
+
+class evf_image_object : public __EdsObject
+{
+public:
+    explicit evf_image_object(stream_object& image_stream)
+        : stream(image_stream)
+    {
+        stream.references++;
+    }
+
+    ~evf_image_object() override { EdsRelease(&stream); }
+
+    stream_object& stream;
+};
+
+/// File contents. Simulated files start with a header that records when the picture was taken,
+/// which the image objects read back (as the SDK reads the EXIF data).
+namespace content
+{
+    /// Fill buffer with the bytes of a raw file from offset
+    void raw_file(const picture& file, uint64_t offset, uint8_t* buffer, std::size_t size);
+    /// A JPEG of size bytes (at least 32), e.g. a thumbnail or a live view frame
+    std::vector<uint8_t> jpeg(std::time_t taken, uint64_t sequence, uint64_t size);
+    /// The date recorded in the start of a simulated file, and whether it is a raw file
+    std::optional<std::time_t> read_date(const uint8_t* data, std::size_t size, bool& is_raw);
+} // namespace content
+
+/// The SDK wide state, created by EdsInitializeSDK
+struct sdk_state
+{
+    std::mutex mutex;
+    int initialised = 0;
+    std::optional<configuration> configured;
+    std::unique_ptr<camera_list_object> camera_list;
+    EdsCameraAddedHandler camera_added_handler = nullptr;
+    EdsVoid* camera_added_context = nullptr;
+    fault_injector faults;
+};
+
+sdk_state& state();
+} // namespace simulator
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <iomanip>
+#include <iostream>
+
+#include "camera_interface.hpp"
+
+/// Times the SDK calls made while it is in scope and prints them to std::cerr when it goes, one
+/// line per SDK function, followed by the heap allocations made (in instrumentation builds) and
+/// the peak memory used. It does nothing if show is false.
+class api_stats_report
+{
+    const bool show;
+
+public:
+    explicit api_stats_report(bool show_stats)
+        : show(show_stats)
+    {
+        if (!show)
+            return;
+
+        // Stats are global, so clear those from earlier commands (e.g. in camerad)
+        reset_api_stats();
+        reset_allocation_stats();
+        set_api_stats_enabled(true);
+    }
+
+    ~api_stats_report()
+    {
+        if (!show)
+            return;
+
+        set_api_stats_enabled(false);
+        print(std::cerr);
+    }
+
+    api_stats_report(const api_stats_report&) = delete;
+    api_stats_report& operator=(const api_stats_report&) = delete;
+
+    static void print(std::ostream& out)
+    {
+        const auto us = [](std::chrono::nanoseconds ns) { return ns.count() / 1000.0; };
+
+        out << '\n'
+            << std::left << std::setw(32) << "SDK call" << std::right << std::setw(10) << "calls"
+            << std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << std::setw(12) << "max us"
+            << std::setw(12) << "total ms" << '\n';
+
+        out << std::fixed << std::setprecision(1);
+        for (const auto& call : get_api_stats())
+        {
+            out << std::left << std::setw(32) << call.function << std::right << std::setw(10)
+                << call.calls << std::setw(12) << us(call.p50) << std::setw(12) << us(call.p99)
+                << std::setw(12) << us(call.max) << std::setw(12) << us(call.total) / 1000.0
+                << '\n';
+        }
+
+        print_allocations(out);
+        out << "\nPeak memory " << static_cast<double>(get_peak_rss()) / (1024.0 * 1024.0)
+            << " MB\n";
+        out.flush();
+    }
+
+    static void print_allocations(std::ostream& out)
+    {
+        const auto scopes = get_allocation_stats();
+        if (scopes.empty())
+            return;
+
+        out << '\n'
+            << std::left << std::setw(32) << "Allocations in" << std::right << std::setw(10)
+            << "count" << std::setw(12) << "KB" << std::setw(12) << "bytes each" << '\n';
+
+        for (const auto& scope : scopes)
+        {
+            const auto bytes = static_cast<double>(scope.bytes);
+            out << std::left << std::setw(32) << scope.scope << std::right << std::setw(10)
+                << scope.allocations << std::setw(12) << bytes / 1024.0 << std::setw(12)
+                << (scope.allocations ? bytes / static_cast<double>(scope.allocations) : 0.0)
+                << '\n';
+        }
+    }
+};
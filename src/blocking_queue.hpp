@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+/// Thread safe queue used to hand work between threads (e.g. from the SDK event thread).
+/// A capacity of 0 means the queue is unbounded; otherwise push blocks while the queue is full.
+template <typename T> class blocking_queue
+{
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<T> items;
+    std::size_t capacity;
+    bool closed = false;
+
+public:
+    explicit blocking_queue(std::size_t max_items = 0)
+        : capacity(max_items)
+    {
+    }
+
+    /// Add an item. Returns false if the queue has been closed.
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this] { return closed || capacity == 0 || items.size() < capacity; });
+        if (closed)
+            return false;
+
+        items.push_back(std::move(item));
+        lock.unlock();
+        not_empty.notify_one();
+        return true;
+    }
+
+    /// Wait for an item. Returns std::nullopt once the queue is closed and empty.
+    std::optional<T> pop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this] { return closed || !items.empty(); });
+        return take(lock);
+    }
+
+    /// Wait up to timeout for an item. Returns std::nullopt on timeout.
+    template <class Rep, class Period>
+    std::optional<T> pop(std::chrono::duration<Rep, Period> timeout)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait_for(lock, timeout, [this] { return closed || !items.empty(); });
+        return take(lock);
+    }
+
+    /// Stop accepting items and wake up any waiting threads
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    std::size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+    }
+
+private:
+    std::optional<T> take(std::unique_lock<std::mutex>& lock)
+    {
+        if (items.empty())
+            return std::nullopt;
+
+        std::optional<T> item(std::move(items.front()));
+        items.pop_front();
+        lock.unlock();
+        not_full.notify_one();
+        return item;
+    }
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class camera_connection;
+
+/// Where a command is run. A command run by camerad shares the daemon's process and its signal
+/// handlers, so nothing it does may wait for a Ctrl-C to end it.
+enum class run_location
+{
+    local,
+    daemon
+};
+
+/// Returned by a command that camerad has to hand back to the client to run, such as one that
+/// runs until it is stopped. The options have been parsed, so abbreviations and combined short
+/// options are recognised just as they are when the command is run locally.
+constexpr int EXIT_RUN_LOCALLY = -1;
+
+/// Run lscamera or cpimage using an existing camera connection (e.g. one held open by camerad).
+/// args[0] is the command name, as it would be in argv.
+int run_lscamera(std::shared_ptr<camera_connection> cameras, const std::vector<std::string>& args,
+    run_location where = run_location::local);
+int run_cpimage(std::shared_ptr<camera_connection> cameras, const std::vector<std::string>& args,
+    run_location where = run_location::local);
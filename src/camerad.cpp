@@ -0,0 +1,238 @@
+//
+//  camerad.cpp
+//  Camera daemon
+//
+//  Keeps the SDK initialised and the camera sessions open, and runs lscamera and cpimage
+//  commands sent to it over a Unix domain socket, so each command only pays for its own work.
+//
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Poco/Logger.h"
+
+#include "camera_interface.hpp"
+#include "camera_tools.hpp"
+#include "daemon_protocol.hpp"
+
+using namespace daemon_protocol;
+
+namespace
+{
+/// How long a client has to send its request before it is dropped, so a client that connects
+/// and sends nothing (or part of a request) does not hold up the clients behind it
+constexpr timeval request_timeout { 5, 0 };
+/// How long the daemon waits for a client to take its output. A client that stops reading loses
+/// the rest of the output, but the command carries on and the daemon serves the next client.
+constexpr timeval output_timeout { 30, 0 };
+
+volatile std::sig_atomic_t stop_requested = 0;
+void request_stop(int) { stop_requested = 1; }
+
+void install_signal_handlers()
+{
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+    // A client that goes away part way through a command must not stop the daemon
+    std::signal(SIGPIPE, SIG_IGN);
+}
+
+int listen_on(const std::string& path)
+{
+    sockaddr_un address {};
+    if (path.empty())
+    {
+        std::cerr << "The camerad folder in /tmp belongs to another user" << std::endl;
+        return -1;
+    }
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "Socket path too long: " << path << std::endl;
+        return -1;
+    }
+
+    address.sun_family = AF_UNIX;
+    std::copy(path.begin(), path.end(), address.sun_path);
+
+    if (const int running = connect_to_daemon(path); running >= 0)
+    {
+        ::close(running);
+        std::cerr << "camerad is already running on " << path << std::endl;
+        return -1;
+    }
+
+    // Remove the socket left by a daemon that was not stopped cleanly
+    ::unlink(path.c_str());
+
+    // The socket is created readable only by this user, so there is no time when another user
+    // can connect to it
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    const auto previous_umask = ::umask(S_IRWXG | S_IRWXO | S_IXUSR);
+    const bool bound
+        = fd >= 0 && ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    ::umask(previous_umask);
+
+    if (!bound || ::listen(fd, 16) != 0)
+    {
+        std::cerr << "Failed to listen on " << path << ": " << std::strerror(errno) << std::endl;
+        if (fd >= 0)
+            ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/// Run the command with std::cout and std::cerr sent back to the client
+int run_command(int client, std::shared_ptr<camera_connection>& cameras,
+    const std::vector<std::string>& args)
+{
+    const auto tool = std::filesystem::path(args.front()).filename().string();
+
+    frame_streambuf output(client, frame_type::output);
+    frame_streambuf error(client, frame_type::error);
+    auto* const cout_buffer = std::cout.rdbuf(&output);
+    auto* const cerr_buffer = std::cerr.rdbuf(&error);
+
+    int exit_code = EXIT_FAILURE;
+    try
+    {
+        // Pick up cameras that have been connected or disconnected since the last command
+        cameras->refresh();
+
+        if (tool == "lscamera")
+            exit_code = run_lscamera(cameras, args, run_location::daemon);
+        else if (tool == "cpimage")
+            exit_code = run_cpimage(cameras, args, run_location::daemon);
+        else
+            std::cerr << "camerad can not run " << tool << std::endl;
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << tool << " failed: " << ex.what() << std::endl;
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    std::cout.rdbuf(cout_buffer);
+    std::cerr.rdbuf(cerr_buffer);
+
+    return exit_code;
+}
+
+void handle_client(int client, std::shared_ptr<camera_connection>& cameras)
+{
+    frame_type type;
+    std::string data;
+    if (!read_frame(client, type, data, max_request_size) || type != frame_type::request)
+    {
+        Poco::Logger::get("camerad").warning("Dropped a client that did not send a request");
+        return;
+    }
+
+    // The request holds the client's working directory followed by its argv
+    auto args = decode_strings(data);
+    if (args.size() < 2)
+        return;
+
+    const auto daemon_directory = std::filesystem::current_path();
+    const std::string client_directory = args.front();
+    args.erase(args.begin());
+
+    Poco::Logger::get("camerad").information("Running %s in %s", args.front(), client_directory);
+
+    int exit_code = EXIT_FAILURE;
+    std::error_code ec;
+    std::filesystem::current_path(client_directory, ec);
+    if (ec)
+    {
+        const auto message = "camerad can not use the directory " + client_directory + "\n";
+        write_frame(client, frame_type::error, message.data(), message.size());
+    }
+    else
+    {
+        exit_code = run_command(client, cameras, args);
+        std::filesystem::current_path(daemon_directory, ec);
+    }
+
+    // A command may have installed its own signal handlers
+    install_signal_handlers();
+
+    if (exit_code == EXIT_RUN_LOCALLY)
+    {
+        write_frame(client, frame_type::run_locally, nullptr, 0);
+        return;
+    }
+
+    const auto code = std::to_string(exit_code);
+    write_frame(client, frame_type::exit_code, code.data(), code.size());
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::string path = (argc > 1) ? argv[1] : default_socket_path();
+
+    install_signal_handlers();
+
+    std::shared_ptr<camera_connection> cameras = get_camera_connection();
+    cameras->set_keep_sessions_open(true);
+
+    const int server = listen_on(path);
+    if (server < 0)
+        return EXIT_FAILURE;
+
+    std::cout << "camerad listening on " << path << " (Ctrl-C to stop)" << std::endl;
+
+    // Commands are run one at a time, which also keeps the SDK calls from different commands apart
+    while (!stop_requested)
+    {
+        pollfd waiting { server, POLLIN, 0 };
+        if (::poll(&waiting, 1, 250) <= 0)
+            continue;
+
+        const int client = ::accept(server, nullptr, nullptr);
+        if (client < 0)
+            continue;
+
+        if (!is_same_user(client))
+        {
+            Poco::Logger::get("camerad").warning("Refused a connection from another user");
+            ::close(client);
+            continue;
+        }
+
+        ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &request_timeout, sizeof(request_timeout));
+        ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &output_timeout, sizeof(output_timeout));
+
+        // Whatever goes wrong with one client, the daemon carries on for the next
+        try
+        {
+            handle_client(client, cameras);
+        }
+        catch (const std::exception& ex)
+        {
+            Poco::Logger::get("camerad").error(
+                "Failed to handle a client: %s", std::string(ex.what()));
+        }
+        ::close(client);
+    }
+
+    ::close(server);
+    ::unlink(path.c_str());
+
+    return EXIT_SUCCESS;
+}
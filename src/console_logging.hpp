@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Poco/AsyncChannel.h"
+#include "Poco/AutoPtr.h"
+#include "Poco/ConsoleChannel.h"
+#include "Poco/Logger.h"
+#include "Poco/Util/AbstractConfiguration.h"
+
+/// Writes log messages to the console from a background thread while it is in scope, so a slow
+/// terminal cannot stall a transfer thread that logs. Logging set up in the configuration files
+/// (logging.*) is left as it is.
+class console_logging
+{
+    Poco::AutoPtr<Poco::ConsoleChannel> console;
+    Poco::AutoPtr<Poco::AsyncChannel> async;
+
+public:
+    explicit console_logging(const Poco::Util::AbstractConfiguration& config)
+        : console(new Poco::ConsoleChannel)
+        , async(new Poco::AsyncChannel(console.get()))
+    {
+        Poco::Util::AbstractConfiguration::Keys configured;
+        config.keys("logging", configured);
+        if (configured.empty())
+            Poco::Logger::setChannel("", async.get());
+        else
+            async.reset();
+    }
+
+    /// Write the queued messages, and the messages logged after this, straight to the console
+    ~console_logging()
+    {
+        if (async.isNull())
+            return;
+
+        Poco::Logger::setChannel("", console.get());
+        async->close();
+    }
+
+    console_logging(const console_logging&) = delete;
+    console_logging& operator=(const console_logging&) = delete;
+};
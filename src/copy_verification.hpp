@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/// The size of a file and a 64 bit FNV-1a hash of its contents
+struct file_digest
+{
+    uint64_t size = 0;
+    uint64_t hash = 14695981039346656037ull;
+
+    /// Add the next count bytes of the file
+    void add(const unsigned char* data, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i++)
+            hash = (hash ^ data[i]) * 1099511628211ull;
+        size += count;
+    }
+
+    bool operator==(const file_digest& other) const
+    {
+        return size == other.size && hash == other.hash;
+    }
+    bool operator!=(const file_digest& other) const { return !(*this == other); }
+};
+
+/// Read all of path, passing each block read to consume, and return how many bytes were read.
+/// With flush, the file is first written to disk and dropped from the cache where the platform
+/// allows, so what is read is what was stored rather than what is still in memory. Returns
+/// nothing if the file can not be read.
+template <typename Consume>
+inline std::optional<uint64_t> read_file(
+    const std::filesystem::path& path, bool flush, Consume consume)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return std::nullopt;
+
+    if (flush)
+    {
+        if (::fsync(fd) != 0)
+        {
+            ::close(fd);
+            return std::nullopt;
+        }
+#if defined __linux__
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#elif defined __APPLE__
+        ::fcntl(fd, F_NOCACHE, 1);
+#endif
+    }
+
+    uint64_t size = 0;
+    std::vector<unsigned char> buffer(1024 * 1024);
+    for (;;)
+    {
+        const auto read_size = ::read(fd, buffer.data(), buffer.size());
+        if (read_size < 0 && errno == EINTR)
+            continue;
+        if (read_size < 0)
+        {
+            ::close(fd);
+            return std::nullopt;
+        }
+        if (read_size == 0)
+            break;
+
+        consume(buffer.data(), static_cast<std::size_t>(read_size));
+        size += static_cast<uint64_t>(read_size);
+    }
+
+    ::close(fd);
+    return size;
+}
+
+/// Read path and work out its digest, as read_file() does
+inline std::optional<file_digest> digest_file(const std::filesystem::path& path, bool flush)
+{
+    file_digest digest;
+    const auto read = read_file(path, flush,
+        [&digest](const unsigned char* data, std::size_t size) { digest.add(data, size); });
+    if (!read)
+        return std::nullopt;
+
+    return digest;
+}
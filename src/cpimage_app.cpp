@@ -0,0 +1,1163 @@
+//
+//  cpimage_app.cpp
+//  List Cameras
+//
+//  Created by Rob McKay on 08/01/2021.
+//
+
+#define __STDC_WANT_LIB_EXT1__ 1
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "Poco/AutoPtr.h"
+#include "Poco/Exception.h"
+#include "Poco/Util/Application.h"
+#include "Poco/Util/HelpFormatter.h"
+#include "Poco/Util/IntValidator.h"
+#include "Poco/Util/Option.h"
+#include "Poco/Util/RegExpValidator.h"
+
+#include "LSCameraConfig.h"
+
+#include <iomanip>
+#include <iostream>
+
+#include <filesystem>
+
+using namespace Poco::Util;
+
+#include "api_stats_report.hpp"
+#include "blocking_queue.hpp"
+#include "camera_interface.hpp"
+#include "camera_tools.hpp"
+#include "console_logging.hpp"
+#include "copy_verification.hpp"
+#include "raw_developer.hpp"
+#include "throughput_model.hpp"
+#include "thumbnail_cache.hpp"
+#include "trace_file.hpp"
+#include "wildcards.hpp"
+
+constexpr int DEFAULT_CAMERA_NUMBER = 0;
+constexpr int DEFAULT_VOLUME_NUMBER = 0;
+/// Files copied at once from a card reader
+constexpr unsigned DEFAULT_COPY_THREADS = 4;
+/// Pause between files, which gives the camera time to settle
+constexpr std::chrono::milliseconds PAUSE_BETWEEN_FILES(100);
+/// How many times a download is tried while the camera says it is busy
+constexpr int BUSY_DOWNLOAD_ATTEMPTS = 5;
+
+namespace
+{
+
+class cpimage_app : public Poco::Util::Application
+{
+    typedef std::chrono::steady_clock clock;
+
+    bool help_requested = false;
+    std::shared_ptr<camera_connection> cameras;
+    blocking_queue<clock::time_point> camera_added;
+    int listeners = 0;
+    std::unique_ptr<raw_developer> developer;
+    std::unique_ptr<console_logging> console;
+
+    const run_location where;
+
+    /// Set by Ctrl-C. Signal handlers can only set a static flag, so it is cleared as each
+    /// command starts rather than carrying a stop over to the next command.
+    static volatile std::sig_atomic_t stop_requested;
+    static void request_stop(int) { stop_requested = 1; }
+
+public:
+    cpimage_app(std::shared_ptr<camera_connection> connection, run_location location)
+        : cameras(std::move(connection))
+        , where(location)
+    {
+    }
+
+    void defineOptions(OptionSet& options) override
+    {
+        Application::defineOptions(options);
+        options.addOption(Option("help", "h", "Display help information")
+                              .required(false)
+                              .repeatable(false)
+                              .callback(OptionCallback<cpimage_app>(this, &cpimage_app::handle_help)));
+
+        const int count = cameras->number_of_cameras();
+
+        options.addOption(Option("camera", "c", "Choose camera (0..n-1) defaults to 0")
+                              .required(false)
+                              .argument("camera")
+                              .validator(new IntValidator(0, count))
+                              .binding("camera_number"));
+
+        options.addOption(Option("volume", "v", "Choose volume (0..n-1) defaults to 0")
+                              .required(false)
+                              .argument("volume")
+                              .validator(new IntValidator(0, count))
+                              .binding("volume_number"));
+
+        options.addOption(Option(
+            "folder", "f", "Folder to search. Defaults to current folder from the camera info")
+                              .required(false)
+                              .argument("folder")
+                              .validator(new IntValidator(0, count))
+                              .binding("folder_name"));
+
+        options.addOption(
+            Option("no-date-folders", "nd", "Do not put downloaded file into date folders")
+                .required(false)
+                .binding("no_date_folders"));
+
+        options.addOption(Option("wait", "w",
+            "Keep running and download the matching files from each camera as it is connected")
+                              .required(false)
+                              .binding("wait_for_cameras"));
+
+        options.addOption(Option("tether", "t",
+            "Tethered shooting: download each new picture from the camera as soon as it is taken")
+                              .required(false)
+                              .binding("tether"));
+
+        options.addOption(Option("plan", "n",
+            "Dry run: list the files that would be copied, where they would go, the folders that "
+            "would be created and any name collisions, with an estimate of how long it would take")
+                              .required(false)
+                              .binding("plan"));
+
+        options.addOption(Option("thumbnails", "T",
+            "Save the thumbnails of the matching files in <folder> as JPEG files instead of "
+            "copying the files. Thumbnails are cached, so browsing the same card again is quick")
+                              .required(false)
+                              .argument("folder")
+                              .binding("thumbnail_folder"));
+
+        options.addOption(Option("develop", "D",
+            "Develop the raw files that are copied to jpeg, tiff (8 bit) or tiff16 files next to "
+            "them. This is done on separate threads so it does not slow down copying")
+                              .required(false)
+                              .argument("format")
+                              .validator(new RegExpValidator("^(jpeg|tiff|tiff16)$"))
+                              .binding("develop_format"));
+
+        options.addOption(Option("develop-threads", "j",
+            "Number of threads developing raw files. Defaults to half the number of cores")
+                              .required(false)
+                              .argument("threads")
+                              .validator(new IntValidator(1, 64))
+                              .binding("develop_threads"));
+
+        options.addOption(Option("stats", "s",
+            "Time every call to the Canon SDK and print the number of calls and their p50, p99 "
+            "and max latency for each SDK function at the end, with the peak memory used (and "
+            "the heap allocations made by each part, in instrumentation builds)")
+                              .required(false)
+                              .binding("show_stats"));
+
+        options.addOption(Option("card", "C",
+            "Copy the matching files from the card in a card reader mounted at <path> (the folder "
+            "with DCIM in it) instead of from a camera. The folder defaults to the newest one")
+                              .required(false)
+                              .argument("path")
+                              .binding("card_path"));
+
+        options.addOption(Option("move", "m",
+            "Delete each file from the camera or card once its copy has been checked (its size "
+            "and, from a card reader, its contents). The files are deleted together once the "
+            "copying has finished")
+                              .required(false)
+                              .binding("move_files"));
+
+        options.addOption(Option("copy-threads", "p",
+            "Number of files copied at once from a card reader. Defaults to "
+                + std::to_string(DEFAULT_COPY_THREADS))
+                              .required(false)
+                              .argument("threads")
+                              .validator(new IntValidator(1, 32))
+                              .binding("copy_threads"));
+
+        options.addOption(Option("trace", "R",
+            "Record a timeline of every step and SDK call, on each thread, and write it to <file> "
+            "at the end as Chrome trace event JSON, which can be opened in Perfetto")
+                              .required(false)
+                              .argument("file")
+                              .binding("trace_file"));
+    }
+
+    void initialize(Application& self) override
+    {
+        loadConfiguration(); // load default configuration files
+        Application::initialize(self);
+        console = std::make_unique<console_logging>(config());
+    }
+
+    /// The destination in the date folder for the file, without creating the folder
+    static std::filesystem::path date_folder_name(time_t dt, const std::string& name)
+    {
+        std::tm t;
+        memmove(&t, gmtime(&dt), sizeof(t));
+
+        char buf[100];
+        std::strftime(buf, sizeof(buf), "%Y_%m_%d", &t);
+        std::filesystem::path dir(buf);
+
+        return dir /= name;
+    }
+
+    std::string format_name(time_t dt, std::string name)
+    {
+        const auto path = date_folder_name(dt, name);
+        create_parent_folder(path);
+        return path;
+    }
+
+    static void create_parent_folder(const std::filesystem::path& path)
+    {
+        const auto dir = path.parent_path();
+        if (!dir.empty() && !std::filesystem::exists(dir))
+        {
+            std::filesystem::create_directories(dir);
+        }
+    }
+
+#define STR2(x) #x
+#define STR(x) STR2(x)
+
+    void display_help()
+    {
+        HelpFormatter help_formatter(options());
+        help_formatter.setCommand(commandName());
+        help_formatter.setUsage("OPTIONS <file> [<file> ...]");
+        help_formatter.setHeader("\n" + commandName()
+            + " Version " STR(LSCAMERA_VERSION_MAJOR) "." STR(
+                LSCAMERA_VERSION_MINOR) "\n\nDownload files from a Canon camera connect to the "
+                                        "computer (via USB), or from a card reader");
+        help_formatter.setFooter(
+            "\n<file> can be a standard file wildcard expression.\ne.g. 'IMG_732*' will match "
+            "every file "
+            "starting with 'IMG_732' but 'IMG_732*.CR2' Will match every file starting with "
+            "'IMG_732' and ending with '.CR2'");
+        help_formatter.format(std::cout);
+    }
+
+    void handle_help(const std::string&, const std::string&)
+    {
+        help_requested = true;
+        display_help();
+        stopOptionsProcessing();
+    }
+
+    int main(const std::vector<std::string>& args) override
+    {
+        if (help_requested)
+            return EXIT_USAGE;
+
+        stop_requested = 0;
+        if (where == run_location::daemon && runs_until_stopped())
+            return EXIT_RUN_LOCALLY;
+
+        const api_stats_report stats(config().hasProperty("show_stats"));
+        const trace_file trace(config().getString("trace_file", ""));
+
+        if (config().hasProperty("develop_format"))
+            start_developing();
+
+        return finish_developing(run_command(args));
+    }
+
+    /// Whether the command keeps running until Ctrl-C
+    bool runs_until_stopped() const
+    {
+        return config().hasProperty("wait_for_cameras") || config().hasProperty("tether");
+    }
+
+    int run_command(const std::vector<std::string>& args)
+    {
+        if (config().hasProperty("card_path"))
+            return copy_from_card(args);
+
+        if (config().hasProperty("wait_for_cameras"))
+            return wait_for_cameras(args);
+
+        const int count = cameras->number_of_cameras();
+
+        if (count < 1)
+        {
+            std::cerr << "No cameras found\n";
+            return EXIT_FAILURE;
+        }
+
+        int camera_number = config().getInt("camera_number", DEFAULT_CAMERA_NUMBER);
+
+        if (config().hasProperty("plan"))
+            return plan(cameras->select_camera(camera_number), args);
+
+        if (config().hasProperty("thumbnail_folder"))
+            return export_thumbnails(cameras->select_camera(camera_number), args);
+
+        if (config().hasProperty("tether"))
+            return tether(cameras->select_camera(camera_number));
+
+        auto camera_ref = cameras->select_camera(camera_number);
+        return copy_files(camera_ref, args);
+    }
+
+    void start_developing()
+    {
+        const auto name = config().getString("develop_format");
+        const auto format = (name == "jpeg") ? developed_format::jpeg
+            : (name == "tiff")               ? developed_format::tiff
+                                             : developed_format::tiff16;
+        const unsigned default_threads = std::max(std::thread::hardware_concurrency() / 2, 1u);
+
+        developer = std::make_unique<raw_developer>(
+            format, config().getUInt("develop_threads", default_threads));
+    }
+
+    /// Wait for the raw files still queued to be developed and report how it went
+    int finish_developing(int result)
+    {
+        if (!developer)
+            return result;
+
+        const auto summary = developer->finish();
+        developer.reset();
+
+        std::cout << summary.developed << " raw file(s) developed";
+        if (summary.failed > 0)
+            std::cout << ", " << summary.failed << " failed";
+        std::cout << ", at most " << summary.max_queue_depth << " waiting\n";
+
+        if (!summary.develop_times.empty())
+        {
+            auto times = summary.develop_times;
+            std::sort(times.begin(), times.end());
+            std::cout << "Develop time per file (ms): p50 " << std::fixed << std::setprecision(1)
+                      << times[(times.size() - 1) / 2].count() << ", max "
+                      << times.back().count() << std::endl;
+        }
+
+        return (summary.failed > 0) ? EXIT_FAILURE : result;
+    }
+
+    /// Copy the matching files. If the camera is disconnected part way through wait for it to be
+    /// reconnected (matched on its body ID) and carry on with the files not yet copied.
+    /// camera_ref is replaced with the reconnected camera. camerad does not wait, as nothing
+    /// could stop the wait if the client went away.
+    int copy_files(std::shared_ptr<camera_ref>& camera_ref, const std::vector<std::string>& args)
+    {
+        const auto body_id = camera_ref->get_camera_info()->get_body_ID_ex();
+        copy_progress copied;
+
+        // Keep the throughput model used by --plan up to date
+        const auto record_throughput = [this, &body_id, &copied] {
+            std::cout << copied.names.size() << " file(s) copied\n";
+            try
+            {
+                throughput_model().record(body_id, copied.bytes, copied.transfer_time);
+            }
+            catch (const std::exception& ex)
+            {
+                logger().warning("Failed to save the throughput model: %s", std::string(ex.what()));
+            }
+        };
+
+        for (;;)
+        {
+            try
+            {
+                const int result = copy_matching_files(camera_ref, args, copied);
+                record_throughput();
+                return result;
+            }
+            catch (const camera_disconnected_exception&)
+            {
+                if (where == run_location::daemon)
+                {
+                    std::cerr << "Camera disconnected after " << copied.names.size()
+                              << " file(s)" << std::endl;
+                    record_throughput();
+                    return EXIT_FAILURE;
+                }
+
+                std::cerr << "Camera disconnected after " << copied.names.size()
+                          << " file(s). Waiting for it to be reconnected (Ctrl-C to stop)"
+                          << std::endl;
+            }
+
+            cameras->deselect_camera(camera_ref);
+            {
+                const trace_span span("pipeline", "wait for camera");
+                camera_ref = wait_for_camera(body_id);
+            }
+
+            if (!camera_ref)
+            {
+                record_throughput();
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    struct copy_progress
+    {
+        std::set<std::string> names;
+        /// With --move, the files whose copies have been checked and that can be deleted
+        std::set<std::string> verified;
+        uint64_t bytes = 0;
+        std::chrono::duration<double> transfer_time { 0 };
+    };
+
+    struct planned_copy
+    {
+        std::shared_ptr<directory_ref> file;
+        std::string destination;
+        std::time_t timestamp;
+    };
+
+    /// The folder on the camera to search for files
+    std::string folder_to_search(std::shared_ptr<camera_ref> camera_ref)
+    {
+        auto camera_info = camera_ref->get_camera_info(); // link to camera is held open as long as
+                                                          // the camera_info object is alive
+
+        return config().getString("folder_name", camera_info->get_current_folder());
+    }
+
+    /// Find the files matching any of the file patterns in args
+    std::vector<std::shared_ptr<directory_ref>> find_files(
+        std::shared_ptr<camera_ref> camera_ref, const std::vector<std::string>& args)
+    {
+        int volume_number = config().getInt("volume_number", DEFAULT_VOLUME_NUMBER);
+        const auto folder_name = folder_to_search(camera_ref);
+
+        return find_files(camera_ref->select_volume(volume_number), folder_name, args);
+    }
+
+    static std::vector<std::shared_ptr<directory_ref>> find_files(std::shared_ptr<volume_ref> vol,
+        const std::string& folder_name, const std::vector<std::string>& args)
+    {
+        const trace_span span("pipeline", "find files", folder_name);
+
+        std::vector<std::shared_ptr<directory_ref>> files;
+        for (const auto& file_pattern : args)
+        {
+            auto matching_files = vol->find_matching_files(
+                folder_name, convert_file_wildcards_to_regex(file_pattern));
+            files.insert(files.end(), matching_files.begin(), matching_files.end());
+        }
+
+        return files;
+    }
+
+    /// Find the files matching args and where each one will be copied to, without copying anything
+    std::vector<planned_copy> plan_copies(
+        std::shared_ptr<camera_ref> camera_ref, const std::vector<std::string>& args)
+    {
+        return plan_copies(find_files(camera_ref, args));
+    }
+
+    /// Where each of files will be copied to
+    std::vector<planned_copy> plan_copies(const std::vector<std::shared_ptr<directory_ref>>& files)
+    {
+        const bool no_date_folders = config().hasProperty("no_date_folders");
+
+        std::vector<planned_copy> copies;
+        for (const auto& file : files)
+        {
+            const trace_span span("pipeline", "timestamp", file->get_name());
+            const auto timestamp = file->get_timestamp();
+            auto name = (no_date_folders) ? file->get_name()
+                                          : date_folder_name(timestamp, file->get_name()).string();
+            copies.push_back({ file, name, timestamp });
+        }
+
+        return copies;
+    }
+
+    /// Save the thumbnails of the matching files as JPEG files in the thumbnail folder. The
+    /// thumbnails are downloaded on this thread while another thread writes them to the cache and
+    /// the thumbnail folder. Thumbnails that are already in the cache are not downloaded again.
+    int export_thumbnails(
+        std::shared_ptr<camera_ref> camera_ref, const std::vector<std::string>& args)
+    {
+        struct downloaded_thumbnail
+        {
+            std::string name;
+            uint64_t size;
+            std::vector<uint8_t> jpeg;
+        };
+
+        const std::filesystem::path output_folder = config().getString("thumbnail_folder");
+        const auto body_id = camera_ref->get_camera_info()->get_body_ID_ex();
+        const auto folder_name = folder_to_search(camera_ref);
+        const thumbnail_cache cache;
+
+        std::vector<std::shared_ptr<directory_ref>> files;
+        try
+        {
+            files = find_files(camera_ref, args);
+        }
+        catch (const eds_exception& ex)
+        {
+            std::cerr << "Failed to find files. Error " << ex.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::filesystem::create_directories(output_folder);
+        const auto output_name = [&output_folder](const std::string& name) {
+            return output_folder / (name + ".jpg");
+        };
+
+        std::atomic<bool> write_failed { false };
+        blocking_queue<downloaded_thumbnail> to_write(16);
+        std::thread writer([&] {
+            set_trace_thread_name("thumbnail writer");
+            while (auto thumbnail = to_write.pop())
+            {
+                const trace_span span("pipeline", "write thumbnail", thumbnail->name);
+                try
+                {
+                    const auto cached = cache.store(
+                        body_id, folder_name, thumbnail->name, thumbnail->size, thumbnail->jpeg);
+                    std::filesystem::copy_file(cached, output_name(thumbnail->name),
+                        std::filesystem::copy_options::overwrite_existing);
+                }
+                catch (const std::exception& ex)
+                {
+                    std::cerr << "Failed to save the thumbnail of " << thumbnail->name << ". Error "
+                              << ex.what() << std::endl;
+                    write_failed = true;
+                }
+            }
+        });
+
+        int cached = 0;
+        int downloaded = 0;
+        int result = EXIT_OK;
+        for (const auto& file : files)
+        {
+            const auto name = file->get_name();
+            const auto size = file->get_file_size();
+
+            try
+            {
+                if (const auto cached_thumbnail = cache.find(body_id, folder_name, name, size))
+                {
+                    std::filesystem::copy_file(*cached_thumbnail, output_name(name),
+                        std::filesystem::copy_options::overwrite_existing);
+                    cached++;
+                }
+                else
+                {
+                    const trace_span span("pipeline", "download thumbnail", name);
+                    to_write.push({ name, size, file->download_thumbnail() });
+                    downloaded++;
+                }
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Failed to get the thumbnail of " << name << ". Error " << ex.what()
+                          << std::endl;
+                result = EXIT_FAILURE;
+            }
+        }
+
+        to_write.close();
+        writer.join();
+
+        std::cout << (cached + downloaded) << " thumbnail(s) saved in " << output_folder.string()
+                  << " (" << downloaded << " downloaded, " << cached << " from the cache)"
+                  << std::endl;
+
+        return write_failed ? EXIT_FAILURE : result;
+    }
+
+    /// Show what copy_files would do, with an estimate of the time it would take
+    int plan(std::shared_ptr<camera_ref> camera_ref, const std::vector<std::string>& args)
+    {
+        const auto body_id = camera_ref->get_camera_info()->get_body_ID_ex();
+
+        std::vector<planned_copy> copies;
+        try
+        {
+            copies = plan_copies(camera_ref, args);
+        }
+        catch (const eds_exception& ex)
+        {
+            std::cerr << "Failed to find files. Error " << ex.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        uint64_t total_bytes = 0;
+        std::set<std::string> new_folders;
+        std::map<std::string, int> destinations;
+        std::set<uint32_t> groups;
+
+        std::cout << std::fixed << std::setprecision(1);
+        for (const auto& copy : copies)
+        {
+            const auto size = copy.file->get_file_size();
+            total_bytes += size;
+            destinations[copy.destination]++;
+            if (const auto group = copy.file->get_group_ID(); group != 0)
+                groups.insert(group);
+
+            const auto dir = std::filesystem::path(copy.destination).parent_path();
+            if (!dir.empty() && !std::filesystem::exists(dir))
+                new_folders.insert(dir.string());
+
+            std::cout << copy.file->get_name() << " (" << size / (1024.0 * 1024.0) << " MB) -> "
+                      << copy.destination << '\n';
+        }
+
+        std::cout << '\n'
+                  << copies.size() << " file(s), " << total_bytes / (1024.0 * 1024.0) << " MB";
+        if (!groups.empty())
+            std::cout << " in " << groups.size() << " group(s)";
+        std::cout << '\n';
+
+        for (const auto& folder : new_folders)
+            std::cout << "New folder " << folder << '\n';
+
+        for (const auto& [destination, count] : destinations)
+        {
+            if (count > 1)
+                std::cout << "Collision: " << count << " files would be copied to " << destination
+                          << '\n';
+            else if (std::filesystem::exists(destination))
+                std::cout << "Collision: " << destination << " already exists and would be replaced\n";
+        }
+
+        const throughput_model model;
+        if (const auto estimate
+            = model.estimate(body_id, total_bytes, copies.size(), PAUSE_BETWEEN_FILES))
+        {
+            std::cout << "Estimated time " << estimate->count() << " s at "
+                      << *model.bytes_per_second(body_id) / (1024.0 * 1024.0) << " MB/s"
+                      << std::endl;
+        }
+        else
+        {
+            std::cout << "No throughput recorded for this camera yet, so no time estimate"
+                      << std::endl;
+        }
+
+        return EXIT_OK;
+    }
+
+    /// Whether the copy of file at destination can replace it, so that file can be deleted. The
+    /// copy is read back from disk and must be the size of file and have the same contents as
+    /// original, i.e. what was received from the camera or read from the card.
+    static bool verify_copy(const directory_ref& file, const std::filesystem::path& destination,
+        const std::optional<file_digest>& original)
+    {
+        const trace_span span("pipeline", "verify", file.get_name());
+        if (!original || original->size != file.get_file_size())
+            return false;
+
+        const auto copy = digest_file(destination, true);
+        return copy && *copy == *original;
+    }
+
+    /// Delete the files in copies whose copies have been verified. This is done after the
+    /// copying, so deleting never holds up a download. Returns false if any could not be deleted.
+    static bool delete_verified(
+        const std::vector<planned_copy>& copies, std::set<std::string>& verified)
+    {
+        bool deleted_all = true;
+        std::size_t deleted = 0;
+        for (const auto& copy : copies)
+        {
+            const auto name = copy.file->get_name();
+            if (verified.count(name) == 0)
+                continue;
+
+            try
+            {
+                const trace_span span("pipeline", "delete", name);
+                copy.file->delete_file();
+                verified.erase(name);
+                deleted++;
+            }
+            catch (const camera_disconnected_exception&)
+            {
+                throw;
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Failed to delete file " << name << ". Error " << ex.what()
+                          << std::endl;
+                deleted_all = false;
+            }
+        }
+
+        std::cout << deleted << " file(s) deleted" << std::endl;
+        return deleted_all;
+    }
+
+    /// Download file to name, trying again while the camera is busy (e.g. writing a picture).
+    /// With received, the bytes are hashed as they arrive from the camera.
+    static eds_result<void> download_file(
+        const directory_ref& file, const std::string& name, file_digest* received = nullptr)
+    {
+        const trace_span span("pipeline", "download", file.get_name());
+        const auto download = [&file, &name, received] {
+            if (!received)
+                return file.try_download_to(name);
+
+            *received = {};
+            return file.try_download_observed(name,
+                [received](const uint8_t* data, std::size_t size) { received->add(data, size); });
+        };
+
+        auto downloaded = download();
+        for (int attempt = 1; attempt < BUSY_DOWNLOAD_ATTEMPTS && !downloaded
+             && downloaded.error().is_busy();
+             attempt++)
+        {
+            std::this_thread::sleep_for(PAUSE_BETWEEN_FILES * attempt);
+            downloaded = download();
+        }
+
+        return downloaded;
+    }
+
+    /// Copy the files matching args that are not already in copied, adding each one as it is
+    /// copied, then with --move delete the ones that have been verified. Throws
+    /// camera_disconnected_exception if the camera goes away.
+    int copy_matching_files(std::shared_ptr<camera_ref> camera_ref,
+        const std::vector<std::string>& args, copy_progress& copied)
+    {
+        const bool move_files = config().hasProperty("move_files");
+        try
+        {
+            int result = EXIT_OK;
+            const auto copies = plan_copies(camera_ref, args);
+            for (const auto& copy : copies)
+            {
+                const auto& file = copy.file;
+                if (copied.names.count(file->get_name()) != 0)
+                    continue;
+
+                const auto& name = copy.destination;
+                create_parent_folder(name);
+
+                std::cout << "Copying file " << file->get_name() << " to " << name << std::endl;
+                const auto started = clock::now();
+                file_digest received;
+                auto downloaded = download_file(*file, name, move_files ? &received : nullptr);
+                if (!downloaded)
+                {
+                    const auto& error = downloaded.error();
+                    std::cerr << "Failed to copy file " << file->get_name() << " to " << name
+                              << ". Error " << error.message << " (0x" << std::hex
+                              << std::uppercase << error.code << std::dec << ")" << std::endl;
+                    std::filesystem::remove(name);
+
+                    // copy_files waits for the camera to come back
+                    if (error.is_disconnected())
+                        throw_eds_error(error);
+                    result = EXIT_FAILURE;
+                    break;
+                }
+                copied.transfer_time += clock::now() - started;
+                copied.bytes += file->get_file_size();
+
+                auto ft = std::filesystem::file_time_type::clock::from_time_t(copy.timestamp);
+                std::filesystem::last_write_time(name, ft);
+                copied.names.insert(file->get_name());
+                if (move_files && verify_copy(*file, name, received))
+                    copied.verified.insert(file->get_name());
+                else if (move_files)
+                    std::cerr << "Not deleting " << file->get_name() << ", the copy in " << name
+                              << " does not match it" << std::endl;
+                if (developer)
+                    developer->add(name);
+
+                const trace_span span("pipeline", "pause");
+                std::this_thread::sleep_for(PAUSE_BETWEEN_FILES);
+            }
+
+            // Files copied before a disconnect are deleted now, as they are still in copied
+            if (move_files && !delete_verified(copies, copied.verified))
+                result = EXIT_FAILURE;
+            return result;
+        }
+        catch (const camera_disconnected_exception&)
+        {
+            // copy_files waits for the camera to come back, whatever was being done when it went
+            throw;
+        }
+        catch (const eds_exception& ex)
+        {
+            std::cerr << "Failed to copy files: " << ex.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    /// The last image folder on the card (e.g. 102CANON), which is the one the camera saves to
+    static std::string newest_image_folder(volume_ref& volume)
+    {
+        const auto is_image_folder = [](const std::shared_ptr<directory_ref>& dir) {
+            const auto name = dir->get_name();
+            return dir->is_a_folder() && name.size() > 3
+                && std::all_of(name.begin(), name.begin() + 3,
+                    [](unsigned char c) { return std::isdigit(c) != 0; });
+        };
+
+        for (volume_ref::size_type i = 0; i < volume.get_directory_count(); i++)
+        {
+            auto dcim = volume.select_directory(i);
+            if (!dcim->is_a_folder() || dcim->get_name() != "DCIM")
+                continue;
+
+            for (auto n = dcim->get_directory_count(); n > 0; n--)
+            {
+                auto folder = dcim->get_directory_entry(n - 1);
+                if (is_image_folder(folder))
+                    return folder->get_name();
+            }
+        }
+
+        throw std::runtime_error("No image folders in DCIM");
+    }
+
+    /// Copy the matching files from a card in a card reader. Card readers are much faster than
+    /// the camera's USB connection, so several files are read at once to keep the reader busy,
+    /// and there is no pause between files.
+    int copy_from_card(const std::vector<std::string>& args)
+    {
+        const auto mount_point = config().getString("card_path");
+        const bool move_files = config().hasProperty("move_files");
+
+        std::vector<planned_copy> copies;
+        std::filesystem::path source_folder;
+        try
+        {
+            auto volume = open_mounted_volume(mount_point);
+            const auto folder_name
+                = config().getString("folder_name", newest_image_folder(*volume));
+            copies = plan_copies(find_files(volume, folder_name, args));
+            source_folder = std::filesystem::path(mount_point) / "DCIM" / folder_name;
+        }
+        catch (const std::exception& ex)
+        {
+            std::cerr << "Failed to find files on " << mount_point << ". Error " << ex.what()
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // Create the date folders first, so the copying threads only write files
+        for (const auto& copy : copies)
+            create_parent_folder(copy.destination);
+
+        std::mutex output_mutex;
+        std::atomic<std::size_t> next { 0 };
+        std::atomic<std::size_t> copied { 0 };
+        std::atomic<uint64_t> bytes { 0 };
+        std::atomic<bool> failed { false };
+        std::set<std::string> verified;
+
+        const auto copy_next_files = [&] {
+            for (auto i = next++; i < copies.size(); i = next++)
+            {
+                const auto& copy = copies[i];
+                const auto name = copy.file->get_name();
+                try
+                {
+                    const trace_span span("pipeline", "copy", name);
+                    copy.file->download_to(copy.destination);
+                    auto ft = std::filesystem::file_time_type::clock::from_time_t(copy.timestamp);
+                    std::filesystem::last_write_time(copy.destination, ft);
+                }
+                catch (const std::exception& ex)
+                {
+                    std::error_code ignored;
+                    std::filesystem::remove(copy.destination, ignored);
+
+                    const std::lock_guard<std::mutex> lock(output_mutex);
+                    std::cerr << "Failed to copy file " << name << " to " << copy.destination
+                              << ". Error " << ex.what() << std::endl;
+                    failed = true;
+                    continue;
+                }
+
+                copied++;
+                bytes += copy.file->get_file_size();
+                const bool can_delete = move_files
+                    && verify_copy(*copy.file, copy.destination,
+                        digest_file(source_folder / name, false));
+
+                const std::lock_guard<std::mutex> lock(output_mutex);
+                std::cout << "Copied file " << name << " to " << copy.destination << std::endl;
+                if (can_delete)
+                    verified.insert(name);
+                else if (move_files)
+                    std::cerr << "Not deleting " << name << ", the copy in " << copy.destination
+                              << " does not match it" << std::endl;
+                if (developer)
+                    developer->add(copy.destination);
+            }
+        };
+
+        const auto started = clock::now();
+        const auto threads = std::min<std::size_t>(
+            config().getUInt("copy_threads", DEFAULT_COPY_THREADS), copies.size());
+        std::vector<std::thread> workers;
+        for (std::size_t t = 1; t < threads; t++)
+        {
+            workers.emplace_back([&copy_next_files, t] {
+                set_trace_thread_name("copy " + std::to_string(t));
+                copy_next_files();
+            });
+        }
+        copy_next_files();
+        for (auto& worker : workers)
+            worker.join();
+
+        const std::chrono::duration<double> elapsed = clock::now() - started;
+        const auto megabytes = static_cast<double>(bytes) / (1024.0 * 1024.0);
+        std::cout << copied << " file(s) copied, " << std::fixed << std::setprecision(1)
+                  << megabytes << " MB";
+        if (elapsed.count() > 0)
+            std::cout << " at " << megabytes / elapsed.count() << " MB/s";
+        std::cout << std::endl;
+
+        if (move_files && !delete_verified(copies, verified))
+            failed = true;
+
+        return failed ? EXIT_FAILURE : EXIT_OK;
+    }
+
+    /// Queues camera added events, and stops cleanly on Ctrl-C, while it is alive. The handler
+    /// refers to the app but the connection can outlive it (camerad keeps one open for every
+    /// command), so the handler is cleared however the wait ends. Waits can be nested, as when
+    /// wait_for_cameras copies from a camera that is then disconnected.
+    class camera_listener
+    {
+        cpimage_app& app;
+
+    public:
+        explicit camera_listener(cpimage_app& owner)
+            : app(owner)
+        {
+            if (app.listeners++ > 0)
+                return;
+
+            app.cameras->set_camera_added_handler(
+                [&owner] { owner.camera_added.push(clock::now()); });
+
+            std::signal(SIGINT, request_stop);
+            std::signal(SIGTERM, request_stop);
+        }
+
+        ~camera_listener()
+        {
+            if (--app.listeners == 0)
+                app.cameras->set_camera_added_handler(nullptr);
+        }
+
+        camera_listener(const camera_listener&) = delete;
+        camera_listener& operator=(const camera_listener&) = delete;
+    };
+
+    /// Wait for the camera with the given body ID to be connected. Returns nullptr if stopped.
+    std::shared_ptr<camera_ref> wait_for_camera(const std::string& body_id)
+    {
+        const camera_listener listening(*this);
+
+        while (!stop_requested)
+        {
+            if (!camera_added.pop(std::chrono::milliseconds(250)))
+                continue;
+
+            cameras->refresh();
+
+            const int count = cameras->number_of_cameras();
+            for (int camera_number = 0; camera_number < count; camera_number++)
+            {
+                auto camera_ref = cameras->select_camera(camera_number);
+                if (camera_ref->get_camera_info()->get_body_ID_ex() == body_id)
+                {
+                    std::cout << "Camera reconnected, resuming" << std::endl;
+                    return camera_ref;
+                }
+
+                cameras->deselect_camera(camera_ref);
+            }
+        }
+
+        return nullptr;
+    }
+
+    /// Wait for cameras to be connected and run copy_files for each new camera. Cameras that are
+    /// already connected are processed first.
+    int wait_for_cameras(const std::vector<std::string>& args)
+    {
+        const camera_listener listening(*this);
+
+        std::set<std::string> known_ports;
+        copy_files_from_new_cameras(known_ports, args);
+
+        std::cout << "Waiting for cameras to be connected (Ctrl-C to stop)" << std::endl;
+
+        while (!stop_requested)
+        {
+            // The timeout only limits how long it takes to notice a stop request
+            const auto added_at = camera_added.pop(std::chrono::milliseconds(250));
+            if (!added_at)
+                continue;
+
+            cameras->refresh();
+            logger().debug("Camera list refreshed %s us after the camera added event",
+                std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(
+                    clock::now() - *added_at)
+                                   .count()));
+
+            copy_files_from_new_cameras(known_ports, args);
+        }
+
+        return EXIT_OK;
+    }
+
+    void copy_files_from_new_cameras(
+        std::set<std::string>& known_ports, const std::vector<std::string>& args)
+    {
+        std::set<std::string> current_ports;
+
+        const int count = cameras->number_of_cameras();
+        for (int camera_number = 0; camera_number < count; camera_number++)
+        {
+            const auto port = cameras->get_connection_info(camera_number)->get_port();
+            current_ports.insert(port);
+
+            if (known_ports.count(port) == 0)
+            {
+                std::cout << "Camera connected on port " << port << std::endl;
+
+                auto camera_ref = cameras->select_camera(camera_number);
+                copy_files(camera_ref, args);
+                cameras->deselect_camera(camera_ref);
+            }
+        }
+
+        // Forget cameras that have gone so they are processed again when they are reconnected
+        known_ports = std::move(current_ports);
+    }
+
+    /// Download each file as the camera reports it has been created, until stopped with Ctrl-C
+    int tether(std::shared_ptr<camera_ref> camera_ref)
+    {
+        struct new_file
+        {
+            std::shared_ptr<directory_ref> file;
+            clock::time_point created_at;
+        };
+
+        const bool no_date_folders = config().hasProperty("no_date_folders");
+
+        blocking_queue<new_file> new_files;
+        camera_ref->set_object_created_handler([&new_files](std::shared_ptr<directory_ref> file) {
+            new_files.push({ std::move(file), clock::now() });
+        });
+
+        std::signal(SIGINT, request_stop);
+        std::signal(SIGTERM, request_stop);
+
+        std::cout << "Waiting for pictures (Ctrl-C to stop)" << std::endl;
+
+        std::vector<double> latencies_ms;
+        int result = EXIT_OK;
+
+        while (!stop_requested)
+        {
+            // The timeout only limits how long it takes to notice a stop request
+            const auto next = new_files.pop(std::chrono::milliseconds(250));
+            if (!next || next->file->is_a_folder())
+                continue;
+
+            const auto& file = next->file;
+            // Use the local clock for the date folder, rather than downloading the thumbnail
+            auto name = (no_date_folders) ? file->get_name()
+                                          : format_name(std::time(nullptr), file->get_name());
+
+            try
+            {
+                const trace_span span("pipeline", "download", file->get_name());
+                file->download_to(name);
+            }
+            catch (const eds_exception& ex)
+            {
+                std::cerr << "Failed to copy file " << file->get_name() << " to " << name
+                          << ". Error " << ex.what() << std::endl;
+                std::filesystem::remove(name);
+                result = EXIT_FAILURE;
+                continue;
+            }
+
+            const std::chrono::duration<double, std::milli> latency
+                = clock::now() - next->created_at;
+            latencies_ms.push_back(latency.count());
+            if (developer)
+                developer->add(name);
+
+            std::cout << "Copied file " << file->get_name() << " to " << name << " in "
+                      << std::fixed << std::setprecision(1) << latency.count() << " ms"
+                      << std::endl;
+        }
+
+        camera_ref->set_object_created_handler(nullptr);
+
+        print_latency_summary(latencies_ms);
+
+        return result;
+    }
+
+    static void print_latency_summary(std::vector<double> latencies_ms)
+    {
+        std::cout << latencies_ms.size() << " file(s) copied\n";
+        if (latencies_ms.empty())
+            return;
+
+        std::sort(latencies_ms.begin(), latencies_ms.end());
+        const auto percentile = [&latencies_ms](double p) {
+            const auto rank = static_cast<size_t>(std::ceil(p / 100.0 * latencies_ms.size()));
+            return latencies_ms[std::max<size_t>(rank, 1) - 1];
+        };
+
+        std::cout << "Event to disk latency (ms): p50 " << std::fixed << std::setprecision(1)
+                  << percentile(50) << ", p90 " << percentile(90) << ", p99 " << percentile(99)
+                  << ", max " << latencies_ms.back() << std::endl;
+    }
+};
+
+volatile std::sig_atomic_t cpimage_app::stop_requested = 0;
+
+} // namespace
+
+int run_cpimage(std::shared_ptr<camera_connection> cameras, const std::vector<std::string>& args,
+    run_location where)
+{
+    Poco::AutoPtr<cpimage_app> app = new cpimage_app(std::move(cameras), where);
+    try
+    {
+        app->init(args);
+    }
+    catch (Poco::Exception& exc)
+    {
+        app->logger().log(exc);
+        return Application::EXIT_CONFIG;
+    }
+    return app->run();
+}
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/// The protocol between camerad and its clients (lscamera and cpimage) over a Unix domain socket.
+///
+/// Every message is a frame: a one byte type, a four byte length (network order) and the data.
+/// The client sends one request frame holding its working directory followed by its argv. The
+/// daemon runs the command and sends back output and error frames as it goes, then an exit code
+/// frame, and closes the connection. A command that has to run in the client (because it runs
+/// until it is stopped) is answered with a run locally frame instead, once its options have been
+/// parsed the same way the client would parse them.
+namespace daemon_protocol
+{
+enum class frame_type : char
+{
+    request = 'q',
+    output = 'o',
+    error = 'e',
+    exit_code = 'x',
+    run_locally = 'l'
+};
+
+/// Create the folder if it is not there, readable only by this user, and check that it is a
+/// folder (not a link) owned by this user that no one else can use. Returns false if not, e.g.
+/// because another user created it first.
+inline bool make_private_directory(const std::string& path)
+{
+    if (::mkdir(path.c_str(), S_IRWXU) != 0 && errno != EEXIST)
+        return false;
+
+    struct stat folder;
+    return ::lstat(path.c_str(), &folder) == 0 && S_ISDIR(folder.st_mode)
+        && folder.st_uid == ::getuid() && (folder.st_mode & (S_IRWXG | S_IRWXO)) == 0;
+}
+
+/// The socket is in $XDG_RUNTIME_DIR, which only this user can use, or else in a folder in /tmp
+/// that only this user can use. Returns an empty path if that folder belongs to someone else.
+inline std::string default_socket_path()
+{
+    if (const char* path = std::getenv("CAMERAD_SOCKET"); path != nullptr && *path != '\0')
+        return path;
+
+    if (const char* runtime = std::getenv("XDG_RUNTIME_DIR"); runtime != nullptr && *runtime == '/')
+        return std::string(runtime) + "/camerad.sock";
+
+    const auto folder = "/tmp/camerad-" + std::to_string(::getuid());
+    if (!make_private_directory(folder))
+        return {};
+    return folder + "/camerad.sock";
+}
+
+/// The user at the other end of a connected Unix domain socket
+inline std::optional<uid_t> peer_uid(int fd)
+{
+#if defined __linux__
+    ucred credentials {};
+    socklen_t length = sizeof(credentials);
+    if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0)
+        return std::nullopt;
+    return credentials.uid;
+#else
+    uid_t uid = 0;
+    gid_t gid = 0;
+    if (::getpeereid(fd, &uid, &gid) != 0)
+        return std::nullopt;
+    return uid;
+#endif
+}
+
+/// Whether the other end of the socket is this user. The daemon and its clients only talk to
+/// the same user, so another user can not run commands or pretend to be camerad.
+inline bool is_same_user(int fd)
+{
+    const auto uid = peer_uid(fd);
+    return uid && *uid == ::getuid();
+}
+
+inline bool write_all(int fd, const char* data, std::size_t length)
+{
+    while (length > 0)
+    {
+        const auto written = ::write(fd, data, length);
+        if (written <= 0)
+            return false;
+        data += written;
+        length -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+inline bool read_all(int fd, char* data, std::size_t length)
+{
+    while (length > 0)
+    {
+        const auto bytes_read = ::read(fd, data, length);
+        if (bytes_read <= 0)
+            return false;
+        data += bytes_read;
+        length -= static_cast<std::size_t>(bytes_read);
+    }
+    return true;
+}
+
+inline bool write_frame(int fd, frame_type type, const char* data, std::size_t length)
+{
+    const auto size = static_cast<uint32_t>(length);
+    const char header[5] = { static_cast<char>(type), static_cast<char>(size >> 24),
+        static_cast<char>(size >> 16), static_cast<char>(size >> 8), static_cast<char>(size) };
+
+    return write_all(fd, header, sizeof(header)) && write_all(fd, data, length);
+}
+
+/// Requests are a directory and a command line, so anything bigger is not a request
+constexpr std::size_t max_request_size = 1024 * 1024;
+
+/// Read a frame. Returns false if the connection is closed or fails, or if the frame holds more
+/// than max_size bytes, which is only read as far as its header.
+inline bool read_frame(
+    int fd, frame_type& type, std::string& data, std::size_t max_size = UINT32_MAX)
+{
+    unsigned char header[5];
+    if (!read_all(fd, reinterpret_cast<char*>(header), sizeof(header)))
+        return false;
+
+    type = static_cast<frame_type>(header[0]);
+    const uint32_t size = (uint32_t(header[1]) << 24) | (uint32_t(header[2]) << 16)
+        | (uint32_t(header[3]) << 8) | uint32_t(header[4]);
+    if (size > max_size)
+        return false;
+
+    data.resize(size);
+    return read_all(fd, data.data(), size);
+}
+
+/// Strings in a request are separated by NUL characters
+inline std::string encode_strings(const std::vector<std::string>& strings)
+{
+    std::string encoded;
+    for (const auto& s : strings)
+    {
+        encoded += s;
+        encoded += '\0';
+    }
+    return encoded;
+}
+
+inline std::vector<std::string> decode_strings(const std::string& encoded)
+{
+    std::vector<std::string> strings;
+    std::string::size_type start = 0;
+    while (start < encoded.size())
+    {
+        const auto end = encoded.find('\0', start);
+        strings.push_back(encoded.substr(start, end - start));
+        if (end == std::string::npos)
+            break;
+        start = end + 1;
+    }
+    return strings;
+}
+
+/// Sends everything written to it as frames of one type. Used by camerad in place of the
+/// std::cout and std::cerr buffers while it runs a command.
+class frame_streambuf : public std::streambuf
+{
+    int fd;
+    frame_type type;
+    std::vector<char> buffer;
+
+public:
+    frame_streambuf(int socket, frame_type frame)
+        : fd(socket)
+        , type(frame)
+        , buffer(64 * 1024)
+    {
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+    ~frame_streambuf() override { sync(); }
+
+protected:
+    int overflow(int c) override
+    {
+        sync();
+        if (c != traits_type::eof())
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        if (pptr() != pbase())
+        {
+            // If the client has gone the command carries on; its output is discarded
+            write_frame(fd, type, pbase(), static_cast<std::size_t>(pptr() - pbase()));
+            setp(buffer.data(), buffer.data() + buffer.size());
+        }
+        return 0;
+    }
+};
+
+/// Connect to the daemon on path. Returns -1 if there is none, or if it is run by another user.
+inline int connect_to_daemon(const std::string& path)
+{
+    sockaddr_un address {};
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+        return -1;
+
+    address.sun_family = AF_UNIX;
+    std::copy(path.begin(), path.end(), address.sun_path);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || !is_same_user(fd))
+    {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/// Run the command in camerad if it is running. Returns the exit code, or nothing if there is
+/// no daemon (or camerad says the command must run locally) so the caller runs it itself.
+inline std::optional<int> run_in_daemon(int argc, char** argv)
+{
+    std::vector<std::string> request;
+    std::vector<char> cwd(4096);
+    if (getcwd(cwd.data(), cwd.size()) == nullptr)
+        return std::nullopt;
+    request.emplace_back(cwd.data());
+
+    request.insert(request.end(), argv, argv + argc);
+
+    const int fd = connect_to_daemon(default_socket_path());
+    if (fd < 0)
+        return std::nullopt;
+
+    const auto encoded = encode_strings(request);
+    std::optional<int> exit_code;
+    bool run_locally = false;
+    if (write_frame(fd, frame_type::request, encoded.data(), encoded.size()))
+    {
+        frame_type type;
+        std::string data;
+        while (!exit_code && !run_locally && read_frame(fd, type, data))
+        {
+            switch (type)
+            {
+            case frame_type::output:
+                std::cout.write(data.data(), static_cast<std::streamsize>(data.size()));
+                std::cout.flush();
+                break;
+            case frame_type::error:
+                std::cerr.write(data.data(), static_cast<std::streamsize>(data.size()));
+                break;
+            case frame_type::exit_code:
+                exit_code = std::atoi(data.c_str());
+                break;
+            case frame_type::run_locally:
+                run_locally = true;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    ::close(fd);
+
+    if (run_locally)
+        return std::nullopt;
+
+    if (!exit_code)
+    {
+        std::cerr << "Lost connection to camerad" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return exit_code;
+}
+
+} // namespace daemon_protocol
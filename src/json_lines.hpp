@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "Poco/JSON/PrintHandler.h"
+
+/// Write one JSON object on its own line, as lscamera --format jsonl does. The object is printed
+/// flat, as PrintHandler otherwise starts a new line after every value. PrintHandler writes
+/// straight to the stream, so nothing is kept in memory between records however many are written.
+template <typename F> void write_json_line(std::ostream& out, F write_fields)
+{
+    Poco::JSON::PrintHandler json(out, Poco::JSON::PrintHandler::JSON_PRINT_FLAT);
+    json.startObject();
+    write_fields(json);
+    json.endObject();
+    out << '\n';
+}
+
+inline void json_field(
+    Poco::JSON::PrintHandler& json, const std::string& key, const std::string& value)
+{
+    json.key(key);
+    json.value(value);
+}
+
+inline void json_field(Poco::JSON::PrintHandler& json, const std::string& key, uint64_t value)
+{
+    json.key(key);
+    json.value(static_cast<Poco::UInt64>(value));
+}
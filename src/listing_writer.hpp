@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/// Formats the lscamera file listing into a reusable buffer and writes it to the stream in large
+/// blocks. The layout matches the iostream formatting used previously byte for byte:
+///   <indent><name:12 left><MB:8 right, 2dp>MB <date:16 right><format:10 right, 0x hex><group:16>
+class listing_writer
+{
+public:
+    static constexpr int NAME_COLUMN = 12;
+    static constexpr int SIZE_COLUMN = 8;
+    static constexpr int DATE_COLUMN = 16;
+    static constexpr int FORMAT_COLUMN = 10;
+    static constexpr int ID_COLUMN = 16;
+
+    explicit listing_writer(std::ostream& output, std::size_t block_size = 256 * 1024)
+        : out(output)
+        , block(block_size)
+    {
+        buffer.reserve(block + 1024);
+    }
+
+    ~listing_writer() { flush(); }
+
+    listing_writer(const listing_writer&) = delete;
+    listing_writer& operator=(const listing_writer&) = delete;
+
+    void folder(const std::string& indent, const std::string& name)
+    {
+        buffer += indent;
+        buffer += name;
+        buffer += " (folder)\n";
+        flush_if_full();
+    }
+
+    void empty_folder(const std::string& indent)
+    {
+        buffer += indent;
+        buffer += "--  Empty  --\n";
+        flush_if_full();
+    }
+
+    void file(const std::string& indent, const std::string& name, uint64_t size_in_bytes,
+        const std::string& date_time, uint32_t format, uint32_t group_id)
+    {
+        buffer += indent;
+        append_left(name, NAME_COLUMN);
+        append_megabytes(size_in_bytes);
+        buffer += "MB ";
+        append_right(date_time.data(), date_time.size(), DATE_COLUMN);
+        append_hex(format);
+        append_decimal(group_id, ID_COLUMN);
+        buffer += '\n';
+        flush_if_full();
+    }
+
+    /// Write whatever is in the buffer to the stream
+    void flush()
+    {
+        if (!buffer.empty())
+        {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+        out.flush();
+    }
+
+private:
+    std::ostream& out;
+    std::size_t block;
+    std::string buffer;
+
+    void flush_if_full()
+    {
+        if (buffer.size() >= block)
+        {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+
+    void pad(std::size_t length, int width)
+    {
+        if (length < static_cast<std::size_t>(width))
+            buffer.append(static_cast<std::size_t>(width) - length, ' ');
+    }
+
+    void append_left(const std::string& text, int width)
+    {
+        buffer += text;
+        pad(text.size(), width);
+    }
+
+    void append_right(const char* text, std::size_t length, int width)
+    {
+        pad(length, width);
+        buffer.append(text, length);
+    }
+
+    /// Digits are generated backwards into the end of a small scratch buffer
+    static char* format_decimal(uint64_t value, char* end)
+    {
+        do
+        {
+            *--end = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        return end;
+    }
+
+    void append_decimal(uint64_t value, int width)
+    {
+        char digits[24];
+        char* const end = digits + sizeof(digits);
+        const char* start = format_decimal(value, end);
+        append_right(start, static_cast<std::size_t>(end - start), width);
+    }
+
+    /// Same as std::showbase << std::hex, which prints 0 without the 0x prefix
+    void append_hex(uint32_t value)
+    {
+        char digits[16];
+        char* const end = digits + sizeof(digits);
+        char* start = end;
+        do
+        {
+            *--start = "0123456789abcdef"[value & 0xf];
+            value >>= 4;
+        } while (value != 0);
+
+        if (*start != '0')
+        {
+            *--start = 'x';
+            *--start = '0';
+        }
+        append_right(start, static_cast<std::size_t>(end - start), FORMAT_COLUMN);
+    }
+
+    /// Same as std::fixed << std::setprecision(2) << bytes / (1024.0 * 1024.0). The double is
+    /// exact, so it is rounded here in integers the way printf does (halves go to even).
+    void append_megabytes(uint64_t bytes)
+    {
+        constexpr uint64_t MB = 1024 * 1024;
+        const uint64_t whole = bytes / MB;
+        const uint64_t scaled = (bytes % MB) * 100;
+        uint64_t hundredths = whole * 100 + scaled / MB;
+        const uint64_t remainder = (scaled % MB) * 2;
+        if (remainder > MB || (remainder == MB && (hundredths & 1) != 0))
+            hundredths++;
+
+        char digits[32];
+        char* const end = digits + sizeof(digits);
+        char* start = end;
+        *--start = static_cast<char>('0' + hundredths % 10);
+        *--start = static_cast<char>('0' + (hundredths / 10) % 10);
+        *--start = '.';
+        start = format_decimal(hundredths / 100, start);
+        append_right(start, static_cast<std::size_t>(end - start), SIZE_COLUMN);
+    }
+};
@@ -0,0 +1,636 @@
+//
+//  lscamera_app.cpp
+//  List Cameras
+//
+//  Created by Rob McKay on 08/01/2021.
+//
+
+#include "Poco/AutoPtr.h"
+#include "Poco/Exception.h"
+#include "Poco/Util/Application.h"
+#include "Poco/Util/HelpFormatter.h"
+#include "Poco/Util/IntValidator.h"
+#include "Poco/Util/Option.h"
+#include "Poco/Util/RegExpValidator.h"
+
+#include "LSCameraConfig.h"
+
+#include <chrono>
+#include <csignal>
+#include <ctime>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace Poco::Util;
+
+#include "api_stats_report.hpp"
+#include "camera_interface.hpp"
+#include "camera_tools.hpp"
+#include "console_logging.hpp"
+#include "json_lines.hpp"
+#include "listing_writer.hpp"
+
+constexpr int LABEL_WIDTH = 20;
+
+constexpr int DEFAULT_CAMERA_NUMBER = 0;
+constexpr int DEFAULT_VOLUME_NUMBER = 0;
+constexpr int DEFAULT_WATCH_INTERVAL = 5;
+
+namespace
+{
+
+class lscamera_app : public Poco::Util::Application
+{
+    bool help_requested = false;
+    std::shared_ptr<camera_connection> cameras;
+    std::unique_ptr<console_logging> console;
+
+    const run_location where;
+
+    /// Set by Ctrl-C. Signal handlers can only set a static flag, so it is cleared as each
+    /// command starts rather than carrying a stop over to the next command.
+    static volatile std::sig_atomic_t stop_requested;
+    static void request_stop(int) { stop_requested = 1; }
+
+public:
+    lscamera_app(std::shared_ptr<camera_connection> connection, run_location location)
+        : cameras(std::move(connection))
+        , where(location)
+    {
+    }
+
+    void defineOptions(OptionSet& options) override
+    {
+        Application::defineOptions(options);
+        options.addOption(Option("help", "h", "Display help information")
+                              .required(false)
+                              .repeatable(false)
+                              .callback(OptionCallback<lscamera_app>(this, &lscamera_app::handle_help)));
+
+        const int count = cameras->number_of_cameras();
+
+        options.addOption(Option("camera-number", "c", "Choose camera (0..n-1). Defaults to camera 0")
+                              .required(false)
+                              .argument("camera")
+                              .validator(new IntValidator(0, count))
+                              .binding("camera_number"));
+
+        options.addOption(Option("files", "f",
+            "Display file information for the selected camera.")
+                              .required(false)
+                              .binding("show_files"));
+
+        options.addOption(Option("properties", "p",
+            "Display every readable property of the selected camera (or all cameras).")
+                              .required(false)
+                              .binding("show_properties"));
+
+        options.addOption(Option("format", "F",
+            "Output format: 'text' (default) or 'jsonl' for one JSON object per camera, volume, "
+            "file or property")
+                              .required(false)
+                              .argument("format")
+                              .validator(new RegExpValidator("text|jsonl"))
+                              .binding("format"));
+
+        options.addOption(Option("watch", "w",
+            "Keep running and print the battery level, available shots and free space of the "
+            "selected camera (or all cameras) whenever they change")
+                              .required(false)
+                              .binding("watch"));
+
+        options.addOption(Option("interval", "i",
+            "Seconds between checks in watch mode. Defaults to 5")
+                              .required(false)
+                              .argument("seconds")
+                              .validator(new IntValidator(1, 3600))
+                              .binding("watch_interval"));
+
+        options.addOption(Option("stats", "s",
+            "Time every call to the Canon SDK and print the number of calls and their p50, p99 "
+            "and max latency for each SDK function at the end, with the peak memory used (and "
+            "the heap allocations made by each part, in instrumentation builds)")
+                              .required(false)
+                              .binding("show_stats"));
+    }
+
+    void initialize(Application& self) override
+    {
+        loadConfiguration(); // load default configuration files
+        Application::initialize(self);
+        console = std::make_unique<console_logging>(config());
+    }
+
+#define STR2(x) #x
+#define STR(x) STR2(x)
+
+    void display_help()
+    {
+        HelpFormatter helpFormatter(options());
+        helpFormatter.setCommand(commandName());
+        helpFormatter.setUsage("OPTIONS");
+        helpFormatter.setHeader("\n" + commandName()
+            + " Version " STR(LSCAMERA_VERSION_MAJOR) "." STR(
+                LSCAMERA_VERSION_MINOR) "\n\nList Canon cameras connect to the computer (via USB)");
+        helpFormatter.format(std::cout);
+    }
+
+    void handle_help(const std::string&, const std::string&)
+    {
+        help_requested = true;
+        display_help();
+        stopOptionsProcessing();
+    }
+
+    void camera_details(int camera_number, std::ostream& out)
+    {
+        auto camera_ref = cameras->open_camera(camera_number);
+        auto conn_info = camera_ref->get_connection_info();
+        logger().debug("Found camera %d  on port %s: %s", camera_number, conn_info->get_port(),
+            conn_info->get_desc());
+
+        auto camera_info = camera_ref->get_camera_info();
+        out << std::left; // << std::setfill('_');
+        out << std::setw(LABEL_WIDTH) << "Product" << std::setw(0)
+            << camera_info->get_product_name() << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Body" << camera_info->get_body_ID_ex() << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Owner Name" << camera_info->get_owner_name() << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Maker" << camera_info->get_maker_name() << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Date/Time" << camera_info->get_date_time() << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Firmware" << camera_info->get_firmware_version()
+            << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Battery Level" << camera_info->get_battery_level()
+            << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Battery Quality" << camera_info->get_battery_quality()
+            << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Save to" << camera_info->get_save_to() << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Current Storage" << camera_info->get_current_storage()
+            << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Current Folder" << camera_info->get_current_folder()
+            << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Lens Status"
+            << (camera_info->get_lens_status() ? "Lens Attached" : "No Lens") << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Lens Name" << camera_info->get_lens_name() << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Artist" << camera_info->get_artist() << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Copyright" << camera_info->get_copyright() << std::endl;
+        out << std::setw(LABEL_WIDTH) << "Available Shots" << camera_info->get_available_shots()
+            << std::endl;
+    }
+
+    void camera_properties(int camera_number, std::ostream& out)
+    {
+        auto camera_ref = cameras->open_camera(camera_number);
+
+        std::vector<property_value::property_id_t> ids;
+        for (const auto& descriptor : get_property_descriptors())
+            ids.push_back(descriptor.id);
+
+        out << std::left;
+        for (const auto& value : camera_ref->read_properties(ids))
+        {
+            if (value.is_available())
+                out << std::setw(LABEL_WIDTH) << find_property_descriptor(value.id)->label
+                    << value.to_string() << '\n';
+        }
+        out << std::flush;
+    }
+
+    typedef void (lscamera_app::*camera_output_t)(int camera_number, std::ostream& out);
+
+    /// Collect the output for every camera at the same time, as each one opens its own session
+    /// with open_camera() and reads its properties, then print it in camera order. The total time
+    /// is about the time taken by the slowest camera rather than the sum of them all.
+    void for_each_camera_in_parallel(
+        int count, camera_output_t camera_output, const char* separator = "")
+    {
+        std::vector<std::future<std::string>> results;
+        results.reserve(static_cast<size_t>(count));
+
+        for (int camera_number = 0; camera_number < count; camera_number++)
+        {
+            results.push_back(std::async(std::launch::async, [this, camera_output, camera_number] {
+                std::ostringstream out;
+                (this->*camera_output)(camera_number, out);
+                return out.str();
+            }));
+        }
+
+        // Each camera is printed as soon as it and the cameras before it are ready
+        for (auto& result : results)
+            std::cout << result.get() << separator << std::flush;
+    }
+
+    /// Volume sizes are in KB
+    static double kb_to_gb(uint64_t size_kb)
+    {
+        return static_cast<double>(size_kb) / (1024.0 * 1024.0);
+    }
+
+    void dump_volume_info(const volume_ref* vol)
+    {
+        std::cout << std::left;
+        std::cout << "Selected volume number " << 0 << std::endl;
+        std::cout << std::setw(LABEL_WIDTH) << "Volume" << std::setw(0) << vol->get_label()
+                  << std::endl;
+        std::cout << std::setw(LABEL_WIDTH) << "Storage Type" << std::setw(0)
+                  << static_cast<int>(vol->get_storage_type()) << std::endl;
+        std::cout << std::setw(LABEL_WIDTH) << "Access" << std::setw(0) << static_cast<int>(vol->get_access())
+                  << std::endl;
+        std::cout << std::setw(LABEL_WIDTH) << "Max Capacity" << std::setw(0)
+                  << kb_to_gb(vol->get_max_capacity()) << " GB" << std::endl;
+        std::cout << std::setw(LABEL_WIDTH) << "Free Space" << std::setw(0)
+                  << kb_to_gb(vol->get_free_space()) << " GB" << std::endl;
+    }
+
+    void dump_directory_item(
+        listing_writer& listing, const directory_ref* dir_item, std::string indent = "")
+    {
+        if (dir_item->is_a_folder())
+        {
+            listing.folder(indent, dir_item->get_name());
+
+            indent += "  ";
+            const auto count = dir_item->get_directory_count();
+            if (count < 1)
+            {
+                listing.empty_folder(indent);
+            }
+            else
+            {
+                for (directory_ref::size_type c = 0; c < count; c++)
+                {
+                    auto folder_ref = dir_item->get_directory_entry(c);
+                    dump_directory_item(listing, folder_ref.get(), indent);
+                }
+            }
+        }
+        else
+        {
+            listing.file(indent, dir_item->get_name(), dir_item->get_file_size(),
+                dir_item->get_date_time(), dir_item->get_format(), dir_item->get_group_ID());
+        }
+    }
+
+    void camera_details_json(int camera_number, std::ostream& out)
+    {
+        auto camera_ref = cameras->open_camera(camera_number);
+        auto conn_info = camera_ref->get_connection_info();
+        auto camera_info = camera_ref->get_camera_info();
+
+        write_json_line(out, [&](Poco::JSON::PrintHandler& json) {
+            json_field(json, "type", "camera");
+            json_field(json, "camera", camera_number);
+            json_field(json, "port", conn_info->get_port());
+            json_field(json, "product", camera_info->get_product_name());
+            json_field(json, "body", camera_info->get_body_ID_ex());
+            json_field(json, "owner_name", camera_info->get_owner_name());
+            json_field(json, "maker", camera_info->get_maker_name());
+            json_field(json, "date_time", camera_info->get_date_time());
+            json_field(json, "firmware", camera_info->get_firmware_version());
+            json_field(json, "battery_level", camera_info->get_battery_level());
+            json_field(json, "battery_quality", camera_info->get_battery_quality());
+            json_field(json, "save_to", camera_info->get_save_to());
+            json_field(json, "current_storage", camera_info->get_current_storage());
+            json_field(json, "current_folder", camera_info->get_current_folder());
+            json.key("lens_attached");
+            json.value(camera_info->get_lens_status());
+            json_field(json, "lens_name", camera_info->get_lens_name());
+            json_field(json, "artist", camera_info->get_artist());
+            json_field(json, "copyright", camera_info->get_copyright());
+            json_field(json, "available_shots", camera_info->get_available_shots());
+        });
+    }
+
+    void camera_properties_json(int camera_number, std::ostream& out)
+    {
+        auto camera_ref = cameras->open_camera(camera_number);
+
+        std::vector<property_value::property_id_t> ids;
+        for (const auto& descriptor : get_property_descriptors())
+            ids.push_back(descriptor.id);
+
+        for (const auto& value : camera_ref->read_properties(ids))
+        {
+            if (!value.is_available())
+                continue;
+
+            write_json_line(out, [&](Poco::JSON::PrintHandler& json) {
+                json_field(json, "type", "property");
+                json_field(json, "camera", camera_number);
+                json_field(json, "key", find_property_descriptor(value.id)->key);
+                json_field(json, "value", value.to_string());
+            });
+        }
+    }
+
+    void dump_volume_info_json(int camera_number, int volume_number, const volume_ref* vol)
+    {
+        write_json_line(std::cout, [&](Poco::JSON::PrintHandler& json) {
+            json_field(json, "type", "volume");
+            json_field(json, "camera", camera_number);
+            json_field(json, "volume", volume_number);
+            json_field(json, "label", vol->get_label());
+            json_field(json, "storage_type", static_cast<uint64_t>(vol->get_storage_type()));
+            json_field(json, "access", static_cast<uint64_t>(vol->get_access()));
+            json_field(json, "max_capacity_kb", vol->get_max_capacity());
+            json_field(json, "free_space_kb", vol->get_free_space());
+            json_field(json, "entries", vol->get_directory_count());
+        });
+    }
+
+    /// The time formatted as directory_ref::get_date_time formats it. A file without a date has
+    /// the local time 00:00:00 on 1 January 1970, which is shown as no date, as it is there.
+    static std::string format_date_time(std::time_t timestamp)
+    {
+        std::tm local {};
+        localtime_r(&timestamp, &local);
+        if (local.tm_year == 70 && local.tm_yday == 0 && local.tm_hour == 0 && local.tm_min == 0
+            && local.tm_sec == 0)
+            return "";
+
+        char text[32];
+        std::strftime(text, sizeof(text), "%d-%b-%Y %H:%M:%S", &local);
+        return text;
+    }
+
+    void dump_directory_item_json(
+        int camera_number, const directory_ref* dir_item, const std::string& parent = "")
+    {
+        const auto path = parent.empty() ? dir_item->get_name() : parent + "/" + dir_item->get_name();
+
+        if (dir_item->is_a_folder())
+        {
+            const auto count = dir_item->get_directory_count();
+            write_json_line(std::cout, [&](Poco::JSON::PrintHandler& json) {
+                json_field(json, "type", "folder");
+                json_field(json, "camera", camera_number);
+                json_field(json, "path", path);
+                json_field(json, "entries", count);
+            });
+
+            for (directory_ref::size_type c = 0; c < count; c++)
+            {
+                auto folder_ref = dir_item->get_directory_entry(c);
+                dump_directory_item_json(camera_number, folder_ref.get(), path);
+            }
+        }
+        else
+        {
+            // Both come from the thumbnail, so it is only downloaded once
+            const auto timestamp = dir_item->get_timestamp();
+            write_json_line(std::cout, [&](Poco::JSON::PrintHandler& json) {
+                json_field(json, "type", "file");
+                json_field(json, "camera", camera_number);
+                json_field(json, "path", path);
+                json_field(json, "size", dir_item->get_file_size());
+                json_field(json, "date_time", format_date_time(timestamp));
+                json_field(json, "timestamp", static_cast<uint64_t>(timestamp));
+                json_field(json, "format", dir_item->get_format());
+                json_field(json, "group_id", dir_item->get_group_ID());
+            });
+        }
+    }
+
+    int main_json(int count)
+    {
+        if (config().hasOption("show_properties") || !config().hasOption("show_files"))
+        {
+            auto details = config().hasOption("show_properties") ? &lscamera_app::camera_properties_json
+                                                                 : &lscamera_app::camera_details_json;
+
+            if (!config().hasOption("camera_number"))
+                for_each_camera_in_parallel(count, details);
+            else
+                (this->*details)(config().getInt("camera_number"), std::cout);
+        }
+        else
+        {
+            int camera_number = config().getInt("camera_number", DEFAULT_CAMERA_NUMBER);
+
+            auto camera_ref = cameras->select_camera(camera_number);
+            auto vol = camera_ref->select_volume(DEFAULT_VOLUME_NUMBER);
+            dump_volume_info_json(camera_number, DEFAULT_VOLUME_NUMBER, vol.get());
+
+            const auto dir_item_count = vol->get_directory_count();
+            for (volume_ref::size_type dir_item_no = 0; dir_item_no < dir_item_count; dir_item_no++)
+            {
+                auto dir_item = vol->select_directory(dir_item_no);
+                dump_directory_item_json(camera_number, dir_item.get());
+            }
+        }
+
+        std::cout << std::flush;
+        return EXIT_OK;
+    }
+
+    struct watched_camera
+    {
+        int camera_number;
+        std::shared_ptr<camera_ref> camera;
+        std::shared_ptr<volume_ref> volume;
+        std::map<std::string, std::string> last_values;
+    };
+
+    /// Print a watched value if it has changed since the last time it was read
+    void report_change(watched_camera& watched, const std::string& key, const std::string& label,
+        const std::string& value, const std::string& timestamp)
+    {
+        auto& last = watched.last_values[key];
+        if (last == value)
+            return;
+        last = value;
+
+        if (config().getString("format", "text") == "jsonl")
+        {
+            write_json_line(std::cout, [&](Poco::JSON::PrintHandler& json) {
+                json_field(json, "type", "change");
+                json_field(json, "time", timestamp);
+                json_field(json, "camera", watched.camera_number);
+                json_field(json, "key", key);
+                json_field(json, "value", value);
+            });
+        }
+        else
+        {
+            std::cout << timestamp << "  Camera " << watched.camera_number << "  " << std::left
+                      << std::setw(LABEL_WIDTH) << label << value << '\n';
+        }
+    }
+
+    /// Keep the sessions open and only re-read the values that change during a shoot: two
+    /// property reads and one volume info read per camera each interval.
+    int watch(int count)
+    {
+        std::vector<property_value::property_id_t> watched_properties;
+        for (const auto key : { "battery_level", "available_shots" })
+            watched_properties.push_back(find_property_descriptor(key)->id);
+
+        std::vector<watched_camera> watched;
+        const int first = config().getInt("camera_number", 0);
+        const int last = config().hasOption("camera_number") ? first + 1 : count;
+        for (int camera_number = first; camera_number < last; camera_number++)
+        {
+            auto camera = cameras->select_camera(camera_number);
+            auto volume = (camera->get_volume_count() > 0) ? camera->select_volume(0) : nullptr;
+            watched.push_back({ camera_number, camera, volume, {} });
+        }
+
+        std::signal(SIGINT, request_stop);
+        std::signal(SIGTERM, request_stop);
+
+        const std::chrono::seconds interval(
+            config().getInt("watch_interval", DEFAULT_WATCH_INTERVAL));
+
+        while (!stop_requested && !watched.empty())
+        {
+            char timestamp[32];
+            const auto now = std::time(nullptr);
+            std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+
+            for (auto it = watched.begin(); it != watched.end();)
+            {
+                try
+                {
+                    for (const auto& value : it->camera->read_properties(watched_properties))
+                    {
+                        // Keep showing the last value if this one could not be read (e.g. busy)
+                        if (value.error)
+                            continue;
+
+                        const auto descriptor = find_property_descriptor(value.id);
+                        report_change(
+                            *it, descriptor->key, descriptor->label, value.to_string(), timestamp);
+                    }
+
+                    if (it->volume)
+                    {
+                        std::ostringstream free_space;
+                        free_space << std::fixed << std::setprecision(2)
+                                   << kb_to_gb(it->volume->read_free_space()) << " GB";
+                        report_change(*it, "free_space", "Free Space", free_space.str(), timestamp);
+                    }
+                    ++it;
+                }
+                catch (const eds_exception& ex)
+                {
+                    std::cerr << "Camera " << it->camera_number
+                              << " is no longer available: " << ex.what() << std::endl;
+                    it = watched.erase(it);
+                }
+            }
+            std::cout << std::flush;
+
+            // Sleep in short steps so Ctrl-C is noticed quickly
+            const auto wake_at = std::chrono::steady_clock::now() + interval;
+            while (!stop_requested && std::chrono::steady_clock::now() < wake_at)
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        return EXIT_OK;
+    }
+
+    int main(const std::vector<std::string>&) override
+    {
+        if (help_requested)
+            return EXIT_USAGE;
+
+        stop_requested = 0;
+        if (where == run_location::daemon && config().hasOption("watch"))
+            return EXIT_RUN_LOCALLY;
+
+        const api_stats_report stats(config().hasOption("show_stats"));
+        return list_cameras();
+    }
+
+    int list_cameras()
+    {
+        const int count = cameras->number_of_cameras();
+
+        if (count < 1)
+        {
+            std::cerr << "No cameras found\n";
+            return EXIT_FAILURE;
+        }
+
+        if (config().hasOption("watch"))
+            return watch(count);
+
+        if (config().getString("format", "text") == "jsonl")
+            return main_json(count);
+
+        if (config().hasOption("show_properties"))
+        {
+            if (!config().hasOption("camera_number"))
+                for_each_camera_in_parallel(count, &lscamera_app::camera_properties, "\n");
+            else
+            {
+                camera_properties(config().getInt("camera_number"), std::cout);
+            }
+        }
+        else if (!config().hasOption("show_files"))
+        {
+            if (!config().hasOption("camera_number"))
+                for_each_camera_in_parallel(count, &lscamera_app::camera_details);
+            else
+            {
+                camera_details(config().getInt("camera_number"), std::cout);
+            }
+        }
+        else
+        {
+            int camera_number = config().getInt("camera_number", DEFAULT_CAMERA_NUMBER);
+
+            auto camera_ref = cameras->select_camera(camera_number);
+
+            auto vol = camera_ref->select_volume(0);
+            auto dir_item_count = vol->get_directory_count();
+
+            dump_volume_info(vol.get());
+            std::cout << std::setw(LABEL_WIDTH) << "Root Dir Entry" << std::setw(0)
+                      << dir_item_count << std::endl;
+            std::cout << std::endl;
+
+            if (dir_item_count < 1)
+            {
+                std::cout << "--  Empty  --" << std::endl;
+            }
+            else
+            {
+                listing_writer listing(std::cout);
+                for (volume_ref::size_type dir_item_no = 0; dir_item_no < dir_item_count;
+                     dir_item_no++)
+                {
+                    auto dir_item = vol->select_directory(dir_item_no);
+                    dump_directory_item(listing, dir_item.get());
+                }
+            }
+        }
+
+        return EXIT_OK;
+    }
+};
+
+volatile std::sig_atomic_t lscamera_app::stop_requested = 0;
+
+} // namespace
+
+int run_lscamera(std::shared_ptr<camera_connection> cameras, const std::vector<std::string>& args,
+    run_location where)
+{
+    Poco::AutoPtr<lscamera_app> app = new lscamera_app(std::move(cameras), where);
+    try
+    {
+        app->init(args);
+    }
+    catch (Poco::Exception& exc)
+    {
+        app->logger().log(exc);
+        return Application::EXIT_CONFIG;
+    }
+    return app->run();
+}
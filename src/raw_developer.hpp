@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "blocking_queue.hpp"
+#include "camera_interface.hpp"
+
+/// Develops raw files once they have been downloaded, on a fixed number of worker threads, so the
+/// thread downloading from the camera never waits for a conversion. The queue of files waiting to
+/// be developed is unbounded (an entry is only a path), so add() never blocks.
+class raw_developer
+{
+public:
+    typedef std::chrono::steady_clock clock;
+    typedef std::function<void(
+        const std::filesystem::path& raw, const std::filesystem::path& developed)>
+        develop_t;
+
+    struct summary
+    {
+        std::size_t developed = 0;
+        std::size_t failed = 0;
+        std::size_t max_queue_depth = 0;
+        /// Time taken to develop each file, in the order they finished
+        std::vector<std::chrono::duration<double, std::milli>> develop_times;
+    };
+
+    /// develop defaults to develop_raw_image() from the camera interface
+    raw_developer(developed_format output_format, unsigned worker_count, develop_t develop = nullptr)
+        : format(output_format)
+        , develop_file(develop ? std::move(develop) : default_develop(output_format))
+    {
+        for (unsigned i = 0; i < std::max(worker_count, 1u); i++)
+            workers.emplace_back(&raw_developer::work, this, i + 1);
+    }
+
+    ~raw_developer() { finish(); }
+
+    raw_developer(const raw_developer&) = delete;
+    raw_developer& operator=(const raw_developer&) = delete;
+
+    static bool is_raw_file(const std::filesystem::path& file)
+    {
+        auto extension = file.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension == ".cr2" || extension == ".cr3" || extension == ".crw";
+    }
+
+    static std::filesystem::path developed_name(
+        std::filesystem::path raw, developed_format output_format)
+    {
+        return raw.replace_extension((output_format == developed_format::jpeg) ? ".jpg" : ".tif");
+    }
+
+    /// Queue a downloaded file to be developed. Files that are not raw files are ignored.
+    void add(std::filesystem::path file)
+    {
+        if (!is_raw_file(file))
+            return;
+
+        queue.push(std::move(file));
+
+        const auto depth = queue.size();
+        std::lock_guard<std::mutex> lock(mutex);
+        results.max_queue_depth = std::max(results.max_queue_depth, depth);
+    }
+
+    /// Number of files waiting for a worker
+    std::size_t queue_depth() { return queue.size(); }
+
+    /// Wait for the queued files to be developed and stop the workers
+    summary finish()
+    {
+        queue.close();
+        for (auto& worker : workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        return results;
+    }
+
+private:
+    developed_format format;
+    develop_t develop_file;
+    blocking_queue<std::filesystem::path> queue;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    summary results;
+
+    static develop_t default_develop(developed_format output_format)
+    {
+        return [output_format](const std::filesystem::path& raw,
+                   const std::filesystem::path& developed) {
+            develop_raw_image(raw.string(), developed.string(), output_format);
+        };
+    }
+
+    void work(unsigned worker_number)
+    {
+        set_trace_thread_name("develop " + std::to_string(worker_number));
+
+        while (auto raw = queue.pop())
+        {
+            const trace_span span("pipeline", "develop", raw->filename().string());
+            const auto developed = developed_name(*raw, format);
+            const auto started = clock::now();
+            try
+            {
+                develop_file(*raw, developed);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                results.developed++;
+                results.develop_times.push_back(clock::now() - started);
+            }
+            catch (const std::exception& ex)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                results.failed++;
+                std::cerr << "Failed to develop " << raw->string() << ". Error " << ex.what()
+                          << std::endl;
+            }
+        }
+    }
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include "Poco/AutoPtr.h"
+#include "Poco/Path.h"
+#include "Poco/Util/PropertyFileConfiguration.h"
+
+/// Download throughput for each camera (by body ID), remembered between runs so that
+/// cpimage --plan can estimate how long an ingest will take.
+///
+/// The estimate is bytes / bytes_per_second plus a fixed time per file. After each real run the
+/// stored rate moves half way towards the rate that was measured while downloading.
+class throughput_model
+{
+    std::string path;
+    Poco::AutoPtr<Poco::Util::PropertyFileConfiguration> store;
+
+    static std::string key_for(const std::string& camera_id)
+    {
+        std::string key = camera_id;
+        std::replace_if(
+            key.begin(), key.end(), [](unsigned char c) { return !std::isalnum(c); }, '_');
+        return "throughput." + key + ".bytes_per_second";
+    }
+
+public:
+    explicit throughput_model(std::string file_path = default_path())
+        : path(std::move(file_path))
+        , store(new Poco::Util::PropertyFileConfiguration())
+    {
+        if (std::filesystem::exists(path))
+            store->load(path);
+    }
+
+    static std::string default_path() { return Poco::Path::home() + ".cpimage_throughput"; }
+
+    std::optional<double> bytes_per_second(const std::string& camera_id) const
+    {
+        const double rate = store->getDouble(key_for(camera_id), 0.0);
+        if (rate <= 0.0)
+            return std::nullopt;
+        return rate;
+    }
+
+    /// Estimated time to copy the files, or nothing if this camera has not been used before
+    std::optional<std::chrono::duration<double>> estimate(const std::string& camera_id,
+        uint64_t bytes, std::size_t files, std::chrono::duration<double> per_file) const
+    {
+        const auto rate = bytes_per_second(camera_id);
+        if (!rate)
+            return std::nullopt;
+
+        return std::chrono::duration<double>(static_cast<double>(bytes) / *rate) + per_file * files;
+    }
+
+    /// Update the model with the time spent downloading in a real run and save it
+    void record(const std::string& camera_id, uint64_t bytes,
+        std::chrono::duration<double> transfer_time)
+    {
+        if (bytes == 0 || transfer_time.count() <= 0.0)
+            return;
+
+        const double measured = static_cast<double>(bytes) / transfer_time.count();
+        const auto previous = bytes_per_second(camera_id);
+
+        store->setDouble(key_for(camera_id), previous ? (*previous + measured) / 2 : measured);
+        store->save(path);
+    }
+};
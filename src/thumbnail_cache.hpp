@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Poco/Path.h"
+
+/// Thumbnails kept on disk so a card that has already been browsed can be browsed again without
+/// downloading anything. Entries are keyed by camera body ID, folder, file name and file size,
+/// i.e. <cache>/<body ID>/<folder>/<name>-<size>.jpg
+class thumbnail_cache
+{
+    std::filesystem::path root;
+
+    /// name as one path component. Characters other than letters, digits, '.', '-' and '_' are
+    /// written as %XX, as is a leading '.', so different names never share a component and a
+    /// name can never be "." or "..".
+    static std::string safe_name(const std::string& name)
+    {
+        static const char hex_digits[] = "0123456789ABCDEF";
+
+        // Nothing else escapes to a lone %
+        if (name.empty())
+            return "%";
+
+        std::string safe;
+        for (unsigned char c : name)
+        {
+            const bool plain
+                = std::isalnum(c) || c == '-' || c == '_' || (c == '.' && !safe.empty());
+            if (plain)
+                safe += static_cast<char>(c);
+            else
+            {
+                safe += '%';
+                safe += hex_digits[c >> 4];
+                safe += hex_digits[c & 0xF];
+            }
+        }
+        return safe;
+    }
+
+public:
+    explicit thumbnail_cache(std::filesystem::path cache_root = default_path())
+        : root(std::move(cache_root))
+    {
+    }
+
+    static std::filesystem::path default_path()
+    {
+        return std::filesystem::path(Poco::Path::cacheHome()) / "cpimage" / "thumbnails";
+    }
+
+    std::filesystem::path path_for(const std::string& body_id, const std::string& folder,
+        const std::string& name, uint64_t size) const
+    {
+        return root / safe_name(body_id) / safe_name(folder)
+            / (safe_name(name) + "-" + std::to_string(size) + ".jpg");
+    }
+
+    /// The cached thumbnail, if there is one
+    std::optional<std::filesystem::path> find(const std::string& body_id, const std::string& folder,
+        const std::string& name, uint64_t size) const
+    {
+        auto path = path_for(body_id, folder, name, size);
+        if (std::filesystem::exists(path))
+            return path;
+        return std::nullopt;
+    }
+
+    /// Add a thumbnail. It is written to a temporary file first, so an interrupted write never
+    /// leaves a partial thumbnail in the cache.
+    std::filesystem::path store(const std::string& body_id, const std::string& folder,
+        const std::string& name, uint64_t size, const std::vector<uint8_t>& jpeg) const
+    {
+        const auto path = path_for(body_id, folder, name, size);
+        std::filesystem::create_directories(path.parent_path());
+
+        auto temporary = path;
+        temporary += ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(jpeg.data()),
+                static_cast<std::streamsize>(jpeg.size()));
+            if (!out)
+                throw std::filesystem::filesystem_error("Failed to write thumbnail", temporary,
+                    std::make_error_code(std::errc::io_error));
+        }
+        std::filesystem::rename(temporary, path);
+
+        return path;
+    }
+};
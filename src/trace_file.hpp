@@ -0,0 +1,41 @@
+#pragma once
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "camera_interface.hpp"
+
+/// Records a trace of the SDK calls and pipeline steps while it is in scope and writes it to the
+/// file as Chrome trace event JSON when it goes. It does nothing if the file name is empty.
+class trace_file
+{
+    const std::string file_name;
+
+public:
+    explicit trace_file(std::string name)
+        : file_name(std::move(name))
+    {
+        if (file_name.empty())
+            return;
+
+        set_trace_thread_name("main");
+        set_trace_enabled(true);
+    }
+
+    ~trace_file()
+    {
+        if (file_name.empty())
+            return;
+
+        set_trace_enabled(false);
+
+        std::ofstream out(file_name);
+        write_trace(out);
+        if (!out)
+            std::cerr << "Failed to write the trace to " << file_name << std::endl;
+    }
+
+    trace_file(const trace_file&) = delete;
+    trace_file& operator=(const trace_file&) = delete;
+};
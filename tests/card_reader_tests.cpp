@@ -0,0 +1,186 @@
+#include "camera_interface.hpp"
+#include "gtest/gtest.h"
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+/// A card with DCIM/100CANON holding three pictures and a folder with a hidden file
+class card_reader : public ::testing::Test
+{
+protected:
+    const std::filesystem::path card = std::filesystem::temp_directory_path() / "card_reader_tests";
+    const std::filesystem::path destination = card / "copied";
+
+    void SetUp() override
+    {
+        std::filesystem::remove_all(card);
+        std::filesystem::create_directories(card / "DCIM" / "100CANON");
+        std::filesystem::create_directories(card / "MISC");
+        std::filesystem::create_directories(destination);
+
+        write_file("DCIM/100CANON/IMG_0001.CR2", 3 * 1024 * 1024 + 17);
+        write_file("DCIM/100CANON/IMG_0002.CR2", 100);
+        write_file("DCIM/100CANON/IMG_0002.JPG", 50);
+        write_file("DCIM/100CANON/._IMG_0001.CR2", 10);
+    }
+
+    void TearDown() override { std::filesystem::remove_all(card); }
+
+    void write_file(const std::string& name, std::size_t size)
+    {
+        std::ofstream file(card / name, std::ios::binary);
+        for (std::size_t i = 0; i < size; i++)
+            file.put(static_cast<char>(i * 7));
+    }
+
+    static std::string read_file(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    }
+};
+} // namespace
+
+TEST_F(card_reader, lists_folders_like_a_camera)
+{
+    auto volume = open_mounted_volume(card.string());
+
+    EXPECT_EQ("card_reader_tests", volume->get_label());
+    EXPECT_GT(volume->get_max_capacity(), 0u);
+    // In KB, as a camera reports it
+    EXPECT_EQ(std::filesystem::space(card).capacity / 1024, volume->get_max_capacity());
+    EXPECT_EQ(volume_ref::access_type_t::read_write, volume->get_access());
+
+    // DCIM, MISC and copied, in name order
+    ASSERT_EQ(3u, volume->get_directory_count());
+    auto dcim = volume->select_directory(0);
+    EXPECT_EQ("DCIM", dcim->get_name());
+    EXPECT_TRUE(dcim->is_a_folder());
+
+    auto folder = dcim->find_directory("100CANON");
+    ASSERT_NE(nullptr, folder);
+    EXPECT_EQ(nullptr, dcim->find_directory("101CANON"));
+
+    // The hidden file is skipped
+    ASSERT_EQ(3u, folder->get_directory_count());
+    auto file = folder->get_directory_entry(1);
+    EXPECT_EQ("IMG_0002.CR2", file->get_name());
+    EXPECT_FALSE(file->is_a_folder());
+    EXPECT_EQ(100u, file->get_file_size());
+    EXPECT_EQ(0xB103u, file->get_format());
+    EXPECT_EQ(0xB103u, folder->get_directory_entry(0)->get_format());
+    EXPECT_EQ(0x3801u, folder->get_directory_entry(2)->get_format());
+    EXPECT_THROW(folder->get_directory_entry(3), std::out_of_range);
+    EXPECT_THROW(file->get_directory_count(), std::logic_error);
+}
+
+TEST_F(card_reader, timestamp_is_the_file_time)
+{
+    const auto name = card / "DCIM/100CANON/IMG_0002.CR2";
+    const auto taken = std::filesystem::last_write_time(name) - std::chrono::hours(24 * 365);
+    std::filesystem::last_write_time(name, taken);
+
+    auto volume = open_mounted_volume(card.string());
+    auto files = volume->find_matching_files("100CANON", std::regex("IMG_0002\\.CR2"));
+    ASSERT_EQ(1u, files.size());
+
+    const auto now = std::time(nullptr);
+    EXPECT_NEAR(now - 365 * 24 * 60 * 60, files[0]->get_timestamp(), 5);
+    EXPECT_FALSE(files[0]->get_date_time().empty());
+}
+
+TEST_F(card_reader, find_matching_files)
+{
+    auto volume = open_mounted_volume(card.string());
+
+    EXPECT_EQ(2u, volume->find_matching_files("100CANON", std::regex(".*\\.CR2")).size());
+    EXPECT_EQ(3u, volume->find_matching_files("100CANON", std::regex("IMG_.*")).size());
+    EXPECT_TRUE(volume->find_matching_files("101CANON", std::regex(".*")).empty());
+    EXPECT_TRUE(volume->find_matching_files("MISC", std::regex(".*")).empty());
+}
+
+TEST_F(card_reader, download_copies_the_file)
+{
+    auto volume = open_mounted_volume(card.string());
+    const auto files = volume->find_matching_files("100CANON", std::regex(".*"));
+    ASSERT_EQ(3u, files.size());
+
+    for (const auto& file : files)
+    {
+        const auto target = destination / file->get_name();
+        file->download_to(target.string());
+        EXPECT_EQ(file->get_file_size(), std::filesystem::file_size(target));
+        EXPECT_EQ(read_file(card / "DCIM/100CANON" / file->get_name()), read_file(target));
+    }
+
+    // Downloading again replaces the file
+    files[1]->download_to((destination / files[0]->get_name()).string());
+    EXPECT_EQ(100u, std::filesystem::file_size(destination / files[0]->get_name()));
+
+    EXPECT_THROW(files[0]->download_to((card / "missing" / "IMG_0001.CR2").string()),
+        std::system_error);
+    EXPECT_THROW(files[0]->download_thumbnail(), std::runtime_error);
+}
+
+TEST_F(card_reader, observed_download_passes_the_original)
+{
+    auto volume = open_mounted_volume(card.string());
+    const auto file = volume->find_matching_files("100CANON", std::regex("IMG_0001.CR2")).at(0);
+
+    std::string observed;
+    const auto target = destination / file->get_name();
+    EXPECT_TRUE(file->try_download_observed(
+        target.string(), [&observed](const uint8_t* data, std::size_t count) {
+            observed.append(reinterpret_cast<const char*>(data), count);
+        }));
+    EXPECT_EQ(read_file(card / "DCIM/100CANON" / file->get_name()), observed);
+    EXPECT_EQ(observed, read_file(target));
+}
+
+TEST_F(card_reader, entries_are_values)
+{
+    const auto root = card_reader_backend::open(card);
+    ASSERT_TRUE(root.is_a_folder());
+    ASSERT_EQ(3u, root.get_directory_count());
+    EXPECT_EQ("DCIM", root.get_directory_entry(0).get_name());
+
+    const auto folder = root.find_directory("DCIM")->find_directory("100CANON");
+    ASSERT_TRUE(folder.has_value());
+    EXPECT_FALSE(root.find_directory("101CANON").has_value());
+
+    auto files = folder->find_matching_entries(std::regex(".*\\.CR2"));
+    ASSERT_EQ(2u, files.size());
+    EXPECT_EQ("IMG_0002.CR2", files[1].get_name());
+    EXPECT_EQ(100u, files[1].get_file_size());
+    EXPECT_EQ(0xB103u, files[1].get_format());
+    EXPECT_THROW(files[1].get_directory_count(), std::logic_error);
+    EXPECT_THROW(folder->get_directory_entry(3), std::out_of_range);
+
+    // Entries are moved, not shared
+    const card_entry file = std::move(files[1]);
+    const auto target = destination / file.get_name();
+    file.download_to(target.string());
+    EXPECT_EQ(read_file(card / "DCIM/100CANON/IMG_0002.CR2"), read_file(target));
+    EXPECT_THROW(folder->download_to(target.string()), std::logic_error);
+}
+
+TEST_F(card_reader, delete_file_removes_it_from_the_card)
+{
+    auto volume = open_mounted_volume(card.string());
+    auto files = volume->find_matching_files("100CANON", std::regex("IMG_0002\\..*"));
+    ASSERT_EQ(2u, files.size());
+
+    files[0]->delete_file();
+    EXPECT_FALSE(std::filesystem::exists(card / "DCIM/100CANON/IMG_0002.CR2"));
+    EXPECT_TRUE(std::filesystem::exists(card / "DCIM/100CANON/IMG_0002.JPG"));
+    EXPECT_EQ(1u, volume->find_matching_files("100CANON", std::regex("IMG_0002\\..*")).size());
+
+    auto folder = volume->select_directory(0);
+    EXPECT_THROW(folder->delete_file(), std::logic_error);
+}
+
+TEST(open_mounted_volume, not_a_folder)
+{
+    EXPECT_THROW(open_mounted_volume("/no/such/card"), std::system_error);
+}
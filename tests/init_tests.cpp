@@ -1,6 +1,15 @@
 #include "camera_interface.hpp"
 #include "mocked-functions.hpp"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 // struct camera_info_data
 // {
@@ -161,3 +170,680 @@ TEST(get_camera_connection, second_then_first_camera_connection)
     EXPECT_EQ("Port 0", conn->get_port());
     EXPECT_EQ("Test", conn->get_desc());
 }
+
+TEST(get_camera_connection, open_cameras_in_parallel)
+{
+    reset_environment();
+    add_camera("Port 0", "Test", camera1);
+    add_camera("Port 1", "Test Camera 1", camera2);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+
+    auto selected = cameras->select_camera(0);
+
+    // Each camera has one session, which opening it shares, and opening a camera does not
+    // replace the selected camera
+    std::vector<std::future<std::shared_ptr<camera_ref>>> opening;
+    for (camera_connection::size_type camera_number = 0; camera_number < 2; camera_number++)
+        opening.push_back(std::async(std::launch::async,
+            [&cameras, camera_number] { return cameras->open_camera(camera_number); }));
+
+    auto first = opening[0].get();
+    auto second = opening[1].get();
+    EXPECT_EQ(selected, first);
+    EXPECT_EQ(2u, open_sessions.size());
+    EXPECT_EQ("Port 1", second->get_connection_info()->get_port());
+    EXPECT_EQ(camera2.product_name, second->get_camera_info()->get_product_name());
+
+    EXPECT_THROW(cameras->deselect_camera(second), eds_exception);
+    cameras->deselect_camera(selected);
+
+    // The sessions are closed when the cameras are released
+    first.reset();
+    second.reset();
+    EXPECT_TRUE(open_sessions.empty());
+}
+
+TEST(get_camera_connection, read_properties)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+
+    auto camera = cameras->select_camera(0);
+    const property_value::property_id_t ids[]
+        = { kEdsPropID_ProductName, kEdsPropID_MakerName, kEdsPropID_BatteryLevel };
+    auto values = camera->read_properties(ids);
+    ASSERT_EQ(3u, values.size());
+
+    EXPECT_EQ(kEdsPropID_ProductName, values[0].id);
+    EXPECT_EQ(camera1.product_name, values[0].to_string());
+    EXPECT_FALSE(values[1].is_available());
+    EXPECT_EQ("42%", values[2].to_string());
+}
+
+TEST(get_camera_connection, try_read_properties)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+
+    auto cameras = get_camera_connection();
+    auto camera = cameras->select_camera(0);
+    const property_value::property_id_t ids[] = { kEdsPropID_ProductName, kEdsPropID_MakerName };
+    const auto values = camera->try_read_properties(ids);
+    ASSERT_TRUE(values.has_value());
+    ASSERT_EQ(2u, values->size());
+    EXPECT_EQ(camera1.product_name, (*values)[0].to_string());
+    EXPECT_FALSE((*values)[1].is_available());
+}
+
+TEST(get_camera_connection, try_read_properties_reports_each_error)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+
+    auto cameras = get_camera_connection();
+    auto camera = cameras->select_camera(0);
+
+    // A busy property and an unknown one do not stop the others being read
+    property_errors[kEdsPropID_BatteryLevel] = EDS_ERR_DEVICE_BUSY;
+    const property_value::property_id_t ids[]
+        = { kEdsPropID_BatteryLevel, 0xFFFFFFFF, kEdsPropID_ProductName };
+    const auto values = camera->try_read_properties(ids);
+    ASSERT_TRUE(values.has_value());
+    ASSERT_EQ(3u, values->size());
+
+    EXPECT_FALSE((*values)[0].is_available());
+    ASSERT_TRUE((*values)[0].error.has_value());
+    EXPECT_TRUE((*values)[0].error->is_busy());
+    EXPECT_FALSE((*values)[1].is_available());
+    ASSERT_TRUE((*values)[1].error.has_value());
+    EXPECT_EQ(EDS_ERR_NOT_SUPPORTED, (*values)[1].error->code);
+    EXPECT_EQ(camera1.product_name, (*values)[2].to_string());
+    EXPECT_FALSE((*values)[2].error.has_value());
+
+    // Once the camera has gone there is nothing more to read
+    property_errors[kEdsPropID_BatteryLevel] = EDS_ERR_COMM_DISCONNECTED;
+    const auto gone = camera->try_read_properties(ids);
+    ASSERT_FALSE(gone.has_value());
+    EXPECT_TRUE(gone.error().is_disconnected());
+    EXPECT_THROW(camera->read_properties(ids), camera_disconnected_exception);
+
+    property_errors.clear();
+}
+
+TEST(eds_result, errors_are_returned_until_value_is_used)
+{
+    eds_result<int> busy(eds_error { EDS_ERR_DEVICE_BUSY, "Failed to download file" });
+    ASSERT_FALSE(busy.has_value());
+    EXPECT_TRUE(busy.error().is_busy());
+    EXPECT_FALSE(busy.error().is_disconnected());
+    EXPECT_THROW(busy.value(), eds_exception);
+
+    const eds_result<void> gone(eds_error { EDS_ERR_INTERNAL_ERROR, "Camera disconnected", true });
+    EXPECT_TRUE(gone.error().is_disconnected());
+    EXPECT_THROW(gone.value(), camera_disconnected_exception);
+
+    const eds_result<int> answer(42);
+    ASSERT_TRUE(answer);
+    EXPECT_EQ(42, answer.value());
+
+    const auto caught = catch_eds_error(
+        []() -> int { throw eds_exception("Failed", EDS_ERR_DEVICE_BUSY); }, "Caught");
+    ASSERT_FALSE(caught);
+    EXPECT_TRUE(caught.error().is_busy());
+    EXPECT_STREQ("Caught", caught.error().message);
+}
+
+TEST(get_camera_connection, live_camera_info)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+
+    auto camera = cameras->select_camera(0);
+    auto live_info = camera->get_live_camera_info();
+    ASSERT_NE(nullptr, live_info);
+
+    auto before = live_info->get_snapshot();
+    EXPECT_EQ(camera1.available_shots, before->get_available_shots());
+
+    change_camera_property(0, kEdsPropID_AvailableShots, 99);
+
+    auto after = live_info->get_snapshot();
+    EXPECT_EQ(99u, after->get_available_shots());
+    EXPECT_EQ(camera1.product_name, after->get_product_name());
+    EXPECT_EQ(camera1.available_shots, before->get_available_shots());
+}
+
+TEST(get_camera_connection, live_camera_info_waits_for_a_running_property_event)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+
+    auto camera = cameras->select_camera(0);
+    auto live_info = camera->get_live_camera_info();
+    ASSERT_NE(nullptr, live_info);
+
+    // The event is still being handled on the event thread when the last reference goes
+    std::promise<void> event_started;
+    std::atomic<bool> event_finished { false };
+    queue_event([&event_started, &event_finished] {
+        event_started.set_value();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        change_camera_property(0, kEdsPropID_AvailableShots, 98);
+        event_finished = true;
+    });
+
+    ASSERT_EQ(std::future_status::ready,
+        event_started.get_future().wait_for(std::chrono::seconds(5)));
+    live_info = nullptr;
+    EXPECT_TRUE(event_finished);
+
+    cameras->deselect_camera(camera);
+}
+
+TEST(get_camera_connection, camera_state_events)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+
+    auto camera = cameras->select_camera(0);
+    EXPECT_TRUE(send_camera_state_event(0, kEdsStateEvent_WillSoonShutDown));
+    EXPECT_TRUE(send_camera_state_event(0, kEdsStateEvent_Shutdown));
+    EXPECT_EQ(camera1.product_name, camera->get_camera_info()->get_product_name());
+
+    cameras->deselect_camera(camera);
+
+    EXPECT_FALSE(send_camera_state_event(0, kEdsStateEvent_Shutdown));
+}
+
+TEST(get_camera_connection, camera_added_handler)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+    ASSERT_EQ(1, cameras->number_of_cameras());
+    auto first = cameras->select_camera(0);
+
+    std::promise<void> added;
+    cameras->set_camera_added_handler([&added] { added.set_value(); });
+
+    // The camera is plugged in and the SDK tells the handler from EdsGetEvent
+    auto second_camera = camera1;
+    second_camera.product_name = "Second";
+    queue_event([second_camera] {
+        add_camera("1", "Second", second_camera);
+        EXPECT_TRUE(send_camera_added());
+    });
+    ASSERT_EQ(std::future_status::ready, added.get_future().wait_for(std::chrono::seconds(5)));
+
+    cameras->refresh();
+    ASSERT_EQ(2, cameras->number_of_cameras());
+    auto second = cameras->select_camera(1);
+    EXPECT_EQ("Second", second->get_camera_info()->get_product_name());
+    EXPECT_EQ(camera1.product_name, first->get_camera_info()->get_product_name());
+
+    // Nothing is sent once the handler is cleared
+    cameras->set_camera_added_handler(nullptr);
+    EXPECT_FALSE(send_camera_added());
+
+    cameras->deselect_camera(second);
+    cameras->deselect_camera(first);
+}
+
+TEST(get_camera_connection, object_created_handler)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+    add_volume(0, "CF", { "IMG_0001.CR2", "IMG_0002.CR2" }, 4096);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+
+    auto camera = cameras->select_camera(0);
+
+    std::mutex mutex;
+    std::condition_variable created;
+    std::vector<std::string> names;
+    camera->set_object_created_handler([&](std::shared_ptr<directory_ref> file) {
+        std::lock_guard<std::mutex> lock(mutex);
+        names.push_back(file->get_name());
+        created.notify_all();
+    });
+
+    // A camera saving to the card and the computer sends both events for each picture
+    queue_event([] {
+        send_object_event(0, kEdsObjectEvent_DirItemCreated, 0, 0);
+        send_object_event(0, kEdsObjectEvent_DirItemRequestTransfer, 0, 0);
+        send_object_event(0, kEdsObjectEvent_DirItemRequestTransfer, 0, 1);
+        send_object_event(0, kEdsObjectEvent_DirItemCreated, 0, 1);
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(created.wait_for(
+            lock, std::chrono::seconds(5), [&names] { return names.size() >= 2; }));
+    }
+
+    // Wait for the next call to EdsGetEvent, after the one that sent the events
+    std::promise<void> pumped;
+    queue_event([&pumped] { pumped.set_value(); });
+    ASSERT_EQ(std::future_status::ready, pumped.get_future().wait_for(std::chrono::seconds(5)));
+    {
+        const std::vector<std::string> expected { "IMG_0001.CR2", "IMG_0002.CR2" };
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_EQ(expected, names);
+    }
+
+    // Nothing is sent once the handler is cleared
+    camera->set_object_created_handler(nullptr);
+    EXPECT_FALSE(send_object_event(0, kEdsObjectEvent_DirItemCreated, 0, 0));
+
+    cameras->deselect_camera(camera);
+}
+
+TEST(get_camera_connection, disconnect_cancels_download)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+    add_volume(0, "CF", { "IMG_0001.CR2", "IMG_0002.CR2" }, 4096);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+
+    auto camera = cameras->select_camera(0);
+    const auto body_id = camera->get_camera_info()->get_body_ID_ex();
+    auto volume = camera->select_volume(0);
+    ASSERT_EQ(2u, volume->get_directory_count());
+
+    // The camera is unplugged part way through the first download
+    during_download = [](EdsDirectoryItem&) {
+        EXPECT_TRUE(send_camera_state_event(0, kEdsStateEvent_Shutdown));
+    };
+    const auto destination
+        = (std::filesystem::temp_directory_path() / "disconnect_cancels_download").string();
+    EXPECT_THROW(
+        volume->select_directory(0)->download_to(destination), camera_disconnected_exception);
+    EXPECT_EQ(1, downloads_cancelled);
+
+    // Nothing else is downloaded from the camera that has gone
+    during_download = nullptr;
+    EXPECT_THROW(
+        volume->select_directory(1)->download_to(destination), camera_disconnected_exception);
+
+    // Copying carries on from the camera with the same body ID once it is reconnected
+    volume = nullptr;
+    cameras->deselect_camera(camera);
+    cameras->refresh();
+    camera = cameras->select_camera(0);
+    EXPECT_EQ(body_id, camera->get_camera_info()->get_body_ID_ex());
+    EXPECT_NO_THROW(camera->select_volume(0)->select_directory(1)->download_to(destination));
+    EXPECT_EQ(1, downloads_cancelled);
+
+    cameras->deselect_camera(camera);
+}
+
+TEST(get_camera_connection, observed_download_sees_each_block_before_it_is_written)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+    // Larger than a block, so the file arrives in several
+    const uint64_t size = 9 * 1024 * 1024 + 100;
+    add_volume(0, "CF", { "IMG_0001.CR2" }, size);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+
+    auto camera = cameras->select_camera(0);
+    auto file = camera->select_volume(0)->select_directory(0);
+
+    std::vector<uint8_t> observed;
+    const auto destination = std::filesystem::temp_directory_path() / "observed_download";
+    const auto downloaded = file->try_download_observed(
+        destination.string(), [&observed, &destination](const uint8_t* data, std::size_t count) {
+            // Each block is observed before it is written
+            EXPECT_GE(observed.size(), std::filesystem::file_size(destination));
+            observed.insert(observed.end(), data, data + count);
+        });
+    ASSERT_TRUE(downloaded);
+
+    ASSERT_EQ(size, observed.size());
+    for (uint64_t offset = 0; offset < size; offset += 4093)
+        ASSERT_EQ(static_cast<uint8_t>(offset), observed[offset]) << offset;
+
+    std::ifstream written(destination, std::ios::binary);
+    const std::vector<uint8_t> contents(
+        (std::istreambuf_iterator<char>(written)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(observed, contents);
+    std::filesystem::remove(destination);
+
+    file = nullptr;
+    cameras->deselect_camera(camera);
+}
+
+TEST(get_camera_connection, disconnect_while_reading_a_timestamp)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+    add_volume(0, "CF", { "IMG_0001.CR2" }, 4096);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+
+    auto camera = cameras->select_camera(0);
+    auto file = camera->select_volume(0)->select_directory(0);
+
+    // Reading a date downloads the thumbnail, which fails when the camera has gone
+    download_thumbnail_error = EDS_ERR_COMM_DISCONNECTED;
+    EXPECT_THROW(file->get_timestamp(), camera_disconnected_exception);
+
+    download_thumbnail_error = EDS_ERR_DEVICE_BUSY;
+    try
+    {
+        file->get_timestamp();
+        FAIL() << "get_timestamp did not throw";
+    }
+    catch (const camera_disconnected_exception&)
+    {
+        FAIL() << "A busy camera is not a disconnected one";
+    }
+    catch (const eds_exception& ex)
+    {
+        EXPECT_EQ(EDS_ERR_DEVICE_BUSY, ex.error_code());
+    }
+
+    file = nullptr;
+    cameras->deselect_camera(camera);
+}
+
+TEST(get_camera_connection, disconnect_while_reading_a_property)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+
+    auto camera = cameras->select_camera(0);
+
+    property_errors[kEdsPropID_BodyIDEx] = EDS_ERR_COMM_DISCONNECTED;
+    try
+    {
+        camera->get_camera_info();
+        FAIL() << "get_camera_info did not throw";
+    }
+    catch (const camera_disconnected_exception& ex)
+    {
+        EXPECT_EQ(EDS_ERR_COMM_DISCONNECTED, ex.error_code());
+        // The message says which property could not be read
+        EXPECT_NE(std::string::npos,
+            std::string(ex.what()).find(std::to_string(kEdsPropID_BodyIDEx)));
+    }
+
+    property_errors[kEdsPropID_BodyIDEx] = EDS_ERR_DEVICE_BUSY;
+    try
+    {
+        camera->get_camera_info();
+        FAIL() << "get_camera_info did not throw";
+    }
+    catch (const camera_disconnected_exception&)
+    {
+        FAIL() << "A busy camera is not a disconnected one";
+    }
+    catch (const eds_exception& ex)
+    {
+        EXPECT_EQ(EDS_ERR_DEVICE_BUSY, ex.error_code());
+    }
+
+    property_errors.clear();
+    cameras->deselect_camera(camera);
+}
+
+TEST(get_camera_connection, keep_sessions_open)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+    cameras->set_keep_sessions_open(true);
+
+    auto camera = cameras->select_camera(0);
+    const auto* first = camera.get();
+    cameras->deselect_camera(camera);
+
+    // The session is still open, so selecting the camera again returns the same camera_ref
+    EXPECT_NE(nullptr, current_camera);
+    camera = cameras->select_camera(0);
+    EXPECT_EQ(first, camera.get());
+    cameras->deselect_camera(camera);
+
+    cameras->refresh();
+    EXPECT_NE(nullptr, current_camera);
+
+    cameras->set_keep_sessions_open(false);
+    EXPECT_EQ(nullptr, current_camera);
+}
+
+TEST(get_camera_connection, live_view)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+    set_live_view_frame_rate(200);
+
+    auto cameras = get_camera_connection();
+
+    ASSERT_NE(nullptr, cameras.get());
+    auto camera = cameras->select_camera(0);
+    auto view = camera->start_live_view(3);
+
+    uint64_t last_sequence = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        ASSERT_TRUE(view->next_frame(last_sequence, std::chrono::seconds(2),
+            [&](const live_view_frame& frame) {
+                EXPECT_GT(frame.sequence, last_sequence);
+                ASSERT_EQ(12u, frame.jpeg.size());
+                EXPECT_EQ(0xff, frame.jpeg[0]);
+                EXPECT_EQ(0xd8, frame.jpeg[1]);
+                EXPECT_EQ(0xd9, frame.jpeg[11]);
+                last_sequence = frame.sequence;
+            }));
+    }
+
+    view->stop();
+    const auto stats = view->get_stats();
+    EXPECT_GE(stats.frames, last_sequence);
+    EXPECT_GT(stats.frames_per_second, 0.0);
+
+    // Stopping live view puts the output device back, so no more frames arrive
+    EXPECT_FALSE(view->next_frame(stats.frames, std::chrono::milliseconds(50),
+        [](const live_view_frame&) {}));
+
+    view.reset();
+    cameras->deselect_camera(camera);
+}
+
+TEST(develop_raw_image, jpeg_and_tiff16)
+{
+    reset_environment();
+    auto cameras = get_camera_connection();
+
+    const auto folder = std::filesystem::temp_directory_path() / "camera_interface_tests";
+    std::filesystem::create_directories(folder);
+
+    // A sample raw file only needs the CR2 header for the mocked SDK
+    const auto raw = folder / "IMG_0001.CR2";
+    {
+        std::ofstream file(raw, std::ios::binary);
+        const char header[] = { 'I', 'I', 0x2a, 0, 0x10, 0, 0, 0, 'C', 'R', 2, 0 };
+        file.write(header, sizeof(header));
+    }
+
+    const auto read_start = [](const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<unsigned char> start(4);
+        file.read(reinterpret_cast<char*>(start.data()), start.size());
+        return start;
+    };
+
+    const auto jpeg = folder / "IMG_0001.jpg";
+    develop_raw_image(raw.string(), jpeg.string(), developed_format::jpeg);
+    const auto jpeg_start = read_start(jpeg);
+    EXPECT_EQ(0xff, jpeg_start[0]);
+    EXPECT_EQ(0xd8, jpeg_start[1]);
+
+    const auto tiff = folder / "IMG_0001.tif";
+    develop_raw_image(raw.string(), tiff.string(), developed_format::tiff16);
+    const auto tiff_start = read_start(tiff);
+    EXPECT_TRUE((tiff_start[0] == 'M' && tiff_start[1] == 'M')
+        || (tiff_start[0] == 'I' && tiff_start[1] == 'I'));
+
+    // Anything that is not a raw file is rejected by the SDK
+    EXPECT_THROW(develop_raw_image(jpeg.string(), (folder / "not_raw.jpg").string(),
+                     developed_format::jpeg),
+        eds_exception);
+
+    std::filesystem::remove_all(folder);
+}
+
+TEST(api_stats, counts_sdk_calls)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+
+    auto cameras = get_camera_connection();
+    ASSERT_NE(nullptr, cameras.get());
+
+    reset_api_stats();
+    set_api_stats_enabled(true);
+    auto camera = cameras->select_camera(0);
+    auto info = camera->get_camera_info();
+    cameras->deselect_camera(camera);
+    set_api_stats_enabled(false);
+
+    const auto stats = get_api_stats();
+    const auto property_data = std::find_if(stats.begin(), stats.end(),
+        [](const api_call_stats& call) { return call.function == "EdsGetPropertyData"; });
+    ASSERT_NE(stats.end(), property_data);
+    EXPECT_GT(property_data->calls, 0u);
+    EXPECT_LE(property_data->p50, property_data->p99);
+    EXPECT_LE(property_data->p99, property_data->max);
+    EXPECT_LE(property_data->max, property_data->total);
+
+    // Nothing is counted while stats are disabled
+    const auto calls = property_data->calls;
+    camera = cameras->select_camera(0);
+    info = camera->get_camera_info();
+    cameras->deselect_camera(camera);
+    const auto after = get_api_stats();
+    const auto unchanged = std::find_if(after.begin(), after.end(),
+        [](const api_call_stats& call) { return call.function == "EdsGetPropertyData"; });
+    ASSERT_NE(after.end(), unchanged);
+    EXPECT_EQ(calls, unchanged->calls);
+}
+
+TEST(trace, records_sdk_calls_and_spans)
+{
+    reset_environment();
+    add_camera("0", "Test", camera1);
+
+    auto cameras = get_camera_connection();
+    ASSERT_NE(nullptr, cameras.get());
+
+    std::ostringstream discarded;
+    write_trace(discarded);
+
+    set_trace_enabled(true);
+    set_trace_thread_name("test \"thread\"");
+    {
+        const trace_span span("pipeline", "select camera", "camera 0");
+        auto camera = cameras->select_camera(0);
+        auto info = camera->get_camera_info();
+        cameras->deselect_camera(camera);
+    }
+    set_trace_enabled(false);
+
+    // Nothing is recorded while tracing is disabled
+    {
+        const trace_span span("pipeline", "not recorded");
+    }
+
+    std::ostringstream out;
+    write_trace(out);
+    const auto trace = out.str();
+
+    EXPECT_EQ(0u, trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+    EXPECT_NE(std::string::npos, trace.find("\"cat\":\"sdk\",\"name\":\"EdsGetPropertyData\""));
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"select camera\""));
+    EXPECT_NE(std::string::npos, trace.find("\"args\":{\"detail\":\"camera 0\"}"));
+    EXPECT_NE(std::string::npos, trace.find("\"args\":{\"name\":\"test \\\"thread\\\"\"}"));
+    EXPECT_EQ(std::string::npos, trace.find("not recorded"));
+
+    // Writing the trace clears it
+    std::ostringstream again;
+    write_trace(again);
+    EXPECT_EQ(std::string::npos, again.str().find("EdsGetPropertyData"));
+}
+
+TEST(allocation_stats, counts_allocations_by_scope)
+{
+    EXPECT_GT(get_peak_rss(), 0u);
+
+    if (!allocation_stats_available())
+    {
+        EXPECT_TRUE(get_allocation_stats().empty());
+        return;
+    }
+
+    reset_environment();
+    add_camera("0", "Test", camera1);
+
+    auto cameras = get_camera_connection();
+    ASSERT_NE(nullptr, cameras.get());
+
+    reset_allocation_stats();
+    auto camera = cameras->select_camera(0);
+    auto info = camera->get_camera_info();
+    cameras->deselect_camera(camera);
+
+    const auto stats = get_allocation_stats();
+    const auto find_scope = [&stats](const std::string& name) {
+        return std::find_if(stats.begin(), stats.end(),
+            [&name](const allocation_scope_stats& scope) { return scope.scope == name; });
+    };
+
+    const auto properties = find_scope("properties");
+    const auto total = find_scope("total");
+    ASSERT_NE(stats.end(), properties);
+    ASSERT_NE(stats.end(), total);
+    EXPECT_GT(properties->allocations, 0u);
+    EXPECT_GE(properties->bytes, properties->allocations);
+    EXPECT_GE(total->allocations, properties->allocations);
+    EXPECT_NE(stats.end(), find_scope("other"));
+}
@@ -16,8 +16,17 @@
 #include "EDSDK.h"
 #include "EDSDKErrors.h"
 #include "gtest/gtest.h"
+#include <chrono>
 #include <cstddef>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <span>
 #include <string>
 #include <vector>
@@ -96,7 +105,7 @@ struct __EdsObject
             }
             return EDS_ERR_OK;
         }
-        return EDS_ERR_UNIMPLEMENTED;
+        return EDS_ERR_PROPERTIES_UNAVAILABLE;
     }
 
     virtual EdsError get_child_at_index(int, EdsBaseRef*) { return EDS_ERR_SELECTION_UNAVAILABLE; }
@@ -129,12 +138,81 @@ struct camera_info_data
     size_t available_shots;
 };
 
+/// A file on a card
+class EdsDirectoryItem : public __EdsObject
+{
+    std::map<EdsPropertyID, object_properties> properties;
+
+public:
+    std::string name;
+    EdsUInt64 size;
+    /// Set by EdsDownloadCancel
+    bool cancelled { false };
+    /// Where the next block sent by EdsDownload starts
+    EdsUInt64 downloaded { 0 };
+
+    EdsDirectoryItem(std::string file_name, EdsUInt64 file_size)
+        : name(std::move(file_name))
+        , size(file_size)
+    {
+    }
+
+    std::map<EdsPropertyID, object_properties>& get_object_properties() override
+    {
+        return properties;
+    }
+};
+
+/// A card in a camera, holding files but no folders
+class EdsVolume : public __EdsObject
+{
+    std::map<EdsPropertyID, object_properties> properties;
+
+public:
+    std::string label;
+    std::vector<std::shared_ptr<EdsDirectoryItem>> items;
+
+    explicit EdsVolume(std::string volume_label)
+        : label(std::move(volume_label))
+    {
+    }
+
+    EdsError get_child_at_index(int offset, EdsBaseRef* out) override
+    {
+        if (offset >= static_cast<int>(items.size()))
+            return EDS_ERR_SELECTION_UNAVAILABLE;
+
+        *out = items.at(offset).get();
+        (*out)->retain();
+        return EDS_ERR_OK;
+    }
+
+    EdsError get_child_count(EdsUInt32* outCount) override
+    {
+        *outCount = items.size();
+        return EDS_ERR_OK;
+    }
+
+    std::map<EdsPropertyID, object_properties>& get_object_properties() override
+    {
+        return properties;
+    }
+};
+
 class EdsCamera : public __EdsObject
 {
     EdsDeviceInfo info;
     std::map<EdsPropertyID, object_properties> properties;
 
 public:
+    EdsPropertyEventHandler property_event_handler { nullptr };
+    EdsVoid* property_event_context { nullptr };
+    EdsStateEventHandler state_event_handler { nullptr };
+    EdsVoid* state_event_context { nullptr };
+    EdsObjectEventHandler object_event_handler { nullptr };
+    EdsVoid* object_event_context { nullptr };
+    std::vector<std::shared_ptr<EdsVolume>> volumes;
+
     EdsCamera(std::string port, std::string name, const camera_info_data& data)
     {
         strncpy(info.szPortName, port.c_str(), sizeof(info.szPortName));
@@ -185,6 +263,23 @@ public:
     }
 
     virtual ~EdsCamera() { }
+
+    EdsError get_child_at_index(int offset, EdsBaseRef* out) override
+    {
+        if (offset >= static_cast<int>(volumes.size()))
+            return EDS_ERR_SELECTION_UNAVAILABLE;
+
+        *out = volumes.at(offset).get();
+        (*out)->retain();
+        return EDS_ERR_OK;
+    }
+
+    EdsError get_child_count(EdsUInt32* outCount) override
+    {
+        *outCount = volumes.size();
+        return EDS_ERR_OK;
+    }
+
     EdsDeviceInfo& get_device_info()
     {
         EXPECT_GE(count, 1);
@@ -199,7 +294,8 @@ public:
 
 class EdsCameraList : public __EdsObject
 {
-    std::vector<EdsCamera> cameras;
+    /// Cameras added after others have been selected do not move them
+    std::deque<EdsCamera> cameras;
     std::map<EdsPropertyID, object_properties> properties;
 
 public:
@@ -216,6 +312,8 @@ public:
         return cameras.size();
     }
 
+    EdsCamera& at(int offset) { return cameras.at(offset); }
+
     EdsError get_child_at_index(int offset, EdsBaseRef* out) override
     {
         EXPECT_GE(count, 0);
@@ -251,18 +349,140 @@ public:
     }
 };
 
+/// A memory stream, which grows as it is written to
+class EdsMemoryStream : public __EdsObject
+{
+    std::map<EdsPropertyID, object_properties> properties;
+
+public:
+    std::vector<uint8_t> data;
+    std::size_t position { 0 };
+
+    void write(const uint8_t* bytes, std::size_t size)
+    {
+        if (position + size > data.size())
+            data.resize(position + size);
+        std::copy(bytes, bytes + size, data.begin() + static_cast<std::ptrdiff_t>(position));
+        position += size;
+    }
+
+    std::map<EdsPropertyID, object_properties>& get_object_properties() override
+    {
+        return properties;
+    }
+};
+
+class EdsEvfImage : public __EdsObject
+{
+    std::map<EdsPropertyID, object_properties> properties;
+
+public:
+    EdsMemoryStream* stream;
+
+    explicit EdsEvfImage(EdsMemoryStream* image_stream)
+        : stream(image_stream)
+    {
+    }
+
+    std::map<EdsPropertyID, object_properties>& get_object_properties() override
+    {
+        return properties;
+    }
+};
+
+/// An image opened from a stream. Only raw files (with a CR2 header) can be developed.
+class EdsImage : public __EdsObject
+{
+    std::map<EdsPropertyID, object_properties> properties;
+
+public:
+    static constexpr EdsInt32 width = 60;
+    static constexpr EdsInt32 height = 40;
+
+    EdsMemoryStream* stream;
+
+    explicit EdsImage(EdsMemoryStream* image_stream)
+        : stream(image_stream)
+    {
+    }
+
+    bool is_raw() const
+    {
+        const auto& data = stream->data;
+        return data.size() >= 10 && data[0] == 'I' && data[1] == 'I' && data[8] == 'C'
+            && data[9] == 'R';
+    }
+
+    std::map<EdsPropertyID, object_properties>& get_object_properties() override
+    {
+        return properties;
+    }
+};
+
 std::shared_ptr<EdsCameraList> camera_list;
+/// The camera with the last session opened, and every camera with a session open
 EdsCamera* current_camera = nullptr;
+std::mutex sessions_mutex;
+std::set<EdsCamera*> open_sessions;
 int initialised_count = 0;
 int finalised_count = 0;
 int max_num_cameras = 1;
 
+/// Streams and images created by the code under test (kept until the environment is reset)
+std::vector<std::unique_ptr<__EdsObject>> created_objects;
+
+/// Called by EdsDownload before it sends any data, e.g. to unplug the camera part way through
+std::function<void(EdsDirectoryItem&)> during_download;
+int downloads_cancelled = 0;
+/// What EdsDownloadThumbnail returns
+EdsError download_thumbnail_error = EDS_ERR_UNIMPLEMENTED;
+/// Errors returned by EdsGetPropertySize and EdsGetPropertyData for these properties
+std::map<EdsPropertyID, EdsError> property_errors;
+EdsCameraAddedHandler camera_added_handler = nullptr;
+EdsVoid* camera_added_context = nullptr;
+
+/// Events sent by the next call to EdsGetEvent, on the thread that calls it
+std::mutex queued_events_mutex;
+std::vector<std::function<void()>> queued_events;
+
+std::chrono::microseconds live_view_frame_interval { 1000000 / 30 };
+std::chrono::steady_clock::time_point next_live_view_frame;
+uint64_t live_view_frames_sent = 0;
+
 void reset_environment()
 {
     current_camera = nullptr;
+    open_sessions.clear();
     camera_list = nullptr;
     initialised_count = 0;
     finalised_count = 0;
+    created_objects.clear();
+    live_view_frame_interval = std::chrono::microseconds(1000000 / 30);
+    next_live_view_frame = {};
+    live_view_frames_sent = 0;
+    during_download = nullptr;
+    downloads_cancelled = 0;
+    download_thumbnail_error = EDS_ERR_UNIMPLEMENTED;
+    property_errors.clear();
+    camera_added_handler = nullptr;
+    camera_added_context = nullptr;
+
+    std::lock_guard<std::mutex> lock(queued_events_mutex);
+    queued_events.clear();
+}
+
+/// Send an event from the next call to EdsGetEvent, as the SDK does
+void queue_event(std::function<void()> event)
+{
+    std::lock_guard<std::mutex> lock(queued_events_mutex);
+    queued_events.push_back(std::move(event));
+}
+
+/// The rate at which EdsDownloadEvfImage delivers live view frames
+void set_live_view_frame_rate(double frames_per_second)
+{
+    live_view_frame_interval
+        = std::chrono::microseconds(static_cast<int64_t>(1000000 / frames_per_second));
 }
 
 void add_camera(std::string port, std::string camera_name, const camera_info_data& data)
@@ -273,6 +493,66 @@ void add_camera(std::string port, std::string camera_name, const camera_info_dat
     camera_list->add_camera(port, camera_name, data);
 }
 
+/// Add a card holding files of the given size to a camera
+void add_volume(int camera_number, std::string label, const std::vector<std::string>& files,
+    EdsUInt64 file_size)
+{
+    auto volume = std::make_shared<EdsVolume>(std::move(label));
+    for (const auto& name : files)
+        volume->items.push_back(std::make_shared<EdsDirectoryItem>(name, file_size));
+
+    camera_list->at(camera_number).volumes.push_back(std::move(volume));
+}
+
+/// Change a property of a camera and send the property changed event (as EdsGetEvent would)
+void change_camera_property(int camera_number, EdsPropertyID id, uint32_t value)
+{
+    auto& camera = camera_list->at(camera_number);
+    camera.get_object_properties()[id] = { kEdsDataType_UInt32, sizeof(EdsUInt32), "",
+        vectorise(gsl::as_bytes(gsl::make_span(&value, 1))) };
+
+    if (camera.property_event_handler)
+        camera.property_event_handler(
+            kEdsPropertyEvent_PropertyChanged, id, 0, camera.property_event_context);
+}
+
+/// Send a camera state event (as EdsGetEvent would). Returns false if no handler is registered.
+bool send_camera_state_event(int camera_number, EdsStateEvent event)
+{
+    auto& camera = camera_list->at(camera_number);
+    if (!camera.state_event_handler)
+        return false;
+
+    camera.state_event_handler(event, 0, camera.state_event_context);
+    return true;
+}
+
+/// Tell the camera added handler that a camera has been connected (as EdsGetEvent would).
+/// Returns false if no handler is registered.
+bool send_camera_added()
+{
+    if (!camera_added_handler)
+        return false;
+
+    camera_added_handler(camera_added_context);
+    return true;
+}
+
+/// Send an object event for a file on a camera's card (as EdsGetEvent would). Returns false if
+/// no handler is registered.
+bool send_object_event(int camera_number, EdsObjectEvent event, int volume, int file)
+{
+    auto& camera = camera_list->at(camera_number);
+    if (!camera.object_event_handler)
+        return false;
+
+    // The handler is given a reference, which it releases
+    auto item = camera.volumes.at(volume)->items.at(file).get();
+    item->retain();
+    camera.object_event_handler(event, item, camera.object_event_context);
+    return true;
+}
+
 #pragma clang diagnostic ignored "-Wunused-parameter"
 
 EdsError EDSAPI EdsInitializeSDK()
@@ -317,6 +597,9 @@ EdsError EDSAPI EdsGetParent(EdsBaseRef inRef, EdsBaseRef* outParentRef)
 EdsError EDSAPI EdsGetPropertySize(EdsBaseRef inRef, EdsPropertyID inPropertyID, EdsInt32 inParam,
     EdsDataType* outDataType, EdsUInt32* outSize)
 {
+    if (auto error = property_errors.find(inPropertyID); error != property_errors.end())
+        return error->second;
+
     *outDataType = inRef->get_property_type(inPropertyID);
     if (*outDataType == kEdsDataType_Unknown)
         return EDS_ERR_PROPERTIES_UNAVAILABLE;
@@ -328,13 +611,22 @@ EdsError EDSAPI EdsGetPropertySize(EdsBaseRef inRef, EdsPropertyID inPropertyID,
 EdsError EDSAPI EdsGetPropertyData(EdsBaseRef inRef, EdsPropertyID inPropertyID, EdsInt32 inParam,
     EdsUInt32 inPropertySize, EdsVoid* outPropertyData)
 {
+    if (auto error = property_errors.find(inPropertyID); error != property_errors.end())
+        return error->second;
+
     return inRef->get_property_data(inPropertyID, inParam, inPropertySize, outPropertyData);
 }
 
 EdsError EDSAPI EdsSetPropertyData(EdsBaseRef inRef, EdsPropertyID inPropertyID, EdsInt32 inParam,
     EdsUInt32 inPropertySize, const EdsVoid* inPropertyData)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    if (inPropertyID != kEdsPropID_Evf_OutputDevice || inPropertySize != sizeof(EdsUInt32))
+        return EDS_ERR_UNIMPLEMENTED;
+
+    inRef->get_object_properties()[inPropertyID] = { kEdsDataType_UInt32, sizeof(EdsUInt32), "",
+        vectorise(gsl::as_bytes(
+            gsl::make_span(static_cast<const EdsUInt32*>(inPropertyData), 1))) };
+    return EDS_ERR_OK;
 }
 
 EdsError EDSAPI EdsGetPropertyDesc(
@@ -367,9 +659,11 @@ EdsError EDSAPI EdsOpenSession(EdsCameraRef inCameraRef)
     EXPECT_NE(inCameraRef, nullptr);
     EXPECT_GE(inCameraRef->count, 1);
 
-    EXPECT_EQ(nullptr, current_camera);
-    current_camera = reinterpret_cast<EdsCamera*>(inCameraRef);
-    current_camera->retain();
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    auto camera = reinterpret_cast<EdsCamera*>(inCameraRef);
+    EXPECT_TRUE(open_sessions.insert(camera).second) << "The session is already open";
+    camera->retain();
+    current_camera = camera;
     return EDS_ERR_OK;
 }
 
@@ -378,9 +672,11 @@ EdsError EDSAPI EdsCloseSession(EdsCameraRef inCameraRef)
     EXPECT_NE(inCameraRef, nullptr);
     EXPECT_GE(inCameraRef->count, 1);
 
-    EXPECT_EQ(current_camera, inCameraRef);
-    current_camera->release();
-    current_camera = nullptr;
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    auto camera = reinterpret_cast<EdsCamera*>(inCameraRef);
+    EXPECT_EQ(1u, open_sessions.erase(camera)) << "The session is not open";
+    camera->release();
+    current_camera = open_sessions.empty() ? nullptr : *open_sessions.begin();
     return EDS_ERR_OK;
 }
 
@@ -481,7 +777,17 @@ EdsError EDSAPI EdsSetCapacity(EdsCameraRef inCameraRef, EdsCapacity inCapacity)
 -----------------------------------------------------------------------------*/
 EdsError EDSAPI EdsGetVolumeInfo(EdsVolumeRef inVolumeRef, EdsVolumeInfo* outVolumeInfo)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto volume = dynamic_cast<EdsVolume*>(inVolumeRef);
+    if (volume == nullptr)
+        return EDS_ERR_INVALID_PARAMETER;
+
+    *outVolumeInfo = {};
+    outVolumeInfo->storageType = kEdsStorageType_CF;
+    outVolumeInfo->access = kEdsAccess_ReadWrite;
+    outVolumeInfo->maxCapacity = 64 * 1024 * 1024;
+    outVolumeInfo->freeSpaceInBytes = 32 * 1024 * 1024;
+    strncpy(outVolumeInfo->szVolumeLabel, volume->label.c_str(), EDS_MAX_NAME - 1);
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -523,7 +829,15 @@ EdsError EDSAPI EdsFormatVolume(EdsVolumeRef inVolumeRef) { return EDS_ERR_UNIMP
 EdsError EDSAPI EdsGetDirectoryItemInfo(
     EdsDirectoryItemRef inDirItemRef, EdsDirectoryItemInfo* outDirItemInfo)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto item = dynamic_cast<EdsDirectoryItem*>(inDirItemRef);
+    if (item == nullptr)
+        return EDS_ERR_INVALID_PARAMETER;
+
+    *outDirItemInfo = {};
+    outDirItemInfo->size = item->size;
+    outDirItemInfo->isFolder = false;
+    strncpy(outDirItemInfo->szFileName, item->name.c_str(), EDS_MAX_NAME - 1);
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -571,7 +885,27 @@ EdsError EDSAPI EdsDeleteDirectoryItem(EdsDirectoryItemRef inDirItemRef)
 EdsError EDSAPI EdsDownload(
     EdsDirectoryItemRef inDirItemRef, EdsUInt64 inReadSize, EdsStreamRef outStream)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto item = dynamic_cast<EdsDirectoryItem*>(inDirItemRef);
+    auto stream = dynamic_cast<EdsMemoryStream*>(outStream);
+    if (item == nullptr || stream == nullptr)
+        return EDS_ERR_INVALID_PARAMETER;
+
+    if (during_download)
+        during_download(*item);
+
+    // A download cancelled while it was running fails, as it does in the SDK
+    if (item->cancelled)
+        return EDS_ERR_OPERATION_CANCELLED;
+
+    // Each byte is the low byte of its offset in the file, so blocks sent out of order show
+    const auto size = std::min(inReadSize, item->size - item->downloaded);
+    std::vector<uint8_t> data(size);
+    for (EdsUInt64 i = 0; i < size; i++)
+        data[i] = static_cast<uint8_t>(item->downloaded + i);
+    item->downloaded += size;
+
+    stream->write(data.data(), data.size());
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -591,7 +925,14 @@ EdsError EDSAPI EdsDownload(
 -----------------------------------------------------------------------------*/
 EdsError EDSAPI EdsDownloadCancel(EdsDirectoryItemRef inDirItemRef)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto item = dynamic_cast<EdsDirectoryItem*>(inDirItemRef);
+    if (item == nullptr)
+        return EDS_ERR_INVALID_PARAMETER;
+
+    item->cancelled = true;
+    item->downloaded = 0;
+    downloads_cancelled++;
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -613,7 +954,12 @@ EdsError EDSAPI EdsDownloadCancel(EdsDirectoryItemRef inDirItemRef)
 -----------------------------------------------------------------------------*/
 EdsError EDSAPI EdsDownloadComplete(EdsDirectoryItemRef inDirItemRef)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto item = dynamic_cast<EdsDirectoryItem*>(inDirItemRef);
+    if (item == nullptr)
+        return EDS_ERR_INVALID_PARAMETER;
+
+    item->downloaded = 0;
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -635,7 +981,7 @@ EdsError EDSAPI EdsDownloadComplete(EdsDirectoryItemRef inDirItemRef)
 -----------------------------------------------------------------------------*/
 EdsError EDSAPI EdsDownloadThumbnail(EdsDirectoryItemRef inDirItemRef, EdsStreamRef outStream)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    return download_thumbnail_error;
 }
 
 /*-----------------------------------------------------------------------------
@@ -735,7 +1081,12 @@ EdsError EDSAPI EdsCreateFileStream(const EdsChar* inFileName,
 -----------------------------------------------------------------------------*/
 EdsError EDSAPI EdsCreateMemoryStream(EdsUInt64 inBufferSize, EdsStreamRef* outStream)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto stream = std::make_unique<EdsMemoryStream>();
+    stream->data.reserve(inBufferSize);
+    stream->retain();
+    *outStream = stream.get();
+    created_objects.push_back(std::move(stream));
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -768,7 +1119,35 @@ EdsError EDSAPI EdsCreateFileStreamEx(
     EdsFileCreateDisposition inCreateDisposition, EdsAccess inDesiredAccess,
     EdsStreamRef* outStream)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    // Files that are created are kept in memory, as downloads would be written to them
+    if (inCreateDisposition == kEdsFileCreateDisposition_CreateAlways)
+    {
+        auto created = std::make_unique<EdsMemoryStream>();
+        created->retain();
+        *outStream = created.get();
+        created_objects.push_back(std::move(created));
+        return EDS_ERR_OK;
+    }
+
+    // Otherwise only reading existing files is supported; the whole file is read into memory
+    if (inCreateDisposition != kEdsFileCreateDisposition_OpenExisting)
+        return EDS_ERR_UNIMPLEMENTED;
+
+    char path[1024];
+    if (!CFURLGetFileSystemRepresentation(
+            inURL, true, reinterpret_cast<UInt8*>(path), sizeof(path)))
+        return EDS_ERR_INVALID_PARAMETER;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return EDS_ERR_FILE_NOT_FOUND;
+
+    auto stream = std::make_unique<EdsMemoryStream>();
+    stream->data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    stream->retain();
+    *outStream = stream.get();
+    created_objects.push_back(std::move(stream));
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -817,7 +1196,12 @@ EdsError EDSAPI EdsCreateMemoryStreamFromPointer(
 -----------------------------------------------------------------------------*/
 EdsError EDSAPI EdsGetPointer(EdsStreamRef inStream, EdsVoid** outPointer)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto* stream = dynamic_cast<EdsMemoryStream*>(inStream);
+    if (!stream)
+        return EDS_ERR_INVALID_HANDLE;
+
+    *outPointer = stream->data.data();
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -891,7 +1275,21 @@ EdsError EDSAPI EdsWrite(EdsStreamRef inStreamRef, EdsUInt64 inWriteSize, const
 -----------------------------------------------------------------------------*/
 EdsError EDSAPI EdsSeek(EdsStreamRef inStreamRef, EdsInt64 inSeekOffset, EdsSeekOrigin inSeekOrigin)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto* stream = dynamic_cast<EdsMemoryStream*>(inStreamRef);
+    if (!stream)
+        return EDS_ERR_INVALID_HANDLE;
+
+    EdsInt64 origin = 0;
+    if (inSeekOrigin == kEdsSeek_Cur)
+        origin = static_cast<EdsInt64>(stream->position);
+    else if (inSeekOrigin == kEdsSeek_End)
+        origin = static_cast<EdsInt64>(stream->data.size());
+
+    if (origin + inSeekOffset < 0)
+        return EDS_ERR_STREAM_SEEK_ERROR;
+
+    stream->position = static_cast<std::size_t>(origin + inSeekOffset);
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -910,7 +1308,12 @@ EdsError EDSAPI EdsSeek(EdsStreamRef inStreamRef, EdsInt64 inSeekOffset, EdsSeek
 -----------------------------------------------------------------------------*/
 EdsError EDSAPI EdsGetPosition(EdsStreamRef inStreamRef, EdsUInt64* outPosition)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto* stream = dynamic_cast<EdsMemoryStream*>(inStreamRef);
+    if (!stream)
+        return EDS_ERR_INVALID_HANDLE;
+
+    *outPosition = stream->position;
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -928,7 +1331,12 @@ EdsError EDSAPI EdsGetPosition(EdsStreamRef inStreamRef, EdsUInt64* outPosition)
 -----------------------------------------------------------------------------*/
 EdsError EDSAPI EdsGetLength(EdsStreamRef inStreamRef, EdsUInt64* outLength)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto* stream = dynamic_cast<EdsMemoryStream*>(inStreamRef);
+    if (!stream)
+        return EDS_ERR_INVALID_HANDLE;
+
+    *outLength = stream->data.size();
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -1022,7 +1430,15 @@ EdsError EDSAPI EdsSetProgressCallback(EdsBaseRef inRef, EdsProgressCallback inP
 -----------------------------------------------------------------------------*/
 EdsError EDSAPI EdsCreateImageRef(EdsStreamRef inStreamRef, EdsImageRef* outImageRef)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto* stream = dynamic_cast<EdsMemoryStream*>(inStreamRef);
+    if (!stream)
+        return EDS_ERR_INVALID_HANDLE;
+
+    auto image = std::make_unique<EdsImage>(stream);
+    image->retain();
+    *outImageRef = image.get();
+    created_objects.push_back(std::move(image));
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -1055,7 +1471,15 @@ EdsError EDSAPI EdsCreateImageRef(EdsStreamRef inStreamRef, EdsImageRef* outImag
 EdsError EDSAPI EdsGetImageInfo(
     EdsImageRef inImageRef, EdsImageSource inImageSource, EdsImageInfo* outImageInfo)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto* image = dynamic_cast<EdsImage*>(inImageRef);
+    if (!image)
+        return EDS_ERR_INVALID_HANDLE;
+    if (!image->is_raw())
+        return EDS_ERR_FILE_FORMAT_UNRECOGNIZED;
+
+    *outImageInfo = { EdsImage::width, EdsImage::height, 3, 16,
+        { { 0, 0 }, { EdsImage::width, EdsImage::height } }, 0, 0 };
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -1101,7 +1525,24 @@ EdsError EDSAPI EdsGetImageInfo(
 EdsError EDSAPI EdsGetImage(EdsImageRef inImageRef, EdsImageSource inImageSource,
     EdsTargetImageType inImageType, EdsRect inSrcRect, EdsSize inDstSize, EdsStreamRef outStreamRef)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto* image = dynamic_cast<EdsImage*>(inImageRef);
+    auto* output = dynamic_cast<EdsMemoryStream*>(outStreamRef);
+    if (!image || !output)
+        return EDS_ERR_INVALID_HANDLE;
+    if (!image->is_raw())
+        return EDS_ERR_FILE_FORMAT_UNRECOGNIZED;
+    if (inImageType != kEdsTargetImageType_RGB && inImageType != kEdsTargetImageType_RGB16)
+        return EDS_ERR_INVALID_PARAMETER;
+
+    // A grey gradient, with 1 or 2 bytes per component
+    const std::size_t component_size = (inImageType == kEdsTargetImageType_RGB16) ? 2 : 1;
+    std::vector<uint8_t> pixels;
+    for (EdsInt32 y = 0; y < inDstSize.height; y++)
+        for (EdsInt32 x = 0; x < inDstSize.width * 3; x++)
+            pixels.insert(pixels.end(), component_size, static_cast<uint8_t>(x + y));
+
+    output->write(pixels.data(), pixels.size());
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -1118,7 +1559,15 @@ EdsError EDSAPI EdsGetImage(EdsImageRef inImageRef, EdsImageSource inImageSource
 -----------------------------------------------------------------------------*/
 EdsError EDSAPI EdsCreateEvfImageRef(EdsStreamRef inStreamRef, EdsEvfImageRef* outEvfImageRef)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto* stream = dynamic_cast<EdsMemoryStream*>(inStreamRef);
+    if (!stream)
+        return EDS_ERR_INVALID_HANDLE;
+
+    auto image = std::make_unique<EdsEvfImage>(stream);
+    image->retain();
+    *outEvfImageRef = image.get();
+    created_objects.push_back(std::move(image));
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -1147,7 +1596,32 @@ EdsEvfImageRef,
 -----------------------------------------------------------------------------*/
 EdsError EDSAPI EdsDownloadEvfImage(EdsCameraRef inCameraRef, EdsEvfImageRef inEvfImageRef)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto* image = dynamic_cast<EdsEvfImage*>(inEvfImageRef);
+    if (!image)
+        return EDS_ERR_INVALID_HANDLE;
+
+    // Live view frames only go to the PC once the output device has been set
+    EdsUInt32 output_device = 0;
+    EdsGetPropertyData(inCameraRef, kEdsPropID_Evf_OutputDevice, 0, sizeof(output_device),
+        &output_device);
+    if ((output_device & kEdsEvfOutputDevice_PC) == 0)
+        return EDS_ERR_OBJECT_NOTREADY;
+
+    // Frames are delivered at the live view frame rate
+    const auto now = std::chrono::steady_clock::now();
+    if (next_live_view_frame > now)
+        std::this_thread::sleep_until(next_live_view_frame);
+    next_live_view_frame = std::max(now, next_live_view_frame) + live_view_frame_interval;
+
+    // A minimal JPEG: SOI, the frame number, EOI
+    const uint64_t frame = ++live_view_frames_sent;
+    std::vector<uint8_t> jpeg { 0xff, 0xd8 };
+    for (int shift = 56; shift >= 0; shift -= 8)
+        jpeg.push_back(static_cast<uint8_t>(frame >> shift));
+    jpeg.insert(jpeg.end(), { 0xff, 0xd9 });
+
+    image->stream->write(jpeg.data(), jpeg.size());
+    return EDS_ERR_OK;
 }
 
 /******************************************************************************
@@ -1177,7 +1651,9 @@ EdsError EDSAPI EdsDownloadEvfImage(EdsCameraRef inCameraRef, EdsEvfImageRef inE
 EdsError EDSAPI EdsSetCameraAddedHandler(
     EdsCameraAddedHandler inCameraAddedHandler, EdsVoid* inContext)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    camera_added_handler = inCameraAddedHandler;
+    camera_added_context = inContext;
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -1203,7 +1679,10 @@ EdsError EDSAPI EdsSetCameraAddedHandler(
 EdsError EDSAPI EdsSetPropertyEventHandler(EdsCameraRef inCameraRef, EdsPropertyEvent inEvnet,
     EdsPropertyEventHandler inPropertyEventHandler, EdsVoid* inContext)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto camera = reinterpret_cast<EdsCamera*>(inCameraRef);
+    camera->property_event_handler = inPropertyEventHandler;
+    camera->property_event_context = inContext;
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -1231,7 +1710,10 @@ EdsError EDSAPI EdsSetPropertyEventHandler(EdsCameraRef inCameraRef, EdsProperty
 EdsError EDSAPI EdsSetObjectEventHandler(EdsCameraRef inCameraRef, EdsObjectEvent inEvnet,
     EdsObjectEventHandler inObjectEventHandler, EdsVoid* inContext)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto camera = reinterpret_cast<EdsCamera*>(inCameraRef);
+    camera->object_event_handler = inObjectEventHandler;
+    camera->object_event_context = inContext;
+    return EDS_ERR_OK;
 }
 
 /*-----------------------------------------------------------------------------
@@ -1258,7 +1740,10 @@ EdsError EDSAPI EdsSetObjectEventHandler(EdsCameraRef inCameraRef, EdsObjectEven
 EdsError EDSAPI EdsSetCameraStateEventHandler(EdsCameraRef inCameraRef, EdsStateEvent inEvnet,
     EdsStateEventHandler inStateEventHandler, EdsVoid* inContext)
 {
-    return EDS_ERR_UNIMPLEMENTED;
+    auto camera = reinterpret_cast<EdsCamera*>(inCameraRef);
+    camera->state_event_handler = inStateEventHandler;
+    camera->state_event_context = inContext;
+    return EDS_ERR_OK;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -1279,4 +1764,15 @@ EdsError EDSAPI EdsCreateStream(EdsIStream* inStream, EdsStreamRef* outStreamRef
 //
 //  Returns:    Any of the sdk errors.
 -----------------------------------------------------------------------------*/
-EdsError EDSAPI EdsGetEvent() { return EDS_ERR_UNIMPLEMENTED; }
+EdsError EDSAPI EdsGetEvent()
+{
+    std::vector<std::function<void()>> events;
+    {
+        std::lock_guard<std::mutex> lock(queued_events_mutex);
+        events.swap(queued_events);
+    }
+
+    for (const auto& event : events)
+        event();
+    return EDS_ERR_OK;
+}
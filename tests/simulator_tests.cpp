@@ -0,0 +1,248 @@
+#include "EDSDK.h"
+#include "EDSDKErrors.h"
+#include "simulator.hpp"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+constexpr uint64_t file_size = 1024 * 1024;
+
+/// A simulated camera holding IMG_0001.CR2 to IMG_0004.CR2 that answers at once, with the
+/// 100CANON folder open. Each test injects its own faults.
+class simulated_faults : public ::testing::Test
+{
+protected:
+    EdsCameraListRef list = nullptr;
+    EdsCameraRef camera = nullptr;
+    EdsVolumeRef volume = nullptr;
+    EdsDirectoryItemRef dcim = nullptr;
+    EdsDirectoryItemRef folder = nullptr;
+
+    void SetUp() override
+    {
+        simulator::configuration config;
+        config.timing.call_latency = std::chrono::microseconds(0);
+        config.timing.call_latencies.clear();
+        config.timing.bytes_per_second = 0;
+        config.cameras.front().cards.front().files = 4;
+        config.cameras.front().cards.front().file_size = file_size;
+        simulator::configure(config);
+
+        ASSERT_EQ(EDS_ERR_OK, EdsInitializeSDK());
+        ASSERT_EQ(EDS_ERR_OK, EdsGetCameraList(&list));
+        ASSERT_EQ(EDS_ERR_OK, EdsGetChildAtIndex(list, 0, &camera));
+        ASSERT_EQ(EDS_ERR_OK, EdsOpenSession(camera));
+        ASSERT_EQ(EDS_ERR_OK, EdsGetChildAtIndex(camera, 0, &volume));
+        ASSERT_EQ(EDS_ERR_OK, EdsGetChildAtIndex(volume, 0, &dcim));
+        ASSERT_EQ(EDS_ERR_OK, EdsGetChildAtIndex(dcim, 0, &folder));
+        simulator::reset_fault_statistics();
+    }
+
+    void TearDown() override
+    {
+        simulator::inject_faults({});
+        for (auto ref : { folder, dcim, volume, camera, list })
+        {
+            if (ref)
+                EdsRelease(ref);
+        }
+        EdsTerminateSDK();
+    }
+
+    /// Read the information about a file, which is one call to the camera
+    EdsError read_info(int index)
+    {
+        EdsDirectoryItemRef file = nullptr;
+        if (auto err = EdsGetChildAtIndex(folder, index, &file); err != EDS_ERR_OK)
+            return err;
+
+        EdsDirectoryItemInfo info;
+        const auto err = EdsGetDirectoryItemInfo(file, &info);
+        EdsRelease(file);
+        return err;
+    }
+
+    EdsError download(int index)
+    {
+        EdsDirectoryItemRef file = nullptr;
+        if (auto err = EdsGetChildAtIndex(folder, index, &file); err != EDS_ERR_OK)
+            return err;
+
+        EdsStreamRef stream = nullptr;
+        EdsCreateMemoryStream(0, &stream);
+        auto err = EdsDownload(file, file_size, stream);
+        if (err == EDS_ERR_OK)
+            err = EdsDownloadComplete(file);
+
+        EdsRelease(stream);
+        EdsRelease(file);
+        return err;
+    }
+
+    /// Which of count calls fail
+    std::vector<bool> failures(int count)
+    {
+        std::vector<bool> failed;
+        for (int call = 0; call < count; call++)
+            failed.push_back(read_info(call % 4) != EDS_ERR_OK);
+        return failed;
+    }
+
+    static simulator::fault busy(const std::string& function)
+    {
+        simulator::fault fault;
+        fault.function = function;
+        return fault;
+    }
+};
+} // namespace
+
+TEST_F(simulated_faults, probability_is_repeatable_for_a_seed)
+{
+    auto fault = busy("EdsGetDirectoryItemInfo");
+    fault.probability = 0.25;
+
+    simulator::inject_faults({ fault }, 42);
+    const auto first = failures(2000);
+    const auto failed = static_cast<uint64_t>(std::count(first.begin(), first.end(), true));
+    EXPECT_GT(failed, 400u);
+    EXPECT_LT(failed, 600u);
+    EXPECT_EQ(failed, simulator::get_fault_statistics().faults);
+
+    // The same seed fails the same calls
+    simulator::inject_faults({ fault }, 42);
+    EXPECT_EQ(first, failures(2000));
+}
+
+TEST_F(simulated_faults, schedule_skips_calls_then_stops)
+{
+    auto fault = busy("EdsGetDirectoryItemInfo");
+    fault.after_calls = 2;
+    fault.times = 3;
+
+    simulator::inject_faults({ fault });
+    const std::vector<bool> expected { false, false, true, true, true, false, false, false };
+    EXPECT_EQ(expected, failures(8));
+    EXPECT_EQ(3u, simulator::get_fault_statistics().faults);
+
+    // Calls to other functions do not count
+    EXPECT_EQ(EDS_ERR_OK, download(0));
+}
+
+TEST_F(simulated_faults, file_faults_only_hit_that_file)
+{
+    auto fault = busy("EdsDownload");
+    fault.error = EDS_ERR_INTERNAL_ERROR;
+    fault.file = "IMG_0002.CR2";
+
+    simulator::inject_faults({ fault });
+    EXPECT_EQ(EDS_ERR_OK, download(0));
+    EXPECT_EQ(EDS_ERR_INTERNAL_ERROR, download(1));
+    EXPECT_EQ(EDS_ERR_OK, download(2));
+    EXPECT_EQ(EDS_ERR_INTERNAL_ERROR, download(1));
+    EXPECT_EQ(2u, simulator::get_fault_statistics().faults);
+}
+
+TEST_F(simulated_faults, error_part_way_through_a_download)
+{
+    auto fault = busy("EdsDownload");
+    fault.at_fraction = 0.25;
+    fault.times = 1;
+
+    simulator::inject_faults({ fault });
+    EXPECT_EQ(EDS_ERR_DEVICE_BUSY, download(0));
+
+    const auto statistics = simulator::get_fault_statistics();
+    EXPECT_EQ(1u, statistics.faults);
+    EXPECT_EQ(0u, statistics.disconnects);
+    EXPECT_EQ(file_size / 4, statistics.bytes_downloaded);
+}
+
+namespace
+{
+std::atomic<bool> camera_added { false };
+std::atomic<EdsDirectoryItemRef> downloading { nullptr };
+
+EdsError EDSCALLBACK on_camera_added(EdsVoid*)
+{
+    camera_added = true;
+    return EDS_ERR_OK;
+}
+
+/// Cancel the download when the camera goes, as camera_interface does
+EdsError EDSCALLBACK on_state(EdsStateEvent event, EdsUInt32, EdsVoid*)
+{
+    if (auto file = downloading.load(); event == kEdsStateEvent_Shutdown && file)
+        EdsDownloadCancel(file);
+    return EDS_ERR_OK;
+}
+} // namespace
+
+TEST_F(simulated_faults, disconnect_cancels_the_download_and_wastes_what_was_sent)
+{
+    simulator::fault fault;
+    fault.function = "EdsDownload";
+    fault.kind = simulator::fault::kind_t::disconnect;
+    fault.file = "IMG_0001.CR2";
+    fault.at_fraction = 0.5;
+    fault.times = 1;
+    fault.reconnect_after = std::chrono::milliseconds(50);
+
+    EdsDirectoryItemRef file = nullptr;
+    ASSERT_EQ(EDS_ERR_OK, EdsGetChildAtIndex(folder, 0, &file));
+
+    camera_added = false;
+    EdsSetCameraAddedHandler(on_camera_added, nullptr);
+    EdsSetCameraStateEventHandler(camera, kEdsStateEvent_All, on_state, nullptr);
+
+    // The events are sent from another thread, as they are with a camera
+    std::atomic<bool> stop { false };
+    std::thread events([&stop] {
+        while (!stop)
+        {
+            EdsGetEvent();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    simulator::inject_faults({ fault });
+
+    EdsStreamRef stream = nullptr;
+    EdsCreateMemoryStream(0, &stream);
+    downloading = file;
+    EXPECT_EQ(EDS_ERR_COMM_DISCONNECTED, EdsDownload(file, file_size, stream));
+    downloading = nullptr;
+    EdsRelease(stream);
+    EdsRelease(file);
+
+    // Nothing can be done until the camera comes back
+    EXPECT_EQ(EDS_ERR_COMM_DISCONNECTED, read_info(1));
+
+    const auto reconnect_timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!camera_added && std::chrono::steady_clock::now() < reconnect_timeout)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_TRUE(camera_added);
+
+    stop = true;
+    events.join();
+    EdsSetCameraAddedHandler(nullptr, nullptr);
+
+    auto statistics = simulator::get_fault_statistics();
+    EXPECT_EQ(1u, statistics.faults);
+    EXPECT_EQ(1u, statistics.disconnects);
+    EXPECT_EQ(file_size / 2, statistics.bytes_downloaded);
+    EXPECT_EQ(file_size / 2, statistics.bytes_wasted);
+
+    // The whole file is downloaded again once the session is reopened
+    ASSERT_EQ(EDS_ERR_OK, EdsOpenSession(camera));
+    EXPECT_EQ(EDS_ERR_OK, download(0));
+    statistics = simulator::get_fault_statistics();
+    EXPECT_EQ(file_size / 2 + file_size, statistics.bytes_downloaded);
+    EXPECT_EQ(file_size / 2, statistics.bytes_wasted);
+}
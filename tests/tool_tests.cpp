@@ -0,0 +1,176 @@
+#include "daemon_protocol.hpp"
+#include "json_lines.hpp"
+#include "raw_developer.hpp"
+#include "thumbnail_cache.hpp"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+TEST(json_lines, each_record_is_one_line)
+{
+    std::ostringstream out;
+    for (int record = 0; record < 3; record++)
+    {
+        write_json_line(out, [record](Poco::JSON::PrintHandler& json) {
+            json_field(json, "type", "file");
+            json_field(json, "name", "IMG_000" + std::to_string(record) + ".CR3");
+            json_field(json, "size", uint64_t { 25 * 1024 * 1024 });
+        });
+    }
+
+    std::istringstream lines(out.str());
+    std::string line;
+    int count = 0;
+    while (std::getline(lines, line))
+    {
+        ASSERT_FALSE(line.empty());
+        EXPECT_EQ('{', line.front());
+        EXPECT_EQ('}', line.back());
+        EXPECT_NE(std::string::npos, line.find("IMG_000" + std::to_string(count) + ".CR3"));
+        EXPECT_NE(std::string::npos, line.find("26214400"));
+        count++;
+    }
+    EXPECT_EQ(3, count);
+}
+
+TEST(raw_developer, develops_raw_files_and_counts_failures)
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool started = false;
+    bool release = false;
+    std::vector<std::filesystem::path> developed;
+
+    // Holds the worker on the first file until released, so the others queue up behind it
+    auto develop = [&](const std::filesystem::path& raw, const std::filesystem::path& output) {
+        std::unique_lock<std::mutex> lock(mutex);
+        started = true;
+        changed.notify_all();
+        changed.wait(lock, [&release] { return release; });
+
+        if (raw.filename() == "IMG_0003.CR2")
+            throw std::runtime_error("Corrupt raw file");
+        developed.push_back(output);
+    };
+
+    raw_developer developer(developed_format::tiff, 1, develop);
+    developer.add("card/IMG_0001.CR2");
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&started] { return started; });
+    }
+
+    developer.add("card/IMG_0002.cr3");
+    developer.add("card/IMG_0003.CR2");
+    developer.add("card/IMG_0004.JPG");
+    developer.add("card/IMG_0005.CRW");
+    EXPECT_EQ(3u, developer.queue_depth());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+        changed.notify_all();
+    }
+
+    const auto summary = developer.finish();
+    EXPECT_EQ(3u, summary.developed);
+    EXPECT_EQ(1u, summary.failed);
+    EXPECT_EQ(3u, summary.max_queue_depth);
+    EXPECT_EQ(3u, summary.develop_times.size());
+
+    const std::vector<std::filesystem::path> expected { "card/IMG_0001.tif", "card/IMG_0002.tif",
+        "card/IMG_0005.tif" };
+    EXPECT_EQ(expected, developed);
+}
+
+TEST(raw_developer, names_the_developed_file_by_format)
+{
+    const std::filesystem::path raw("IMG_0001.CR2");
+    EXPECT_EQ("IMG_0001.jpg", raw_developer::developed_name(raw, developed_format::jpeg));
+    EXPECT_EQ("IMG_0001.tif", raw_developer::developed_name(raw, developed_format::tiff16));
+}
+
+TEST(thumbnail_cache, different_names_have_different_paths)
+{
+    const thumbnail_cache cache("cache");
+    const auto path = [&cache](const std::string& folder, const std::string& name) {
+        return cache.path_for("123", folder, name, 100);
+    };
+
+    EXPECT_NE(path("A/B", "IMG_0001.CR2"), path("A_B", "IMG_0001.CR2"));
+    EXPECT_NE(path("A%2FB", "IMG_0001.CR2"), path("A/B", "IMG_0001.CR2"));
+    EXPECT_NE(path("", "IMG_0001.CR2"), path("_", "IMG_0001.CR2"));
+    EXPECT_EQ(std::filesystem::path("cache/123/100CANON/IMG_0001.CR2-100.jpg"),
+        path("100CANON", "IMG_0001.CR2"));
+
+    // Every name stays inside the cache as one folder
+    for (const auto* folder : { ".", "..", "../..", "/" })
+    {
+        const auto relative = path(folder, "IMG_0001.CR2").lexically_relative("cache/123");
+        EXPECT_EQ(2, std::distance(relative.begin(), relative.end())) << folder;
+        EXPECT_NE("..", *relative.begin()) << folder;
+    }
+}
+
+/// The two ends of a connected Unix domain socket, closed when the test ends
+class socket_pair
+{
+public:
+    int ends[2] = { -1, -1 };
+
+    socket_pair() { ::socketpair(AF_UNIX, SOCK_STREAM, 0, ends); }
+    ~socket_pair()
+    {
+        ::close(ends[0]);
+        ::close(ends[1]);
+    }
+};
+
+TEST(daemon_protocol, request_larger_than_the_limit_is_refused)
+{
+    const socket_pair connection;
+
+    // A header claiming 4 GB of data
+    const char header[5] = { 'q', '\xFF', '\xFF', '\xFF', '\xFF' };
+    ASSERT_TRUE(daemon_protocol::write_all(connection.ends[0], header, sizeof(header)));
+
+    daemon_protocol::frame_type type;
+    std::string data;
+    EXPECT_FALSE(daemon_protocol::read_frame(
+        connection.ends[1], type, data, daemon_protocol::max_request_size));
+    EXPECT_TRUE(data.empty());
+
+    const auto args = daemon_protocol::encode_strings({ "/home", "lscamera", "-c", "0" });
+    ASSERT_TRUE(daemon_protocol::write_frame(
+        connection.ends[0], daemon_protocol::frame_type::request, args.data(), args.size()));
+    ASSERT_TRUE(daemon_protocol::read_frame(
+        connection.ends[1], type, data, daemon_protocol::max_request_size));
+    EXPECT_EQ(daemon_protocol::frame_type::request, type);
+    EXPECT_EQ(args, data);
+}
+
+TEST(daemon_protocol, client_that_sends_part_of_a_request_times_out)
+{
+    const socket_pair connection;
+    const timeval timeout { 0, 100000 };
+    ::setsockopt(connection.ends[1], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    const char header[5] = { 'q', 0, 0, 0, 10 };
+    ASSERT_TRUE(daemon_protocol::write_all(connection.ends[0], header, sizeof(header)));
+
+    daemon_protocol::frame_type type;
+    std::string data;
+    const auto started = std::chrono::steady_clock::now();
+    EXPECT_FALSE(daemon_protocol::read_frame(
+        connection.ends[1], type, data, daemon_protocol::max_request_size));
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(5));
+}
+
+} // namespace